@@ -0,0 +1,899 @@
+#include <screamdeck.h>
+#include "scdk_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define BENCH_ICON_COUNT 8
+#define BENCH_JPEG_CACHE_FILE_SIZE_BYTES ((size_t)64 * 1024 * 1024)
+
+#define BENCH_VERIFY_ITERATION_COUNT 2000
+#define BENCH_VERIFY_MAX_PIXEL_COUNT 512
+#define BENCH_VERIFY_ROW_LENGTH (BENCH_VERIFY_MAX_PIXEL_COUNT * 4)
+
+// Outputs are compared in full, beyond what the kernel should write, to also catch writes past the end
+#define BENCH_VERIFY_OUTPUT_LENGTH (BENCH_VERIFY_ROW_LENGTH + 64)
+
+// Outputs of one set of key row kernels: the 24, 32 and 8 bit rows, the 8 bit and uv chroma rows, then the 4 planes of
+// each yuv420 format
+#define BENCH_VERIFY_KEY_ROW_OUTPUT_COUNT (6 + (4 * SCDK_KERNELS_RGB_FORMAT_COUNT))
+
+// Decoded frames are taken as wrong when their mean error against the source is above this. Correct decodes of the
+// bench content stay under 18 even at quality 10, while a swapped channel order or orientation is over 45.
+#define BENCH_VALIDATE_MAX_MEAN_ERROR 24.0
+
+#define BENCH_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define BENCH_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+typedef enum bench_workload_e
+{
+	BENCH_WORKLOAD_STATIC = 0,
+	BENCH_WORKLOAD_SINGLE_KEY,
+	BENCH_WORKLOAD_VIDEO,
+	BENCH_WORKLOAD_ICON_CYCLE,
+	BENCH_WORKLOAD_COUNT
+
+} bench_workload_e;
+
+typedef struct bench_options_t
+{
+	int frame_count;
+	int quality_percentage;
+	int encoder_thread_count;
+	bool is_planar_encoding_enabled;
+	bool is_scheduler_enabled;
+	bool is_validation_enabled;
+	size_t jpeg_cache_size_bytes;
+	const char* jpeg_cache_path;
+	int bandwidth_bytes_per_second;
+	int target_frames_per_second;
+	int target_bytes_per_second;
+	int block_sad_threshold;
+	scdk_jpeg_encoder_e jpeg_encoder;
+
+} bench_options_t;
+
+static const struct
+{
+	scdk_device_type_e device_type;
+	const char* name;
+}
+bench_devices[] =
+{
+	{ SCDK_DEVICE_TYPE_ORIGINAL, "original" },
+	{ SCDK_DEVICE_TYPE_ORIGINAL_MK2, "original_mk2" },
+	{ SCDK_DEVICE_TYPE_MK2, "mk2" },
+	{ SCDK_DEVICE_TYPE_MINI, "mini" },
+	{ SCDK_DEVICE_TYPE_MINI_MK2, "mini_mk2" },
+	{ SCDK_DEVICE_TYPE_XL, "xl" },
+	{ SCDK_DEVICE_TYPE_XL_MK2, "xl_mk2" },
+};
+
+static const char* bench_pixel_format_names[] =
+{
+	"rgb", "bgr", "rgbx", "bgrx", "xbgr", "xrgb", "rgba", "bgra", "abgr", "argb", "i420", "nv12"
+};
+
+static const char* bench_workload_names[BENCH_WORKLOAD_COUNT] =
+{
+	"static", "single_key", "video", "icon_cycle"
+};
+
+static const char* bench_jpeg_encoder_names[] =
+{
+	"turbojpeg", "builtin"
+};
+
+#define BENCH_JPEG_ENCODER_COUNT ((int)(sizeof(bench_jpeg_encoder_names) / sizeof(bench_jpeg_encoder_names[0])))
+
+typedef enum bench_kernel_e
+{
+	BENCH_KERNEL_REVERSE_ROW_8 = 0,
+	BENCH_KERNEL_REVERSE_ROW_UV,
+	BENCH_KERNEL_REVERSE_ROW_24,
+	BENCH_KERNEL_REVERSE_ROW_32,
+	BENCH_KERNEL_REVERSE_ROWS_YUV420,
+	BENCH_KERNEL_SAD_ROW_16,
+	BENCH_KERNEL_FDCT_8X8,
+	BENCH_KERNEL_KEY_ROWS,
+	BENCH_KERNEL_COUNT
+
+} bench_kernel_e;
+
+static const char* bench_kernel_names[BENCH_KERNEL_COUNT] =
+{
+	"reverse_row_8", "reverse_row_uv", "reverse_row_24", "reverse_row_32", "reverse_rows_yuv420", "sad_row_16",
+	"fdct_8x8", "key_rows"
+};
+
+static const char* bench_stage_names[SCDK_STAGE_COUNT] =
+{
+	"extract", "hash", "encode", "packetize", "write"
+};
+
+#define BENCH_PIXEL_FORMAT_COUNT ((int)(sizeof(bench_pixel_format_names) / sizeof(bench_pixel_format_names[0])))
+
+static uint64_t bench_time_now_ns(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000000
+		+ ((counter.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart);
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+#endif
+}
+
+// Cheap integer hash so synthetic content has enough texture to give JPEG sizes like real images
+static unsigned char bench_noise(uint32_t x, uint32_t y, uint32_t seed)
+{
+	uint32_t h = (x * 0x9E3779B1u) ^ (y * 0x85EBCA77u) ^ (seed * 0xC2B2AE3Du);
+	h ^= h >> 15;
+	h *= 0x2C1B3C6Du;
+	h ^= h >> 12;
+
+	return (unsigned char)(h & 0x1F);
+}
+
+// Renders an icon-like pattern: a coloured disc on a gradient, distinct for each icon index
+static void bench_render_icon(unsigned char* rgb, int image_width, int left, int top, int width, int height,
+                              int icon_index)
+{
+	const int radius = (width < height ? width : height) / 3;
+	const int cx = width / 2;
+	const int cy = height / 2;
+
+	for (int y = 0; y < height; ++y)
+	{
+		unsigned char* p = rgb + ((((top + y) * image_width) + left) * 3);
+
+		for (int x = 0; x < width; ++x)
+		{
+			const int dx = x - cx;
+			const int dy = y - cy;
+
+			if ((dx * dx) + (dy * dy) < radius * radius)
+			{
+				p[0] = (unsigned char)(64 + (icon_index * 23));
+				p[1] = (unsigned char)(200 - (icon_index * 19));
+				p[2] = (unsigned char)(icon_index * 31);
+			}
+			else
+			{
+				p[0] = (unsigned char)((x * 255) / width);
+				p[1] = (unsigned char)((y * 255) / height);
+				p[2] = (unsigned char)(icon_index * 32);
+			}
+
+			p += 3;
+		}
+	}
+}
+
+static void bench_render_frame(const scdk_device_type_info_t* type_info, bench_workload_e workload, int frame_index,
+                               unsigned char* rgb)
+{
+	const int key_count = type_info->columns * type_info->rows;
+	const int pitch_x = type_info->key_image_width + type_info->key_gap_width;
+	const int pitch_y = type_info->key_image_height + type_info->key_gap_height;
+
+	if (workload == BENCH_WORKLOAD_VIDEO)
+	{
+		// A gradient panning across the panel with per-frame noise, so every key changes every frame
+		for (int y = 0; y < type_info->image_height; ++y)
+		{
+			unsigned char* p = rgb + ((y * type_info->image_width) * 3);
+
+			for (int x = 0; x < type_info->image_width; ++x)
+			{
+				const unsigned char noise = bench_noise(x, y, frame_index);
+
+				p[0] = (unsigned char)(x + (frame_index * 4) + noise);
+				p[1] = (unsigned char)(y + (frame_index * 2) + noise);
+				p[2] = (unsigned char)(((x + y) / 2) - (frame_index * 3));
+				p += 3;
+			}
+		}
+
+		return;
+	}
+
+	memset(rgb, 0, (size_t)type_info->image_width * type_info->image_height * 3);
+
+	for (int key_index = 0; key_index < key_count; ++key_index)
+	{
+		int icon_index = key_index % BENCH_ICON_COUNT;
+
+		if (workload == BENCH_WORKLOAD_ICON_CYCLE)
+			icon_index = (key_index + frame_index) % BENCH_ICON_COUNT;
+		else if (workload == BENCH_WORKLOAD_SINGLE_KEY && key_index == frame_index % key_count)
+			icon_index = frame_index % BENCH_ICON_COUNT;
+
+		bench_render_icon(rgb, type_info->image_width, (key_index % type_info->columns) * pitch_x,
+		                  (key_index / type_info->columns) * pitch_y, type_info->key_image_width,
+		                  type_info->key_image_height, icon_index);
+	}
+
+	// Repainting the key each frame with a marker that moves makes it differ from its previous contents
+	if (workload == BENCH_WORKLOAD_SINGLE_KEY)
+	{
+		const int key_index = frame_index % key_count;
+		const int left = (key_index % type_info->columns) * pitch_x;
+		const int top = (key_index / type_info->columns) * pitch_y;
+		const int marker = frame_index % type_info->key_image_height;
+
+		memset(rgb + ((((top + marker) * type_info->image_width) + left) * 3), 255,
+		       (size_t)type_info->key_image_width * 3);
+	}
+}
+
+static unsigned char bench_y(const unsigned char* p)
+{
+	return (unsigned char)(((19595 * p[0]) + (38470 * p[1]) + (7471 * p[2]) + 32768) >> 16);
+}
+
+static unsigned char bench_chroma(int r, int g, int b, int cr, int cg, int cb)
+{
+	const int value = ((cr * r) + (cg * g) + (cb * b) + (128 << 16) + 32768) >> 16;
+	return (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+static void bench_convert_frame(const scdk_device_type_info_t* type_info, const unsigned char* rgb,
+                                scdk_pixel_format_e pixel_format, unsigned char* dst)
+{
+	const int width = type_info->image_width;
+	const int height = type_info->image_height;
+	const size_t pixel_count = (size_t)width * height;
+
+	if (pixel_format == SCDK_PIXEL_FORMAT_I420 || pixel_format == SCDK_PIXEL_FORMAT_NV12)
+	{
+		unsigned char* chroma = dst + pixel_count;
+		const size_t chroma_plane_length = pixel_count / 4;
+
+		for (size_t i = 0; i < pixel_count; ++i)
+			dst[i] = bench_y(rgb + (i * 3));
+
+		for (int y = 0; y < height / 2; ++y)
+		{
+			for (int x = 0; x < width / 2; ++x)
+			{
+				int r = 0, g = 0, b = 0;
+
+				for (int i = 0; i < 4; ++i)
+				{
+					const unsigned char* p = rgb + (((((y * 2) + (i / 2)) * width) + (x * 2) + (i % 2)) * 3);
+					r += p[0];
+					g += p[1];
+					b += p[2];
+				}
+
+				const unsigned char cb = bench_chroma(r / 4, g / 4, b / 4, -11059, -21709, 32768);
+				const unsigned char cr = bench_chroma(r / 4, g / 4, b / 4, 32768, -27439, -5329);
+				const size_t chroma_index = ((size_t)y * (width / 2)) + x;
+
+				if (pixel_format == SCDK_PIXEL_FORMAT_NV12)
+				{
+					chroma[chroma_index * 2] = cb;
+					chroma[(chroma_index * 2) + 1] = cr;
+				}
+				else
+				{
+					chroma[chroma_index] = cb;
+					chroma[chroma_plane_length + chroma_index] = cr;
+				}
+			}
+		}
+
+		return;
+	}
+
+	// Byte offsets of red, green and blue, and of the padding byte where there is one
+	static const int layouts[][4] =
+	{
+		{ 0, 1, 2, -1 }, { 2, 1, 0, -1 },
+		{ 0, 1, 2, 3 }, { 2, 1, 0, 3 }, { 3, 2, 1, 0 }, { 1, 2, 3, 0 },
+		{ 0, 1, 2, 3 }, { 2, 1, 0, 3 }, { 3, 2, 1, 0 }, { 1, 2, 3, 0 },
+	};
+
+	const int* layout = layouts[pixel_format];
+	const int pixel_size = layout[3] == -1 ? 3 : 4;
+
+	for (size_t i = 0; i < pixel_count; ++i)
+	{
+		unsigned char* p = dst + (i * pixel_size);
+
+		p[layout[0]] = rgb[i * 3];
+		p[layout[1]] = rgb[(i * 3) + 1];
+		p[layout[2]] = rgb[(i * 3) + 2];
+
+		if (layout[3] != -1)
+			p[layout[3]] = 255;
+	}
+}
+
+// Compares the key areas of what a virtual device decoded with the source image, ignoring the gaps between keys that
+// are never sent
+static void bench_compare_frame(const scdk_device_type_info_t* type_info, const unsigned char* rgb,
+                                const unsigned char* decoded, int* max_error, double* mean_error)
+{
+	uint64_t total_error = 0;
+	uint64_t sample_count = 0;
+	*max_error = 0;
+
+	for (int key_index = 0; key_index < type_info->columns * type_info->rows; ++key_index)
+	{
+		const int left = (key_index % type_info->columns) * (type_info->key_image_width + type_info->key_gap_width);
+		const int top = (key_index / type_info->columns) * (type_info->key_image_height + type_info->key_gap_height);
+
+		for (int y = top; y < top + type_info->key_image_height; ++y)
+		{
+			const size_t offset = (((size_t)y * type_info->image_width) + left) * 3;
+
+			for (int i = 0; i < type_info->key_image_width * 3; ++i)
+			{
+				const int error = abs((int)rgb[offset + i] - (int)decoded[offset + i]);
+				*max_error = BENCH_MAX(*max_error, error);
+				total_error += error;
+			}
+
+			sample_count += (uint64_t)type_info->key_image_width * 3;
+		}
+	}
+
+	*mean_error = sample_count > 0 ? (double)total_error / (double)sample_count : 0.0;
+}
+
+// Upper bound of the histogram bucket holding the given percentile, capped at the slowest duration seen
+static double bench_percentile_us(const scdk_stage_stats_t* stage_stats, double percentile)
+{
+	const uint64_t target = (uint64_t)(stage_stats->count * percentile);
+	uint64_t count = 0;
+
+	for (int bucket = 0; bucket < SCDK_STATS_HISTOGRAM_BUCKET_COUNT; ++bucket)
+	{
+		count += stage_stats->histogram[bucket];
+		if (count > target)
+			return (double)BENCH_MIN((uint64_t)2 << bucket, stage_stats->max_ns) / 1e3;
+	}
+
+	return stage_stats->max_ns / 1e3;
+}
+
+static uint32_t bench_random(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return *state = x;
+}
+
+static void bench_random_fill(unsigned char* buffer, size_t length, uint32_t* state)
+{
+	for (size_t i = 0; i < length; ++i)
+		buffer[i] = (unsigned char)(bench_random(state) >> 24);
+}
+
+// Runs the row kernels instantiated for each key width and the reference kernels at that width on the same random
+// input, returning whether every output matches
+static bool bench_verify_key_rows(const scdk_kernels_t* kernels, const scdk_kernels_t* reference, uint32_t* state)
+{
+	static unsigned char src[BENCH_VERIFY_ROW_LENGTH * 2];
+	static unsigned char outputs[2][BENCH_VERIFY_KEY_ROW_OUTPUT_COUNT][BENCH_VERIFY_OUTPUT_LENGTH];
+
+	for (const scdk_key_row_kernels_t* key_row_kernels = kernels->key_row_kernels; key_row_kernels->key_width != 0;
+	     ++key_row_kernels)
+	{
+		const int width = key_row_kernels->key_width;
+		const scdk_key_row_kernels_t reference_row_kernels =
+		{
+			width,
+			reference->reverse_row_24,
+			reference->reverse_row_32,
+			reference->reverse_row_8,
+			reference->reverse_row_8,
+			reference->reverse_row_uv,
+			reference->reverse_rows_yuv420
+		};
+		const scdk_key_row_kernels_t* tables[2] = { key_row_kernels, &reference_row_kernels };
+
+		bench_random_fill(src, sizeof(src), state);
+		bench_random_fill(&outputs[0][0][0], sizeof(outputs[0]), state);
+		memcpy(outputs[1], outputs[0], sizeof(outputs[0]));
+
+		for (int t = 0; t < 2; ++t)
+		{
+			unsigned char (*dst)[BENCH_VERIFY_OUTPUT_LENGTH] = outputs[t];
+
+			tables[t]->reverse_row_24(src, dst[0], width);
+			tables[t]->reverse_row_32(src, dst[1], width);
+			tables[t]->reverse_row_8(src, dst[2], width);
+			tables[t]->reverse_row_8_chroma(src, dst[3], width / 2);
+			tables[t]->reverse_row_uv_chroma(src, dst[4], dst[5], width / 2);
+
+			for (int format = 0; format < SCDK_KERNELS_RGB_FORMAT_COUNT; ++format)
+			{
+				unsigned char (*planes)[BENCH_VERIFY_OUTPUT_LENGTH] = dst + 6 + (format * 4);
+				tables[t]->reverse_rows_yuv420[format](src, src + BENCH_VERIFY_ROW_LENGTH, planes[0], planes[1],
+				                                       planes[2], planes[3], width);
+			}
+		}
+
+		if (memcmp(outputs[0], outputs[1], sizeof(outputs[0])) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+// Runs one kernel of kernels and of reference on the same random input, returning whether every output matches
+static bool bench_verify_kernel(const scdk_kernels_t* kernels, const scdk_kernels_t* reference, bench_kernel_e kernel,
+                                uint32_t* state)
+{
+	static unsigned char src[BENCH_VERIFY_ROW_LENGTH * 2];
+	// Word typed so the SAD sums and DCT coefficients can be written to it
+	static uint32_t outputs[2][4][BENCH_VERIFY_OUTPUT_LENGTH / 4];
+
+	const scdk_kernels_t* tables[2] = { kernels, reference };
+
+	if (kernel == BENCH_KERNEL_KEY_ROWS)
+		return bench_verify_key_rows(kernels, reference, state);
+
+	int pixel_count = 1 + (int)(bench_random(state) % BENCH_VERIFY_MAX_PIXEL_COUNT);
+	bench_random_fill(src, sizeof(src), state);
+	bench_random_fill((unsigned char*)outputs[0], sizeof(outputs[0]), state);
+	memcpy(outputs[1], outputs[0], sizeof(outputs[0]));
+
+	if (kernel == BENCH_KERNEL_FDCT_8X8)
+	{
+		// Flat blocks with a little noise quantize mostly to zero, exercising the non-zero mask
+		const int stride = 8 + (int)(bench_random(state) % 64);
+		const int amplitude = 1 << (bench_random(state) % 9);
+		const int base = (int)(bench_random(state) % 256);
+
+		for (int i = 0; i < stride * 8; ++i)
+			src[i] = (unsigned char)(base + (int)(bench_random(state) % amplitude));
+
+		float divisors[64];
+		for (int i = 0; i < 64; ++i)
+			divisors[i] = (float)(1.0 / ((1 + (bench_random(state) % 255)) * 8.0));
+
+		uint64_t masks[2];
+		for (int t = 0; t < 2; ++t)
+			masks[t] = tables[t]->fdct_8x8(src, stride, divisors, (int16_t*)outputs[t]);
+
+		return masks[0] == masks[1] && memcmp(outputs[0], outputs[1], sizeof(outputs[0])) == 0;
+	}
+
+	const int sad_length = 1 + (int)(bench_random(state) % BENCH_VERIFY_ROW_LENGTH);
+
+	if (kernel == BENCH_KERNEL_REVERSE_ROWS_YUV420)
+		pixel_count = (pixel_count + 1) & ~1;
+
+	for (int t = 0; t < 2; ++t)
+	{
+		unsigned char* dst[4];
+		for (int i = 0; i < 4; ++i)
+			dst[i] = (unsigned char*)outputs[t][i];
+
+		switch (kernel)
+		{
+		case BENCH_KERNEL_REVERSE_ROW_8: tables[t]->reverse_row_8(src, dst[0], pixel_count);
+			break;
+		case BENCH_KERNEL_REVERSE_ROW_UV: tables[t]->reverse_row_uv(src, dst[0], dst[1], pixel_count);
+			break;
+		case BENCH_KERNEL_REVERSE_ROW_24: tables[t]->reverse_row_24(src, dst[0], pixel_count);
+			break;
+		case BENCH_KERNEL_REVERSE_ROW_32: tables[t]->reverse_row_32(src, dst[0], pixel_count);
+			break;
+		case BENCH_KERNEL_REVERSE_ROWS_YUV420:
+			for (int format = 0; format < SCDK_KERNELS_RGB_FORMAT_COUNT; ++format)
+			{
+				tables[t]->reverse_rows_yuv420[format](src, src + BENCH_VERIFY_ROW_LENGTH, dst[0], dst[1], dst[2],
+				                                       dst[3], pixel_count);
+			}
+			break;
+		case BENCH_KERNEL_SAD_ROW_16:
+			tables[t]->sad_row_16(src, src + BENCH_VERIFY_ROW_LENGTH, sad_length, (uint32_t*)dst[0]);
+			break;
+		default:
+			break;
+		}
+	}
+
+	return memcmp(outputs[0], outputs[1], sizeof(outputs[0])) == 0;
+}
+
+// Checks every kernel selected for this CPU against the scalar reference, which they must match exactly
+static bool bench_verify_kernels(void)
+{
+	const scdk_kernels_t* kernels = scdk_get_kernels();
+	const scdk_kernels_t* reference = scdk_get_reference_kernels();
+	uint32_t state = 0x9E3779B9u;
+	bool is_success = true;
+
+	printf("{\n");
+	printf("\t\"kernels\": \"%s\",\n", kernels->name);
+	printf("\t\"reference\": \"%s\",\n", reference->name);
+	printf("\t\"matches\": {\n");
+
+	for (int kernel = 0; kernel < BENCH_KERNEL_COUNT; ++kernel)
+	{
+		bool is_match = true;
+
+		for (int iteration = 0; iteration < BENCH_VERIFY_ITERATION_COUNT && is_match; ++iteration)
+			is_match = bench_verify_kernel(kernels, reference, kernel, &state);
+
+		printf("\t\t\"%s\": %s%s\n", bench_kernel_names[kernel], is_match ? "true" : "false",
+		       kernel == BENCH_KERNEL_COUNT - 1 ? "" : ",");
+
+		is_success = is_success && is_match;
+	}
+
+	printf("\t}\n}\n");
+
+	return is_success;
+}
+
+static bool bench_run(const bench_options_t* options, int device_index, scdk_pixel_format_e pixel_format,
+                      bench_workload_e workload, bool is_first_result)
+{
+	scdk_virtual_device_config_t config;
+	memset(&config, 0, sizeof(config));
+	config.device_type = bench_devices[device_index].device_type;
+	config.bandwidth_bytes_per_second = options->bandwidth_bytes_per_second;
+	config.is_decoding_enabled = options->is_validation_enabled;
+
+	scdk_device_t device = NULL;
+	if (!scdk_open_virtual(&device, &config))
+		return false;
+
+	scdk_set_encoder_thread_count(device, options->encoder_thread_count);
+	scdk_set_planar_encoding(device, options->is_planar_encoding_enabled);
+	scdk_set_jpeg_encoder(device, options->jpeg_encoder);
+
+	if (options->target_frames_per_second > 0 || options->target_bytes_per_second > 0)
+	{
+		const scdk_rate_control_config_t rate_control_config =
+		{
+			options->target_frames_per_second, options->target_bytes_per_second, 30, 10
+		};
+
+		scdk_set_rate_control(device, &rate_control_config);
+	}
+
+	if (options->is_scheduler_enabled)
+	{
+		const scdk_update_scheduler_config_t scheduler_config = { SCDK_UPDATE_PRIORITY_NORMAL, { 0, 0, 0 } };
+		scdk_set_update_scheduler(device, &scheduler_config);
+	}
+
+	if (options->block_sad_threshold > 0)
+	{
+		const scdk_change_tolerance_config_t change_tolerance_config = { options->block_sad_threshold, 30 };
+		scdk_set_change_tolerance(device, &change_tolerance_config);
+	}
+
+	scdk_jpeg_cache_t cache = NULL;
+	if (options->jpeg_cache_path)
+	{
+		cache = scdk_jpeg_cache_create_persistent(options->jpeg_cache_path, options->jpeg_cache_size_bytes,
+		                                          BENCH_JPEG_CACHE_FILE_SIZE_BYTES);
+		if (cache == NULL)
+		{
+			fprintf(stderr, "failed to open JPEG cache file %s\n", options->jpeg_cache_path);
+			scdk_free(device);
+			return false;
+		}
+
+		scdk_set_jpeg_cache(device, cache);
+	}
+	else if (options->jpeg_cache_size_bytes > 0)
+	{
+		cache = scdk_jpeg_cache_create(options->jpeg_cache_size_bytes);
+		scdk_set_jpeg_cache(device, cache);
+	}
+
+	const scdk_device_type_info_t* type_info = scdk_get_device_type_info(device);
+	const size_t pixel_count = (size_t)type_info->image_width * type_info->image_height;
+
+	unsigned char* rgb = malloc(pixel_count * 3);
+	unsigned char* image = malloc(pixel_count * 4);
+	unsigned char* decoded = malloc(pixel_count * 3);
+	if (rgb == NULL || image == NULL || decoded == NULL)
+		abort();
+
+	bool is_success = true;
+	uint64_t elapsed_ns = 0;
+	int max_error = 0;
+	double max_mean_error = 0.0;
+
+	for (int frame_index = 0; frame_index < options->frame_count && is_success; ++frame_index)
+	{
+		// Only the first static frame differs from what the device already shows
+		if (workload != BENCH_WORKLOAD_STATIC || frame_index == 0)
+		{
+			bench_render_frame(type_info, workload, frame_index, rgb);
+			bench_convert_frame(type_info, rgb, pixel_format, image);
+		}
+
+		const uint64_t start_ns = bench_time_now_ns();
+		is_success = scdk_set_image(device, image, pixel_format, options->quality_percentage);
+		elapsed_ns += bench_time_now_ns() - start_ns;
+
+		if (options->is_validation_enabled && is_success)
+		{
+			int frame_max_error;
+			double frame_mean_error;
+
+			is_success = scdk_virtual_get_framebuffer(device, decoded, pixel_count * 3);
+			bench_compare_frame(type_info, rgb, decoded, &frame_max_error, &frame_mean_error);
+
+			max_error = BENCH_MAX(max_error, frame_max_error);
+			max_mean_error = BENCH_MAX(max_mean_error, frame_mean_error);
+		}
+	}
+
+	scdk_stats_t stats;
+	scdk_virtual_device_stats_t virtual_stats;
+	scdk_get_stats(device, &stats);
+	scdk_virtual_get_stats(device, &virtual_stats);
+
+	if (options->is_validation_enabled && (virtual_stats.decode_error_count > 0
+	                                       || max_mean_error > BENCH_VALIDATE_MAX_MEAN_ERROR))
+		is_success = false;
+
+	const double seconds = (double)elapsed_ns / 1e9;
+
+	printf("%s\t\t{\n", is_first_result ? "" : ",\n");
+	printf("\t\t\t\"device\": \"%s\",\n", bench_devices[device_index].name);
+	printf("\t\t\t\"pixel_format\": \"%s\",\n", bench_pixel_format_names[pixel_format]);
+	printf("\t\t\t\"workload\": \"%s\",\n", bench_workload_names[workload]);
+	printf("\t\t\t\"success\": %s,\n", is_success ? "true" : "false");
+	printf("\t\t\t\"frames\": %d,\n", options->frame_count);
+	printf("\t\t\t\"seconds\": %.6f,\n", seconds);
+	printf("\t\t\t\"fps\": %.2f,\n", seconds > 0 ? options->frame_count / seconds : 0.0);
+	printf("\t\t\t\"reports\": %llu,\n", (unsigned long long)virtual_stats.report_count);
+	printf("\t\t\t\"key_images\": %llu,\n", (unsigned long long)virtual_stats.key_image_count);
+	printf("\t\t\t\"jpeg_bytes\": %llu,\n", (unsigned long long)virtual_stats.key_image_bytes);
+	printf("\t\t\t\"jpeg_bytes_per_key\": %.1f,\n", virtual_stats.key_image_count > 0
+		? (double)virtual_stats.key_image_bytes / (double)virtual_stats.key_image_count : 0.0);
+	printf("\t\t\t\"keys_encoded\": %llu,\n", (unsigned long long)stats.keys_encoded);
+	printf("\t\t\t\"keys_skipped\": %llu,\n", (unsigned long long)stats.keys_skipped);
+	printf("\t\t\t\"keys_within_tolerance\": %llu,\n", (unsigned long long)stats.keys_within_tolerance);
+	printf("\t\t\t\"keys_refined\": %llu,\n", (unsigned long long)stats.keys_refined);
+	printf("\t\t\t\"protocol_errors\": %llu,\n", (unsigned long long)virtual_stats.protocol_error_count);
+
+	if (options->is_validation_enabled)
+	{
+		printf("\t\t\t\"decode_errors\": %llu,\n", (unsigned long long)virtual_stats.decode_error_count);
+		printf("\t\t\t\"max_error\": %d,\n", max_error);
+		printf("\t\t\t\"max_mean_error\": %.3f,\n", max_mean_error);
+	}
+
+	printf("\t\t\t\"stages\": {\n");
+
+	for (int stage = 0; stage < SCDK_STAGE_COUNT; ++stage)
+	{
+		const scdk_stage_stats_t* stage_stats = stats.stages + stage;
+
+		printf("\t\t\t\t\"%s\": { \"count\": %llu, \"total_us\": %.3f, \"mean_us\": %.3f, \"p99_us\": %.3f, "
+		       "\"max_us\": %.3f }%s\n",
+		       bench_stage_names[stage], (unsigned long long)stage_stats->count, stage_stats->total_ns / 1e3,
+		       stage_stats->count > 0 ? (stage_stats->total_ns / 1e3) / stage_stats->count : 0.0,
+		       bench_percentile_us(stage_stats, 0.99), stage_stats->max_ns / 1e3,
+		       stage == SCDK_STAGE_COUNT - 1 ? "" : ",");
+	}
+
+	printf("\t\t\t}\n\t\t}");
+
+	free(rgb);
+	free(image);
+	free(decoded);
+	scdk_free(device);
+	scdk_jpeg_cache_free(cache);
+
+	return is_success;
+}
+
+static void bench_print_usage(const char* program)
+{
+	fprintf(stderr,
+	        "Usage: %s [options]\n"
+	        "  --frames N        frames per workload (default 60)\n"
+	        "  --quality N       JPEG quality percentage (default 90)\n"
+	        "  --threads N       encoder threads, 0 encodes on the calling thread (default 0)\n"
+	        "  --planar          enable planar encoding\n"
+	        "  --scheduler       write keys through the update scheduler\n"
+	        "  --validate        decode what the virtual device receives and compare it with each frame\n"
+	        "  --verify-kernels  check the SIMD kernels against the scalar reference and exit\n"
+	        "  --cache-mb N      attach a JPEG cache of N MiB (default none)\n"
+	        "  --cache-file PATH back the JPEG cache with a persistent file of 64 MiB\n"
+	        "  --bandwidth N     simulate a link of N bytes per second (default unlimited)\n"
+	        "  --target-fps N    enable rate control targeting N frames per second\n"
+	        "  --target-bps N    enable rate control targeting N JPEG bytes per second\n"
+	        "  --tolerance N     hold back keys whose 16x8 blocks differ by a SAD of at most N\n"
+	        "  --encoder NAME    JPEG encoder, turbojpeg or builtin (default turbojpeg)\n"
+	        "  --device NAME     only run one device type\n"
+	        "  --format NAME     only run one pixel format\n"
+	        "  --workload NAME   only run one workload\n",
+	        program);
+}
+
+static int bench_find_name(const char* const* names, int name_count, const char* name)
+{
+	for (int i = 0; i < name_count; ++i)
+	{
+		if (strcmp(names[i], name) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+int main(int argc, char* argv[])
+{
+	bench_options_t options = { 60, 90, 0, false, false, false, 0, NULL, 0, 0, 0, 0, SCDK_JPEG_ENCODER_TURBOJPEG };
+	int device_filter = -1;
+	int jpeg_encoder = SCDK_JPEG_ENCODER_TURBOJPEG;
+	int pixel_format_filter = -1;
+	int workload_filter = -1;
+
+	const int device_count = (int)(sizeof(bench_devices) / sizeof(bench_devices[0]));
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (strcmp(argv[i], "--planar") == 0)
+		{
+			options.is_planar_encoding_enabled = true;
+			continue;
+		}
+
+		if (strcmp(argv[i], "--scheduler") == 0)
+		{
+			options.is_scheduler_enabled = true;
+			continue;
+		}
+
+		if (strcmp(argv[i], "--validate") == 0)
+		{
+			options.is_validation_enabled = true;
+			continue;
+		}
+
+		if (strcmp(argv[i], "--verify-kernels") == 0)
+			return bench_verify_kernels() ? 0 : 1;
+
+		if (value == NULL)
+		{
+			bench_print_usage(argv[0]);
+			return 1;
+		}
+
+		++i;
+
+		if (strcmp(argv[i - 1], "--frames") == 0)
+			options.frame_count = atoi(value);
+		else if (strcmp(argv[i - 1], "--quality") == 0)
+			options.quality_percentage = atoi(value);
+		else if (strcmp(argv[i - 1], "--threads") == 0)
+			options.encoder_thread_count = atoi(value);
+		else if (strcmp(argv[i - 1], "--cache-mb") == 0)
+			options.jpeg_cache_size_bytes = (size_t)atoi(value) * 1024 * 1024;
+		else if (strcmp(argv[i - 1], "--cache-file") == 0)
+			options.jpeg_cache_path = value;
+		else if (strcmp(argv[i - 1], "--bandwidth") == 0)
+			options.bandwidth_bytes_per_second = atoi(value);
+		else if (strcmp(argv[i - 1], "--target-fps") == 0)
+			options.target_frames_per_second = atoi(value);
+		else if (strcmp(argv[i - 1], "--target-bps") == 0)
+			options.target_bytes_per_second = atoi(value);
+		else if (strcmp(argv[i - 1], "--tolerance") == 0)
+			options.block_sad_threshold = atoi(value);
+		else if (strcmp(argv[i - 1], "--encoder") == 0)
+			jpeg_encoder = bench_find_name(bench_jpeg_encoder_names, BENCH_JPEG_ENCODER_COUNT, value);
+		else if (strcmp(argv[i - 1], "--format") == 0)
+			pixel_format_filter = bench_find_name(bench_pixel_format_names, BENCH_PIXEL_FORMAT_COUNT, value);
+		else if (strcmp(argv[i - 1], "--workload") == 0)
+			workload_filter = bench_find_name(bench_workload_names, BENCH_WORKLOAD_COUNT, value);
+		else if (strcmp(argv[i - 1], "--device") == 0)
+		{
+			for (int device_index = 0; device_index < device_count; ++device_index)
+			{
+				if (strcmp(bench_devices[device_index].name, value) == 0)
+					device_filter = device_index;
+			}
+
+			if (device_filter == -1)
+			{
+				bench_print_usage(argv[0]);
+				return 1;
+			}
+		}
+		else
+		{
+			bench_print_usage(argv[0]);
+			return 1;
+		}
+
+		if ((strcmp(argv[i - 1], "--format") == 0 && pixel_format_filter == -1)
+		    || (strcmp(argv[i - 1], "--workload") == 0 && workload_filter == -1)
+		    || jpeg_encoder == -1)
+		{
+			bench_print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	options.jpeg_encoder = (scdk_jpeg_encoder_e)jpeg_encoder;
+
+	if (options.frame_count <= 0)
+	{
+		bench_print_usage(argv[0]);
+		return 1;
+	}
+
+	bool is_success = true;
+	bool is_first_result = true;
+
+	printf("{\n");
+	printf("\t\"quality\": %d,\n", options.quality_percentage);
+	printf("\t\"encoder_threads\": %d,\n", options.encoder_thread_count);
+	printf("\t\"jpeg_encoder\": \"%s\",\n", bench_jpeg_encoder_names[options.jpeg_encoder]);
+	printf("\t\"planar_encoding\": %s,\n", options.is_planar_encoding_enabled ? "true" : "false");
+	printf("\t\"scheduler\": %s,\n", options.is_scheduler_enabled ? "true" : "false");
+	printf("\t\"validate\": %s,\n", options.is_validation_enabled ? "true" : "false");
+	printf("\t\"jpeg_cache_bytes\": %zu,\n", options.jpeg_cache_size_bytes);
+	printf("\t\"bandwidth\": %d,\n", options.bandwidth_bytes_per_second);
+	printf("\t\"target_fps\": %d,\n", options.target_frames_per_second);
+	printf("\t\"target_bps\": %d,\n", options.target_bytes_per_second);
+	printf("\t\"results\": [\n");
+
+	for (int device_index = 0; device_index < device_count; ++device_index)
+	{
+		if (device_filter != -1 && device_index != device_filter)
+			continue;
+
+		for (int pixel_format = 0; pixel_format < BENCH_PIXEL_FORMAT_COUNT; ++pixel_format)
+		{
+			if (pixel_format_filter != -1 && pixel_format != pixel_format_filter)
+				continue;
+
+			for (int workload = 0; workload < BENCH_WORKLOAD_COUNT; ++workload)
+			{
+				if (workload_filter != -1 && workload != workload_filter)
+					continue;
+
+				if (!bench_run(&options, device_index, pixel_format, workload, is_first_result))
+					is_success = false;
+
+				is_first_result = false;
+			}
+		}
+	}
+
+	printf("\n\t]\n}\n");
+
+	return is_success ? 0 : 1;
+}
@@ -3,6 +3,26 @@
 #include <stdlib.h>
 #include <turbojpeg.h>
 
+static void key_event_callback(scdk_device_t device, const scdk_key_event_t* event, void* user_data)
+{
+	(void)device;
+	(void)user_data;
+
+	switch (event->type)
+	{
+	case SCDK_KEY_EVENT_TYPE_DOWN: printf("Key %d down\n", event->key_index);
+		break;
+	case SCDK_KEY_EVENT_TYPE_UP: printf("Key %d up\n", event->key_index);
+		break;
+	case SCDK_KEY_EVENT_TYPE_LONG_PRESS: printf("Key %d long press\n", event->key_index);
+		break;
+	case SCDK_KEY_EVENT_TYPE_REPEAT: printf("Key %d repeat\n", event->key_index);
+		break;
+	case SCDK_KEY_EVENT_TYPE_DISCONNECTED: printf("Device disconnected\n");
+		break;
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	scdk_device_t device = NULL;
@@ -52,33 +72,19 @@ int main(int argc, char* argv[])
 
 	scdk_set_image(device, buffer, SCDK_PIXEL_FORMAT_RGB, 100);
 
-	bool* keys = (bool*)calloc(type_info->columns * type_info->rows, sizeof(bool));
-	bool* keys_buffer = (bool*)calloc(type_info->columns * type_info->rows, sizeof(bool));
-	while(true)
+	const scdk_input_config_t input_config = { 20, 500, 100 };
+	scdk_set_input_config(device, &input_config);
+
+	if (!scdk_start_input(device, key_event_callback, NULL))
 	{
-		const int key_result = scdk_read_key_timeout(device, keys_buffer, type_info->columns * type_info->rows, 1000 / 60);
-		if (key_result == -1)
-		{
-			break;
-		}
-		else if (key_result == 0)
-		{
-			for(int i = 0; i < type_info->columns * type_info->rows; ++i)
-			{
-				if (keys[i] != keys_buffer[i])
-				{
-					if (keys[i])
-						printf("Key %d down\n", i);
-					else
-						printf("Key %d up\n", i);
-
-					keys[i] = keys_buffer[i];
-				}
-			}
-		}
+		printf("Failed to start key input\n");
+		scdk_free(device);
+		free(buffer);
+		return -1;
 	}
-	free(keys);
-	free(keys_buffer);
+
+	printf("Press enter to exit\n");
+	getchar();
 
 	scdk_free(device);
 
@@ -2,6 +2,7 @@
 #define SCREAMDECK_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <wchar.h>
 
 #ifdef screamdeck_EXPORTS
@@ -55,6 +56,16 @@ typedef struct scdk_device_type_info_t
 
 typedef void* scdk_device_t;
 
+typedef void* scdk_jpeg_cache_t;
+
+typedef void* scdk_manager_t;
+
+typedef void* scdk_canvas_t;
+
+typedef void* scdk_animation_t;
+
+typedef void* scdk_animator_t;
+
 typedef enum scdk_pixel_format_e
 {
 	SCDK_PIXEL_FORMAT_RGB = 0,
@@ -68,8 +79,257 @@ typedef enum scdk_pixel_format_e
 	SCDK_PIXEL_FORMAT_ABGR = 8,
 	SCDK_PIXEL_FORMAT_ARGB = 9,
 
+	// 8-bit planar YCbCr 4:2:0 (full range BT.601, as used by JPEG). I420 is a Y plane followed by Cb and Cr planes of
+	// half width and height; NV12 is a Y plane followed by one half height plane of interleaved Cb/Cr pairs.
+	SCDK_PIXEL_FORMAT_I420 = 10,
+	SCDK_PIXEL_FORMAT_NV12 = 11,
+
 } scdk_pixel_format_e;
 
+typedef enum scdk_jpeg_encoder_e
+{
+	// libjpeg-turbo's tjCompress2
+	SCDK_JPEG_ENCODER_TURBOJPEG = 0,
+
+	// A baseline encoder specialized for key tiles, with headers and tables prepared once per quality
+	SCDK_JPEG_ENCODER_BUILTIN = 1,
+
+} scdk_jpeg_encoder_e;
+
+typedef struct scdk_rect_t
+{
+	int x;
+	int y;
+	int width;
+	int height;
+
+} scdk_rect_t;
+
+typedef struct scdk_jpeg_cache_stats_t
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t entry_count;
+	size_t size_bytes;
+	size_t max_size_bytes;
+
+	// For persistent caches, the hits that missed memory and were read from the file, and the JPEG bytes the file
+	// holds out of its capacity
+	uint64_t file_hits;
+	size_t file_size_bytes;
+	size_t max_file_size_bytes;
+
+} scdk_jpeg_cache_stats_t;
+
+typedef enum scdk_frame_status_e
+{
+	SCDK_FRAME_STATUS_SENT = 0,
+	SCDK_FRAME_STATUS_DROPPED = 1,
+	SCDK_FRAME_STATUS_FAILED = 2,
+
+} scdk_frame_status_e;
+
+typedef void (*scdk_frame_callback_t)(scdk_device_t device, uint64_t frame_id, scdk_frame_status_e status,
+	void* user_data);
+
+typedef struct scdk_rate_control_config_t
+{
+	// Budgets to keep within. Either may be 0 to leave it unconstrained.
+	int target_frames_per_second;
+	int target_bytes_per_second;
+
+	// Lowest quality changed keys may drop to under load. The quality passed with each image is the highest.
+	int min_quality_percentage;
+
+	// Frames a key must stay unchanged before it is re-sent at full quality
+	int refine_frame_count;
+
+} scdk_rate_control_config_t;
+
+typedef struct scdk_change_tolerance_config_t
+{
+	// Changed keys are compared with the key as last sent in blocks of 16 bytes by 8 rows of each plane they are
+	// encoded from, and are only sent once the sum of absolute differences of some block exceeds the threshold
+	int block_sad_threshold;
+
+	// Keys held back as within tolerance for this many frames are sent anyway, so small differences don't linger.
+	// 0 never forces them.
+	int refresh_frame_count;
+
+} scdk_change_tolerance_config_t;
+
+typedef enum scdk_update_priority_e
+{
+	// Feedback to user input, such as highlighting a pressed key
+	SCDK_UPDATE_PRIORITY_INTERACTIVE = 0,
+	SCDK_UPDATE_PRIORITY_NORMAL = 1,
+
+	// Bulk redraws that can wait for everything else
+	SCDK_UPDATE_PRIORITY_BACKGROUND = 2,
+	SCDK_UPDATE_PRIORITY_COUNT
+
+} scdk_update_priority_e;
+
+typedef struct scdk_update_scheduler_config_t
+{
+	// Class of the keys sent by image calls: scdk_set_image*, scdk_set_image_region, scdk_set_key_jpeg and
+	// scdk_set_image_jpeg
+	scdk_update_priority_e image_priority;
+
+	// Time after submission each class's keys should be written by. Keys of a class are written earliest deadline
+	// first, and background keys past their deadline are written as normal ones so they are never starved, but never
+	// ahead of interactive keys. 0 leaves a class without deadlines, written in the order submitted.
+	int deadline_ms[SCDK_UPDATE_PRIORITY_COUNT];
+
+} scdk_update_scheduler_config_t;
+
+typedef enum scdk_key_event_type_e
+{
+	SCDK_KEY_EVENT_TYPE_DOWN = 0,
+	SCDK_KEY_EVENT_TYPE_UP = 1,
+
+	// Sent once a key has been held for the long press time, then every repeat interval for as long as it stays down
+	SCDK_KEY_EVENT_TYPE_LONG_PRESS = 2,
+	SCDK_KEY_EVENT_TYPE_REPEAT = 3,
+
+	// Sent with a key_index of -1 when reading from the device fails, usually because it was unplugged. It is the last
+	// event the input thread sends.
+	SCDK_KEY_EVENT_TYPE_DISCONNECTED = 4,
+
+} scdk_key_event_type_e;
+
+typedef struct scdk_key_event_t
+{
+	int key_index;
+	bool is_pressed;
+	uint64_t timestamp_us;
+	scdk_key_event_type_e type;
+
+} scdk_key_event_t;
+
+// All times are in milliseconds and may be 0 to disable the feature
+typedef struct scdk_input_config_t
+{
+	// Once a key changes state, changes within the debounce time are taken as contact bounce. A change still in effect
+	// when the time is up is reported then.
+	int debounce_ms;
+
+	int long_press_ms;
+
+	// Repeats only start after a long press
+	int repeat_interval_ms;
+
+} scdk_input_config_t;
+
+typedef void (*scdk_key_event_callback_t)(scdk_device_t device, const scdk_key_event_t* event, void* user_data);
+
+typedef struct scdk_virtual_device_config_t
+{
+	scdk_device_type_e device_type;
+
+	// Serial number the device reports, copied when it is opened. When NULL, each device gets a unique one.
+	const wchar_t* serial_number;
+
+	// Simulated USB cost of every report written: a fixed latency plus the time to move the report at the given
+	// bandwidth, which is unlimited when 0
+	int write_latency_us;
+	int bandwidth_bytes_per_second;
+
+	// When false, key images are reassembled and counted but not decoded into the framebuffer
+	bool is_decoding_enabled;
+
+} scdk_virtual_device_config_t;
+
+typedef struct scdk_virtual_device_stats_t
+{
+	uint64_t report_count;
+	uint64_t report_bytes;
+	uint64_t key_image_count;
+	uint64_t key_image_bytes;
+	uint64_t protocol_error_count;
+	uint64_t decode_error_count;
+	uint64_t feature_report_count;
+	int brightness_percentage;
+
+} scdk_virtual_device_stats_t;
+
+// Stages a key image passes through on its way to the device. Extraction, hashing, encoding and packetization are timed
+// once per key, writing once per report.
+typedef enum scdk_stage_e
+{
+	SCDK_STAGE_EXTRACT = 0,
+	SCDK_STAGE_HASH = 1,
+	SCDK_STAGE_ENCODE = 2,
+	SCDK_STAGE_PACKETIZE = 3,
+	SCDK_STAGE_WRITE = 4,
+	SCDK_STAGE_COUNT
+
+} scdk_stage_e;
+
+#define SCDK_STATS_HISTOGRAM_BUCKET_COUNT 32
+
+// Bucket i of the latency histogram counts durations in [2^i, 2^(i+1)) nanoseconds; the first bucket also counts zero
+// and the last everything longer
+typedef struct scdk_stage_stats_t
+{
+	uint64_t count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t histogram[SCDK_STATS_HISTOGRAM_BUCKET_COUNT];
+
+} scdk_stage_stats_t;
+
+typedef struct scdk_stats_t
+{
+	// Calls that send a whole panel: scdk_set_image*, scdk_set_image_region and scdk_set_image_jpeg
+	uint64_t frames_submitted;
+	uint64_t keys_skipped;
+	uint64_t keys_within_tolerance;
+	uint64_t keys_encoded;
+	uint64_t keys_refined;
+	uint64_t jpeg_bytes;
+	uint64_t reports_written;
+	uint64_t write_failures;
+	uint64_t write_retries;
+
+	scdk_stage_stats_t stages[SCDK_STAGE_COUNT];
+
+} scdk_stats_t;
+
+typedef struct scdk_animator_stats_t
+{
+	uint64_t frames_sent;
+	// Frames skipped because a later frame was already due when the key came to be updated
+	uint64_t frames_dropped;
+	uint64_t send_failures;
+
+} scdk_animator_stats_t;
+
+// Called on the manager's monitor thread when a device is opened or is about to be closed after being removed. The
+// device handle is valid until the callback reporting its removal returns.
+typedef void (*scdk_manager_callback_t)(scdk_manager_t manager, const scdk_device_info_t* device_info,
+	scdk_device_t device, bool is_connected, void* user_data);
+
+// Threading model
+//
+// A device may be used from several threads at once without external locking. Each device has three independent
+// paths with their own buffers and lock, and a call only ever waits for other calls on the same path:
+//
+//   image output     scdk_set_image*, scdk_set_key_*, and the encoding, cache and validation settings
+//   feature reports  scdk_set_brightness, scdk_set_screensaver, scdk_get_serial_number
+//   input            scdk_read_key, scdk_read_key_timeout, and the input thread started by scdk_start_input
+//
+// Image calls on one device run one at a time, so a multi-report upload is never interleaved with another, while
+// brightness changes and key reads proceed alongside it. scdk_submit_image_async only waits for the frame copy.
+// While the update scheduler is enabled, scdk_set_key_image and scdk_set_key_image_priority leave the image path: keys
+// are encoded without waiting for image calls in progress, and uploads of different keys are interleaved a report at
+// a time.
+// Different devices share no state apart from an explicitly shared JPEG cache, which has its own lock.
+//
+// scdk_free must not race with any other call on the same device. Callbacks must not call scdk_free, scdk_start_input,
+// scdk_stop_input or scdk_wait_frame on the device that invoked them.
+
 DLL_API const scdk_device_type_info_t* scdk_get_device_type_info_from_type(scdk_device_type_e device_type);
 
 DLL_API scdk_device_info_t* scdk_enumerate(void);
@@ -80,6 +340,19 @@ DLL_API bool scdk_open(scdk_device_t* p_device, scdk_device_type_e device_type,
 
 DLL_API bool scdk_open_first(scdk_device_t* p_device, scdk_device_type_e device_type);
 
+// Opens an in-process virtual device that behaves like the given device type without any hardware attached. It
+// reassembles and decodes the image reports it receives into a framebuffer and can be sent simulated key presses, for
+// testing and benchmarking.
+DLL_API bool scdk_open_virtual(scdk_device_t* p_device, const scdk_virtual_device_config_t* config);
+
+// Changes the state of a key on a virtual device, which is then reported to readers like a physical key press
+DLL_API bool scdk_virtual_press_key(scdk_device_t device, int key_index, bool is_pressed);
+
+// Copies what a virtual device displays as RGB, in the same layout and orientation as images passed to scdk_set_image
+DLL_API bool scdk_virtual_get_framebuffer(scdk_device_t device, unsigned char* image_buffer, size_t image_buffer_length);
+
+DLL_API bool scdk_virtual_get_stats(scdk_device_t device, scdk_virtual_device_stats_t* stats);
+
 DLL_API void scdk_free(scdk_device_t device);
 
 DLL_API const scdk_device_type_info_t* scdk_get_device_type_info(scdk_device_t device);
@@ -90,6 +363,27 @@ DLL_API int scdk_read_key(scdk_device_t device, bool* key_state_buffer, size_t k
 
 DLL_API int scdk_read_key_timeout(scdk_device_t device, bool* key_state_buffer, size_t key_state_buffer_length, int timeout_ms);
 
+// Starts a thread that owns reading key input from the device and turns reports into press/release events stamped with
+// a monotonic clock in microseconds, independently of image uploads on other threads. Events are passed to callback on
+// the input thread, or queued for scdk_poll_key_events if callback is NULL. Calling again replaces the callback, or
+// restarts the thread if it stopped after a disconnected event. scdk_read_key and scdk_read_key_timeout fail while
+// input is running.
+DLL_API bool scdk_start_input(scdk_device_t device, scdk_key_event_callback_t callback, void* user_data);
+
+DLL_API void scdk_stop_input(scdk_device_t device);
+
+// Sets debouncing, long press and repeat detection for the input thread, taking effect immediately if it is running
+DLL_API bool scdk_set_input_config(scdk_device_t device, const scdk_input_config_t* config);
+
+// Dequeues up to max_event_count events in the order they occurred, returning the number dequeued. If more than 256
+// events are left unread the oldest are dropped.
+DLL_API size_t scdk_poll_key_events(scdk_device_t device, scdk_key_event_t* events, size_t max_event_count);
+
+// Returns a file descriptor, suitable for poll/epoll, that is readable while queued events are waiting, and from then
+// on once the input thread has stopped after a disconnected event. Never read it directly; it is drained by
+// scdk_poll_key_events. Returns -1 if input is not running, or on Windows.
+DLL_API int scdk_get_input_fd(scdk_device_t device);
+
 DLL_API bool scdk_set_image(scdk_device_t device, const unsigned char* image_buffer, 
 	scdk_pixel_format_e pixel_format, int quality_percentage);
 
@@ -99,9 +393,201 @@ DLL_API bool scdk_set_image_24(scdk_device_t device, const unsigned char* image_
 DLL_API bool scdk_set_image_32(scdk_device_t device, const unsigned char* image_buffer, 
 	scdk_pixel_format_e pixel_format, int quality_percentage);
 
+// Slices each key's planes straight out of an I420 or NV12 panel image and encodes them without any RGB conversion
+DLL_API bool scdk_set_image_yuv(scdk_device_t device, const unsigned char* image_buffer,
+	scdk_pixel_format_e pixel_format, int quality_percentage);
+
+// Like scdk_set_image, but only keys overlapping the damaged rectangles (in panel coordinates) are extracted, hashed
+// and sent. Rectangles covering only the gaps between keys touch no keys.
+DLL_API bool scdk_set_image_region(scdk_device_t device, const unsigned char* image_buffer,
+	scdk_pixel_format_e pixel_format, int quality_percentage, const scdk_rect_t* damage_rects, size_t damage_rect_count);
+
+// Computes the hash of every key of a panel image, indexed by key_x + (key_y * columns), as used to skip unchanged keys.
+// Each key is hashed straight from its rows in the image, so this costs one read of the panel.
+DLL_API bool scdk_compute_key_hashes(scdk_device_t device, const unsigned char* image_buffer,
+	scdk_pixel_format_e pixel_format, uint64_t* key_hashes, size_t key_hash_count);
+
 DLL_API bool scdk_set_key_image(scdk_device_t device, int key_x, int key_y,
 	const unsigned char* image_buffer, scdk_pixel_format_e pixel_format, int quality_percentage);
 
+// Like scdk_set_key_image, which sends at SCDK_UPDATE_PRIORITY_NORMAL, but in the given priority class. The priority
+// only has an effect while the update scheduler is enabled. Returns true once the key has been written, or replaced by
+// a newer upload to the same key.
+DLL_API bool scdk_set_key_image_priority(scdk_device_t device, int key_x, int key_y,
+	const unsigned char* image_buffer, scdk_pixel_format_e pixel_format, int quality_percentage,
+	scdk_update_priority_e priority);
+
+// Sends an already encoded JPEG to a key without re-encoding it. The JPEG must match the key image size and already
+// be rotated to the device orientation, as produced by scdk_set_key_image.
+DLL_API bool scdk_set_key_jpeg(scdk_device_t device, int key_x, int key_y, const unsigned char* jpeg_buffer,
+	size_t jpeg_length);
+
+// Sends one pre-encoded JPEG per key, indexed by key_x + (key_y * columns). Keys with a NULL buffer are left unchanged.
+DLL_API bool scdk_set_image_jpeg(scdk_device_t device, const unsigned char* const* key_jpeg_buffers,
+	const size_t* key_jpeg_lengths);
+
+// When enabled, pre-encoded JPEGs are rejected unless their header parses and their dimensions match the key size
+DLL_API bool scdk_set_jpeg_validation(scdk_device_t device, bool is_enabled);
+
+// When enabled, keys are converted to YCbCr 4:2:0 planes straight from the panel image in the same pass that rotates
+// them, and encoded with tjCompressFromYUVPlanes, instead of being copied to an RGB staging tile first
+DLL_API bool scdk_set_planar_encoding(scdk_device_t device, bool is_enabled);
+
+// Selects the encoder keys are encoded with, SCDK_JPEG_ENCODER_TURBOJPEG by default
+DLL_API bool scdk_set_jpeg_encoder(scdk_device_t device, scdk_jpeg_encoder_e encoder);
+
+DLL_API bool scdk_set_encoder_thread_count(scdk_device_t device, int thread_count);
+
+// Enables rate control for whole panel images, or disables it when config is NULL. Changed keys are encoded at a
+// quality adjusted every frame from the measured send time and encoded bytes, to hold the target frame rate and
+// byte rate, and keys that stop changing are re-sent at the caller's quality once there is headroom again.
+DLL_API bool scdk_set_rate_control(scdk_device_t device, const scdk_rate_control_config_t* config);
+
+// Enables holding back keys whose changes are within a tolerance, such as sensor noise in video, or disables it when
+// config is NULL. Applies to whole panel images, and keeps a copy of every key as last sent to compare against.
+DLL_API bool scdk_set_change_tolerance(scdk_device_t device, const scdk_change_tolerance_config_t* config);
+
+// Enables the update scheduler, or disables it when config is NULL, waiting for keys already queued to be written.
+// A scheduler thread writes every key upload a report at a time, always continuing with the most urgent one pending, so
+// an interactive key waits for at most the report being written and other interactive keys however many keys image
+// calls have queued. An upload still pending for a key is replaced by a newer upload to the same key.
+DLL_API bool scdk_set_update_scheduler(scdk_device_t device, const scdk_update_scheduler_config_t* config);
+
+// Copies the frame into a device-owned back buffer and returns immediately with a non-zero frame id. A background
+// sender thread always transmits the newest pending frame; frames superseded before they are sent are dropped.
+DLL_API uint64_t scdk_submit_image_async(scdk_device_t device, const unsigned char* image_buffer,
+	scdk_pixel_format_e pixel_format, int quality_percentage);
+
+// Called from the sender thread once a frame has been sent or has failed, or from the submitting thread when a
+// pending frame is dropped in favour of a newer one.
+DLL_API bool scdk_set_frame_callback(scdk_device_t device, scdk_frame_callback_t callback, void* user_data);
+
+// Waits until the given frame, or a newer frame that superseded it, has been processed by the sender thread.
+// Returns false on timeout, if that frame or the one that superseded it failed to send, or at once if no frame with
+// that id has been submitted. Outcomes are remembered across the last 16 changes between sent and failed frames;
+// older frames report failure. A negative timeout waits indefinitely.
+DLL_API bool scdk_wait_frame(scdk_device_t device, uint64_t frame_id, int timeout_ms);
+
+// Creates an LRU cache of encoded key images keyed by tile content hash, quality, device type and pixel format,
+// bounded to max_size_bytes including per-entry overhead. A cache may be shared by several devices; each device holds
+// a reference, so scdk_jpeg_cache_free only destroys the cache once no device uses it.
+DLL_API scdk_jpeg_cache_t scdk_jpeg_cache_create(size_t max_size_bytes);
+
+// Creates a cache as scdk_jpeg_cache_create, backed by a memory-mapped file that outlives the process and is shared by
+// every process opening the same path. Keys missing from memory are looked up in the file, and keys encoded by any
+// process are added to it, so a restarted process sends previously encoded keys without encoding them. The file is
+// created max_file_size_bytes long if it doesn't exist, otherwise its existing length is kept; once it is full the
+// oldest keys are overwritten. Returns NULL if the file can't be opened or is too small to hold a cache.
+DLL_API scdk_jpeg_cache_t scdk_jpeg_cache_create_persistent(const char* path, size_t max_size_bytes,
+	size_t max_file_size_bytes);
+
+DLL_API void scdk_jpeg_cache_free(scdk_jpeg_cache_t cache);
+
+// Removes every key from the cache, including the file of a persistent cache
+DLL_API void scdk_jpeg_cache_clear(scdk_jpeg_cache_t cache);
+
+DLL_API bool scdk_jpeg_cache_get_stats(scdk_jpeg_cache_t cache, scdk_jpeg_cache_stats_t* stats);
+
+// Attaches a cache to the device, or detaches it when cache is NULL
+DLL_API bool scdk_set_jpeg_cache(scdk_device_t device, scdk_jpeg_cache_t cache);
+
+// Copies the counters and stage latencies gathered since the device was opened or last reset. Stages run on encoder
+// threads are summed across threads, so with scdk_set_encoder_thread_count the totals can exceed wall time. Statistics
+// are always collected; reading them never waits for an image upload in progress.
+DLL_API bool scdk_get_stats(scdk_device_t device, scdk_stats_t* stats);
+
+DLL_API bool scdk_reset_stats(scdk_device_t device);
+
+// Creates a manager that keeps every attached device open. A monitor thread watches for devices arriving and being
+// removed (through udev on Linux, or by enumerating every few seconds elsewhere) and reopens devices by serial number
+// when they return, restoring the last image and brightness set through the manager. A device that fails a write or
+// read is also reopened at the next scan, which catches one unplugged and plugged back in between scans.
+DLL_API scdk_manager_t scdk_manager_create(scdk_manager_callback_t callback, void* user_data);
+
+// Creates a manager whose devices are attached and detached with scdk_manager_mock_attach and scdk_manager_mock_detach
+// and opened as virtual devices, for testing without hardware
+DLL_API scdk_manager_t scdk_manager_create_mock(scdk_manager_callback_t callback, void* user_data);
+
+DLL_API bool scdk_manager_mock_attach(scdk_manager_t manager, const wchar_t* serial_number,
+	const scdk_virtual_device_config_t* config);
+
+DLL_API bool scdk_manager_mock_detach(scdk_manager_t manager, const wchar_t* serial_number);
+
+DLL_API void scdk_manager_free(scdk_manager_t manager);
+
+// Lists every device the manager has seen, whether or not it is currently attached. Free with scdk_free_enumeration.
+DLL_API scdk_device_info_t* scdk_manager_enumerate(scdk_manager_t manager);
+
+DLL_API bool scdk_manager_is_connected(scdk_manager_t manager, const wchar_t* serial_number);
+
+// Remembers the image for the device and, if it is connected, submits it to the device's own sender thread as with
+// scdk_submit_image_async, so a slow or unplugged device never delays the others. Fails for unknown serial numbers.
+DLL_API bool scdk_manager_set_image(scdk_manager_t manager, const wchar_t* serial_number,
+	const unsigned char* image_buffer, scdk_pixel_format_e pixel_format, int quality_percentage);
+
+DLL_API bool scdk_manager_set_brightness(scdk_manager_t manager, const wchar_t* serial_number,
+	int brightness_percentage);
+
+// Creates an empty canvas for driving several open devices as one image. Devices are placed on a grid of cells, each
+// column as wide as its widest panel and each row as tall as its tallest, with the given gaps between cells to account
+// for the physical bezels. Gaps must be even so planar YUV chroma stays aligned to keys; returns NULL otherwise.
+DLL_API scdk_canvas_t scdk_canvas_create(int bezel_width, int bezel_height);
+
+// Stops the canvas' sender threads. The devices remain open and are still owned by the caller.
+DLL_API void scdk_canvas_free(scdk_canvas_t canvas);
+
+// Places an open device at the top left of a grid cell, growing the canvas. Fails if the device is already on the
+// canvas or the cell is taken. The device must stay open until the canvas is freed.
+DLL_API bool scdk_canvas_add_device(scdk_canvas_t canvas, scdk_device_t device, int column, int row);
+
+// Gets the size of the image expected by scdk_canvas_set_image
+DLL_API bool scdk_canvas_get_size(scdk_canvas_t canvas, int* width, int* height);
+
+// Gets the pixel position of a device's panel within the canvas image
+DLL_API bool scdk_canvas_get_device_position(scdk_canvas_t canvas, scdk_device_t device, int* x, int* y);
+
+// Sends an image the size of the canvas to every device on it in parallel. Keys are read directly from the caller's
+// buffer without copying each device's region, and bezel areas are ignored. Returns once every device has finished,
+// and fails if any of them did.
+DLL_API bool scdk_canvas_set_image(scdk_canvas_t canvas, const unsigned char* image_buffer,
+	scdk_pixel_format_e pixel_format, int quality_percentage);
+
+// Encodes a key animation once for devices of the given type. Each frame is a key image as taken by
+// scdk_set_key_image and is shown for its duration. Identical frames are stored once.
+DLL_API scdk_animation_t scdk_animation_create(scdk_device_type_e device_type, const unsigned char* const* frame_buffers,
+	const int* frame_durations_ms, size_t frame_count, scdk_pixel_format_e pixel_format, int quality_percentage);
+
+// Writes the encoded animation to a file in native byte order, to be reloaded with scdk_animation_load
+DLL_API bool scdk_animation_save(scdk_animation_t animation, const char* path);
+
+// Memory-maps an animation saved with scdk_animation_save, so its frames are paged in only as they are played
+DLL_API scdk_animation_t scdk_animation_load(const char* path);
+
+DLL_API bool scdk_animation_get_info(scdk_animation_t animation, int* frame_count, int* duration_ms);
+
+// Animations can be freed while playing; they are released once the last key playing them stops
+DLL_API void scdk_animation_free(scdk_animation_t animation);
+
+// Creates a player with one scheduler thread that sleeps until the next frame is due on any key of any device, and a
+// sending thread for each animated device, so a device that stalls only delays its own keys. When an update arrives
+// late, frames whose time has passed are dropped so playback keeps to the animation's timeline.
+DLL_API scdk_animator_t scdk_animator_create(void);
+
+DLL_API void scdk_animator_free(scdk_animator_t animator);
+
+// Starts the animation on a key, replacing any animation already playing there. A finished animation that doesn't
+// loop leaves its last frame on the key. The animation must have been created for the device's key size.
+DLL_API bool scdk_animator_play(scdk_animator_t animator, scdk_device_t device, int key_x, int key_y,
+	scdk_animation_t animation, bool is_looping);
+
+DLL_API bool scdk_animator_stop(scdk_animator_t animator, scdk_device_t device, int key_x, int key_y);
+
+// Stops every animation on the device and its sending thread. Call this before freeing a device that has been
+// animated.
+DLL_API bool scdk_animator_stop_device(scdk_animator_t animator, scdk_device_t device);
+
+DLL_API bool scdk_animator_get_stats(scdk_animator_t animator, scdk_animator_stats_t* stats);
+
 DLL_API bool scdk_set_brightness(scdk_device_t device, int brightness_percentage);
 
 DLL_API bool scdk_set_screensaver(scdk_device_t device);
@@ -0,0 +1,836 @@
+#include "scdk_internal.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCDK_ANIMATION_MAGIC "SCDKANI1"
+#define SCDK_ANIMATION_BYTE_ORDER_MARK 0x01020304u
+
+#define SCDK_ANIMATOR_NO_FRAME UINT64_MAX
+
+// A sequence is one contiguous block, identical in memory and on disk: this header, then one entry per frame, then the
+// JPEG data the entries point into. Frames with identical images share their JPEG.
+typedef struct scdk_animation_header_t
+{
+	char magic[8];
+	uint32_t byte_order_mark;
+	uint32_t key_image_width;
+	uint32_t key_image_height;
+	uint32_t frame_count;
+	uint64_t duration_us;
+
+} scdk_animation_header_t;
+
+typedef struct scdk_animation_frame_t
+{
+	uint64_t jpeg_offset;
+	uint32_t jpeg_length;
+	uint32_t duration_us;
+
+} scdk_animation_frame_t;
+
+typedef struct scdk_animation_impl_t
+{
+	const unsigned char* data;
+	size_t length;
+	const scdk_animation_header_t* header;
+	const scdk_animation_frame_t* frames;
+
+	// Time from the start of the sequence at which each frame ends
+	uint64_t* frame_end_us;
+
+	bool is_mapped;
+	scdk_file_map_t file_map;
+
+	scdk_mutex_t mutex;
+	int reference_count;
+
+} scdk_animation_impl_t;
+
+typedef struct scdk_animator_impl_t scdk_animator_impl_t;
+
+// Sends the frames of one device from its own thread, so a device that stalls only drops its own frames
+typedef struct scdk_animator_lane_t
+{
+	scdk_animator_impl_t* animator_impl;
+	scdk_device_impl_t* device_impl;
+	scdk_thread_t thread;
+	scdk_cond_t cond;
+
+	// Keys handed over by the scheduler, which only the lane touches while is_sending is set
+	const unsigned char* key_jpeg_buffers[64];
+	size_t key_jpeg_lengths[64];
+	int frame_count;
+	bool is_sending;
+
+	// Callers waiting for the lane to go idle; the scheduler holds off new sends to it until they have had their turn
+	int waiting_count;
+	bool is_shutdown;
+
+} scdk_animator_lane_t;
+
+typedef struct scdk_animator_track_t
+{
+	scdk_device_impl_t* device_impl;
+	scdk_animator_lane_t* lane;
+	int key_index;
+	scdk_animation_impl_t* animation;
+	bool is_looping;
+	bool is_finished;
+
+	uint64_t start_us;
+	uint64_t deadline_us;
+
+	// Frames shown since the track started, counting every frame of earlier loops, or SCDK_ANIMATOR_NO_FRAME
+	uint64_t shown_position;
+
+} scdk_animator_track_t;
+
+struct scdk_animator_impl_t
+{
+	scdk_thread_t thread;
+	bool is_shutdown;
+
+	// cond wakes the scheduler when tracks change or a lane goes idle; idle_cond wakes callers waiting for a lane
+	scdk_mutex_t mutex;
+	scdk_cond_t cond;
+	scdk_cond_t idle_cond;
+
+	int track_count;
+	int track_capacity;
+	scdk_animator_track_t* tracks;
+
+	// One lane for each device that has been animated, until it is stopped with scdk_animator_stop_device
+	int lane_count;
+	int lane_capacity;
+	scdk_animator_lane_t** lanes;
+
+	scdk_animator_stats_t stats;
+};
+
+static scdk_animation_impl_t* scdk_animation_open(const unsigned char* data, size_t length)
+{
+	const scdk_animation_header_t* header = (const scdk_animation_header_t*)data;
+
+	if (length < sizeof(scdk_animation_header_t) || memcmp(header->magic, SCDK_ANIMATION_MAGIC, 8) != 0
+	    || header->byte_order_mark != SCDK_ANIMATION_BYTE_ORDER_MARK || header->frame_count == 0
+	    || header->frame_count > (length - sizeof(scdk_animation_header_t)) / sizeof(scdk_animation_frame_t))
+		return NULL;
+
+	const scdk_animation_frame_t* frames = (const scdk_animation_frame_t*)(header + 1);
+
+	uint64_t* frame_end_us = malloc(header->frame_count * sizeof(uint64_t));
+	if (frame_end_us == NULL)
+		abort();
+
+	uint64_t duration_us = 0;
+
+	for (uint32_t i = 0; i < header->frame_count; ++i)
+	{
+		if (frames[i].duration_us == 0 || frames[i].jpeg_length == 0 || frames[i].jpeg_offset > length
+		    || frames[i].jpeg_length > length - frames[i].jpeg_offset)
+		{
+			free(frame_end_us);
+			return NULL;
+		}
+
+		duration_us += frames[i].duration_us;
+		frame_end_us[i] = duration_us;
+	}
+
+	if (duration_us != header->duration_us)
+	{
+		free(frame_end_us);
+		return NULL;
+	}
+
+	scdk_animation_impl_t* animation_impl = malloc(sizeof(scdk_animation_impl_t));
+	if (animation_impl == NULL)
+		abort();
+
+	animation_impl->data = data;
+	animation_impl->length = length;
+	animation_impl->header = header;
+	animation_impl->frames = frames;
+	animation_impl->frame_end_us = frame_end_us;
+	animation_impl->is_mapped = false;
+	animation_impl->reference_count = 1;
+	scdk_mutex_init(&animation_impl->mutex);
+
+	return animation_impl;
+}
+
+static scdk_animation_impl_t* scdk_animation_retain(scdk_animation_impl_t* animation_impl)
+{
+	scdk_mutex_lock(&animation_impl->mutex);
+	++animation_impl->reference_count;
+	scdk_mutex_unlock(&animation_impl->mutex);
+
+	return animation_impl;
+}
+
+scdk_animation_t scdk_animation_create(scdk_device_type_e device_type, const unsigned char* const* frame_buffers,
+                                       const int* frame_durations_ms, size_t frame_count,
+                                       scdk_pixel_format_e pixel_format, int quality_percentage)
+{
+	const scdk_device_type_info_t* type_info = scdk_get_device_type_info_from_type(device_type);
+
+	if (type_info == NULL || frame_buffers == NULL || frame_durations_ms == NULL || frame_count == 0
+	    || frame_count > UINT32_MAX || pixel_format < SCDK_PIXEL_FORMAT_RGB || pixel_format > SCDK_PIXEL_FORMAT_NV12)
+		return NULL;
+
+	for (size_t i = 0; i < frame_count; ++i)
+	{
+		if (frame_buffers[i] == NULL || frame_durations_ms[i] <= 0 || frame_durations_ms[i] > (int)(UINT32_MAX / 1000))
+			return NULL;
+	}
+
+	const size_t table_length = sizeof(scdk_animation_header_t) + (frame_count * sizeof(scdk_animation_frame_t));
+	const unsigned long jpeg_capacity = tjBufSize(type_info->key_image_width, type_info->key_image_height, TJSAMP_420);
+
+	size_t capacity = table_length + jpeg_capacity;
+	unsigned char* data = malloc(capacity);
+	unsigned char* src_buffer = malloc((size_t)type_info->key_image_width * type_info->key_image_height * 4);
+	XXH64_hash_t* hashes = malloc(frame_count * sizeof(XXH64_hash_t));
+	if (data == NULL || src_buffer == NULL || hashes == NULL)
+		abort();
+
+	// Animations aren't tied to a device, so are always encoded with turbojpeg
+	scdk_encoder_state_t encoder_state = { NULL, NULL };
+
+	size_t length = table_length;
+	uint64_t duration_us = 0;
+	bool is_success = true;
+
+	for (size_t i = 0; i < frame_count && is_success; ++i)
+	{
+		scdk_pixel_format_e tile_pixel_format = pixel_format;
+		const unsigned char* tile = scdk_prepare_key_image(type_info, frame_buffers[i], &tile_pixel_format, src_buffer);
+
+		hashes[i] = XXH64(tile, scdk_image_length(type_info->key_image_width, type_info->key_image_height,
+		                                          tile_pixel_format), 0);
+
+		scdk_animation_frame_t* frames = (scdk_animation_frame_t*)(data + sizeof(scdk_animation_header_t));
+
+		frames[i].duration_us = (uint32_t)frame_durations_ms[i] * 1000;
+		duration_us += frames[i].duration_us;
+
+		size_t duplicate_index = 0;
+		while (duplicate_index < i && hashes[duplicate_index] != hashes[i])
+			++duplicate_index;
+
+		if (duplicate_index < i)
+		{
+			frames[i].jpeg_offset = frames[duplicate_index].jpeg_offset;
+			frames[i].jpeg_length = frames[duplicate_index].jpeg_length;
+			continue;
+		}
+
+		if (capacity - length < jpeg_capacity)
+		{
+			capacity = SCDK_MAX(capacity * 2, length + jpeg_capacity);
+			data = realloc(data, capacity);
+			if (data == NULL)
+				abort();
+
+			frames = (scdk_animation_frame_t*)(data + sizeof(scdk_animation_header_t));
+		}
+
+		unsigned long jpeg_length = jpeg_capacity;
+		is_success = scdk_encode_key(&encoder_state, &scdk_encoder_turbojpeg, type_info, tile, tile_pixel_format,
+		                             quality_percentage, data + length, &jpeg_length);
+
+		frames[i].jpeg_offset = length;
+		frames[i].jpeg_length = (uint32_t)jpeg_length;
+		length += jpeg_length;
+	}
+
+	scdk_encoder_state_free(&encoder_state);
+
+	free(src_buffer);
+	free(hashes);
+
+	if (!is_success)
+	{
+		free(data);
+		return NULL;
+	}
+
+	unsigned char* trimmed_data = realloc(data, length);
+	if (trimmed_data)
+		data = trimmed_data;
+
+	scdk_animation_header_t* header = (scdk_animation_header_t*)data;
+	memcpy(header->magic, SCDK_ANIMATION_MAGIC, 8);
+	header->byte_order_mark = SCDK_ANIMATION_BYTE_ORDER_MARK;
+	header->key_image_width = type_info->key_image_width;
+	header->key_image_height = type_info->key_image_height;
+	header->frame_count = (uint32_t)frame_count;
+	header->duration_us = duration_us;
+
+	scdk_animation_impl_t* animation_impl = scdk_animation_open(data, length);
+	if (animation_impl == NULL)
+		free(data);
+
+	return animation_impl;
+}
+
+scdk_animation_t scdk_animation_load(const char* path)
+{
+	if (path == NULL)
+		return NULL;
+
+	scdk_file_map_t file_map;
+	if (!scdk_file_map(&file_map, path))
+		return NULL;
+
+	scdk_animation_impl_t* animation_impl = scdk_animation_open(file_map.data, file_map.length);
+	if (animation_impl == NULL)
+	{
+		scdk_file_unmap(&file_map);
+		return NULL;
+	}
+
+	animation_impl->is_mapped = true;
+	animation_impl->file_map = file_map;
+
+	return animation_impl;
+}
+
+bool scdk_animation_save(scdk_animation_t animation, const char* path)
+{
+	if (animation == NULL || path == NULL)
+		return false;
+
+	const scdk_animation_impl_t* animation_impl = animation;
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+
+	const bool is_written = fwrite(animation_impl->data, 1, animation_impl->length, file) == animation_impl->length;
+	const bool is_closed = fclose(file) == 0;
+
+	return is_written && is_closed;
+}
+
+bool scdk_animation_get_info(scdk_animation_t animation, int* frame_count, int* duration_ms)
+{
+	if (animation == NULL)
+		return false;
+
+	const scdk_animation_impl_t* animation_impl = animation;
+
+	if (frame_count)
+		*frame_count = (int)SCDK_MIN(animation_impl->header->frame_count, INT_MAX);
+
+	if (duration_ms)
+		*duration_ms = (int)SCDK_MIN(animation_impl->header->duration_us / 1000, INT_MAX);
+
+	return true;
+}
+
+void scdk_animation_free(scdk_animation_t animation)
+{
+	if (animation == NULL)
+		return;
+
+	scdk_animation_impl_t* animation_impl = animation;
+
+	scdk_mutex_lock(&animation_impl->mutex);
+	const int reference_count = --animation_impl->reference_count;
+	scdk_mutex_unlock(&animation_impl->mutex);
+
+	if (reference_count > 0)
+		return;
+
+	if (animation_impl->is_mapped)
+		scdk_file_unmap(&animation_impl->file_map);
+	else
+		free((void*)animation_impl->data);
+
+	scdk_mutex_destroy(&animation_impl->mutex);
+
+	free(animation_impl->frame_end_us);
+	free(animation_impl);
+}
+
+// Moves the track to the frame due at now, skipping any frames whose time has already passed. Returns the frame to
+// send, or -1 if the key already shows the right image.
+static int scdk_animator_advance(scdk_animator_impl_t* animator_impl, scdk_animator_track_t* track, uint64_t now_us)
+{
+	const scdk_animation_impl_t* animation_impl = track->animation;
+	const uint32_t frame_count = animation_impl->header->frame_count;
+	const uint64_t duration_us = animation_impl->header->duration_us;
+	const uint64_t elapsed_us = now_us - track->start_us;
+
+	uint64_t loop_index = 0;
+	uint32_t frame_index = frame_count - 1;
+
+	if (!track->is_looping && elapsed_us >= duration_us)
+	{
+		track->is_finished = true;
+	}
+	else
+	{
+		loop_index = elapsed_us / duration_us;
+		const uint64_t offset_us = elapsed_us % duration_us;
+
+		uint32_t lo = 0;
+		uint32_t hi = frame_count - 1;
+		while (lo < hi)
+		{
+			const uint32_t mid = lo + ((hi - lo) / 2);
+			if (animation_impl->frame_end_us[mid] > offset_us)
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+
+		frame_index = lo;
+		track->deadline_us = track->start_us + (loop_index * duration_us) + animation_impl->frame_end_us[frame_index];
+	}
+
+	const uint64_t position = (loop_index * frame_count) + frame_index;
+	const uint64_t shown_position = track->shown_position;
+
+	if (shown_position == position)
+		return -1;
+
+	track->shown_position = position;
+
+	if (shown_position == SCDK_ANIMATOR_NO_FRAME)
+		return (int)frame_index;
+
+	if (position > shown_position + 1)
+		animator_impl->stats.frames_dropped += position - shown_position - 1;
+
+	// Consecutive frames sharing a JPEG need no upload
+	if (animation_impl->frames[frame_index].jpeg_offset
+	    == animation_impl->frames[shown_position % frame_count].jpeg_offset)
+		return -1;
+
+	return (int)frame_index;
+}
+
+static void scdk_animator_remove_track(scdk_animator_impl_t* animator_impl, int track_index)
+{
+	scdk_animation_free(animator_impl->tracks[track_index].animation);
+	animator_impl->tracks[track_index] = animator_impl->tracks[--animator_impl->track_count];
+}
+
+// Must be called with the mutex held
+static scdk_animator_lane_t* scdk_animator_find_lane(const scdk_animator_impl_t* animator_impl,
+                                                     const scdk_device_impl_t* device_impl)
+{
+	for (int i = 0; i < animator_impl->lane_count; ++i)
+	{
+		if (animator_impl->lanes[i]->device_impl == device_impl)
+			return animator_impl->lanes[i];
+	}
+
+	return NULL;
+}
+
+// Tracks of a device must not change while its frames are being sent, as the lane reads their JPEGs. Must be called
+// with the mutex held, and the scheduler signalled once the tracks have been changed. Returns the device's lane, or
+// NULL if it has none.
+static scdk_animator_lane_t* scdk_animator_wait_device_idle(scdk_animator_impl_t* animator_impl,
+                                                            const scdk_device_impl_t* device_impl)
+{
+	scdk_animator_lane_t* lane = scdk_animator_find_lane(animator_impl, device_impl);
+	if (lane == NULL)
+		return NULL;
+
+	++lane->waiting_count;
+
+	while (lane->is_sending)
+		scdk_cond_wait(&animator_impl->idle_cond, &animator_impl->mutex);
+
+	--lane->waiting_count;
+
+	return lane;
+}
+
+static void scdk_animator_lane_sender(void* arg)
+{
+	scdk_animator_lane_t* lane = arg;
+	scdk_animator_impl_t* animator_impl = lane->animator_impl;
+
+	scdk_mutex_lock(&animator_impl->mutex);
+
+	while (true)
+	{
+		while (!lane->is_shutdown && !lane->is_sending)
+			scdk_cond_wait(&lane->cond, &animator_impl->mutex);
+
+		if (lane->is_shutdown)
+			break;
+
+		const int frame_count = lane->frame_count;
+
+		scdk_mutex_unlock(&animator_impl->mutex);
+
+		const bool is_success = scdk_set_image_jpeg(lane->device_impl, lane->key_jpeg_buffers, lane->key_jpeg_lengths);
+
+		scdk_mutex_lock(&animator_impl->mutex);
+
+		if (is_success)
+			animator_impl->stats.frames_sent += frame_count;
+		else
+			++animator_impl->stats.send_failures;
+
+		lane->is_sending = false;
+		scdk_cond_broadcast(&animator_impl->idle_cond);
+		scdk_cond_signal(&animator_impl->cond);
+	}
+
+	scdk_mutex_unlock(&animator_impl->mutex);
+}
+
+// Must be called with the mutex held. Returns NULL if the lane's thread can't be started.
+static scdk_animator_lane_t* scdk_animator_add_lane(scdk_animator_impl_t* animator_impl,
+                                                    scdk_device_impl_t* device_impl)
+{
+	scdk_animator_lane_t* lane = malloc(sizeof(scdk_animator_lane_t));
+	if (lane == NULL)
+		abort();
+
+	lane->animator_impl = animator_impl;
+	lane->device_impl = device_impl;
+	lane->frame_count = 0;
+	lane->is_sending = false;
+	lane->waiting_count = 0;
+	lane->is_shutdown = false;
+	scdk_cond_init(&lane->cond);
+
+	if (!scdk_thread_create(&lane->thread, scdk_animator_lane_sender, lane))
+	{
+		scdk_cond_destroy(&lane->cond);
+		free(lane);
+		return NULL;
+	}
+
+	if (animator_impl->lane_count == animator_impl->lane_capacity)
+	{
+		animator_impl->lane_capacity = SCDK_MAX(animator_impl->lane_capacity * 2, 4);
+		animator_impl->lanes = realloc(animator_impl->lanes,
+		                               animator_impl->lane_capacity * sizeof(scdk_animator_lane_t*));
+		if (animator_impl->lanes == NULL)
+			abort();
+	}
+
+	animator_impl->lanes[animator_impl->lane_count++] = lane;
+
+	return lane;
+}
+
+// Stops the lane's thread. The lane must already be removed from the animator, and is freed.
+static void scdk_animator_free_lane(scdk_animator_impl_t* animator_impl, scdk_animator_lane_t* lane)
+{
+	scdk_mutex_lock(&animator_impl->mutex);
+	lane->is_shutdown = true;
+	scdk_cond_signal(&lane->cond);
+	scdk_mutex_unlock(&animator_impl->mutex);
+
+	scdk_thread_join(lane->thread);
+
+	scdk_cond_destroy(&lane->cond);
+	free(lane);
+}
+
+static void scdk_animator_scheduler(void* arg)
+{
+	scdk_animator_impl_t* animator_impl = arg;
+
+	scdk_mutex_lock(&animator_impl->mutex);
+
+	while (!animator_impl->is_shutdown)
+	{
+		// Devices still sending their last frames, or with callers waiting to change their tracks, are skipped until
+		// their lane is free again, and their frames that fall due meanwhile are dropped
+		int next_index = -1;
+		for (int i = 0; i < animator_impl->track_count; ++i)
+		{
+			const scdk_animator_track_t* track = animator_impl->tracks + i;
+			if (track->lane->is_sending || track->lane->waiting_count > 0)
+				continue;
+
+			if (next_index < 0 || track->deadline_us < animator_impl->tracks[next_index].deadline_us)
+				next_index = i;
+		}
+
+		if (next_index < 0)
+		{
+			scdk_cond_wait(&animator_impl->cond, &animator_impl->mutex);
+			continue;
+		}
+
+		const uint64_t now_us = scdk_time_now_us();
+		const uint64_t deadline_us = animator_impl->tracks[next_index].deadline_us;
+
+		if (deadline_us > now_us)
+		{
+			const uint64_t wait_ms = (deadline_us - now_us + 999) / 1000;
+			scdk_cond_timed_wait(&animator_impl->cond, &animator_impl->mutex, (int)SCDK_MIN(wait_ms, INT_MAX));
+			continue;
+		}
+
+		// Every key of the device that is due goes out in one call, so a device is locked once per tick
+		scdk_animator_lane_t* lane = animator_impl->tracks[next_index].lane;
+		scdk_device_impl_t* device_impl = lane->device_impl;
+		int frame_count = 0;
+
+		memset(lane->key_jpeg_buffers, 0, sizeof(lane->key_jpeg_buffers));
+		memset(lane->key_jpeg_lengths, 0, sizeof(lane->key_jpeg_lengths));
+
+		for (int i = 0; i < animator_impl->track_count; ++i)
+		{
+			scdk_animator_track_t* track = animator_impl->tracks + i;
+			if (track->device_impl != device_impl || track->deadline_us > now_us)
+				continue;
+
+			const int frame_index = scdk_animator_advance(animator_impl, track, now_us);
+			if (frame_index < 0)
+				continue;
+
+			const scdk_animation_frame_t* frame = track->animation->frames + frame_index;
+			lane->key_jpeg_buffers[track->key_index] = track->animation->data + frame->jpeg_offset;
+			lane->key_jpeg_lengths[track->key_index] = frame->jpeg_length;
+			++frame_count;
+		}
+
+		if (frame_count > 0)
+		{
+			lane->frame_count = frame_count;
+			lane->is_sending = true;
+			scdk_cond_signal(&lane->cond);
+			continue;
+		}
+
+		// Finished tracks are only removed once their last frame has been sent, as removing them frees the JPEGs
+		for (int i = animator_impl->track_count - 1; i >= 0; --i)
+		{
+			if (animator_impl->tracks[i].device_impl == device_impl && animator_impl->tracks[i].is_finished)
+				scdk_animator_remove_track(animator_impl, i);
+		}
+	}
+
+	scdk_mutex_unlock(&animator_impl->mutex);
+}
+
+scdk_animator_t scdk_animator_create(void)
+{
+	scdk_animator_impl_t* animator_impl = malloc(sizeof(scdk_animator_impl_t));
+	if (animator_impl == NULL)
+		abort();
+
+	animator_impl->is_shutdown = false;
+	animator_impl->track_count = 0;
+	animator_impl->track_capacity = 0;
+	animator_impl->tracks = NULL;
+	animator_impl->lane_count = 0;
+	animator_impl->lane_capacity = 0;
+	animator_impl->lanes = NULL;
+	memset(&animator_impl->stats, 0, sizeof(scdk_animator_stats_t));
+
+	scdk_mutex_init(&animator_impl->mutex);
+	scdk_cond_init(&animator_impl->cond);
+	scdk_cond_init(&animator_impl->idle_cond);
+
+	if (!scdk_thread_create(&animator_impl->thread, scdk_animator_scheduler, animator_impl))
+	{
+		scdk_cond_destroy(&animator_impl->idle_cond);
+		scdk_cond_destroy(&animator_impl->cond);
+		scdk_mutex_destroy(&animator_impl->mutex);
+		free(animator_impl);
+		return NULL;
+	}
+
+	return animator_impl;
+}
+
+void scdk_animator_free(scdk_animator_t animator)
+{
+	if (animator == NULL)
+		return;
+
+	scdk_animator_impl_t* animator_impl = animator;
+
+	scdk_mutex_lock(&animator_impl->mutex);
+	animator_impl->is_shutdown = true;
+	scdk_cond_broadcast(&animator_impl->cond);
+	scdk_mutex_unlock(&animator_impl->mutex);
+
+	scdk_thread_join(animator_impl->thread);
+
+	for (int i = 0; i < animator_impl->lane_count; ++i)
+		scdk_animator_free_lane(animator_impl, animator_impl->lanes[i]);
+
+	while (animator_impl->track_count > 0)
+		scdk_animator_remove_track(animator_impl, animator_impl->track_count - 1);
+
+	scdk_cond_destroy(&animator_impl->idle_cond);
+	scdk_cond_destroy(&animator_impl->cond);
+	scdk_mutex_destroy(&animator_impl->mutex);
+
+	free(animator_impl->lanes);
+	free(animator_impl->tracks);
+	free(animator_impl);
+}
+
+bool scdk_animator_play(scdk_animator_t animator, scdk_device_t device, int key_x, int key_y,
+                        scdk_animation_t animation, bool is_looping)
+{
+	if (animator == NULL || device == NULL || animation == NULL)
+		return false;
+
+	scdk_animator_impl_t* animator_impl = animator;
+	scdk_device_impl_t* device_impl = device;
+	scdk_animation_impl_t* animation_impl = animation;
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+
+	if (key_x < 0 || key_x >= type_info->columns || key_y < 0 || key_y >= type_info->rows
+	    || animation_impl->header->key_image_width != (uint32_t)type_info->key_image_width
+	    || animation_impl->header->key_image_height != (uint32_t)type_info->key_image_height)
+		return false;
+
+	const int key_index = key_x + (key_y * type_info->columns);
+
+	scdk_mutex_lock(&animator_impl->mutex);
+
+	scdk_animator_lane_t* lane = scdk_animator_wait_device_idle(animator_impl, device_impl);
+	if (lane == NULL)
+		lane = scdk_animator_add_lane(animator_impl, device_impl);
+
+	if (lane == NULL)
+	{
+		scdk_mutex_unlock(&animator_impl->mutex);
+		return false;
+	}
+
+	scdk_animator_track_t* track = NULL;
+	for (int i = 0; i < animator_impl->track_count && track == NULL; ++i)
+	{
+		if (animator_impl->tracks[i].device_impl == device_impl && animator_impl->tracks[i].key_index == key_index)
+			track = animator_impl->tracks + i;
+	}
+
+	if (track)
+	{
+		scdk_animation_free(track->animation);
+	}
+	else
+	{
+		if (animator_impl->track_count == animator_impl->track_capacity)
+		{
+			animator_impl->track_capacity = SCDK_MAX(animator_impl->track_capacity * 2, 16);
+			animator_impl->tracks = realloc(animator_impl->tracks,
+			                                animator_impl->track_capacity * sizeof(scdk_animator_track_t));
+			if (animator_impl->tracks == NULL)
+				abort();
+		}
+
+		track = animator_impl->tracks + animator_impl->track_count++;
+	}
+
+	track->device_impl = device_impl;
+	track->lane = lane;
+	track->key_index = key_index;
+	track->animation = scdk_animation_retain(animation_impl);
+	track->is_looping = is_looping;
+	track->is_finished = false;
+	track->start_us = scdk_time_now_us();
+	track->deadline_us = track->start_us;
+	track->shown_position = SCDK_ANIMATOR_NO_FRAME;
+
+	scdk_cond_signal(&animator_impl->cond);
+	scdk_mutex_unlock(&animator_impl->mutex);
+
+	return true;
+}
+
+bool scdk_animator_stop(scdk_animator_t animator, scdk_device_t device, int key_x, int key_y)
+{
+	if (animator == NULL || device == NULL)
+		return false;
+
+	scdk_animator_impl_t* animator_impl = animator;
+	scdk_device_impl_t* device_impl = device;
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+
+	if (key_x < 0 || key_x >= type_info->columns || key_y < 0 || key_y >= type_info->rows)
+		return false;
+
+	const int key_index = key_x + (key_y * type_info->columns);
+
+	scdk_mutex_lock(&animator_impl->mutex);
+	scdk_animator_wait_device_idle(animator_impl, device_impl);
+
+	for (int i = animator_impl->track_count - 1; i >= 0; --i)
+	{
+		if (animator_impl->tracks[i].device_impl == device_impl && animator_impl->tracks[i].key_index == key_index)
+			scdk_animator_remove_track(animator_impl, i);
+	}
+
+	scdk_cond_signal(&animator_impl->cond);
+	scdk_mutex_unlock(&animator_impl->mutex);
+
+	return true;
+}
+
+bool scdk_animator_stop_device(scdk_animator_t animator, scdk_device_t device)
+{
+	if (animator == NULL || device == NULL)
+		return false;
+
+	scdk_animator_impl_t* animator_impl = animator;
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&animator_impl->mutex);
+	scdk_animator_lane_t* lane = scdk_animator_wait_device_idle(animator_impl, device_impl);
+
+	for (int i = animator_impl->track_count - 1; i >= 0; --i)
+	{
+		if (animator_impl->tracks[i].device_impl == device_impl)
+			scdk_animator_remove_track(animator_impl, i);
+	}
+
+	// A lane another caller is still waiting on is left to the next stop or to scdk_animator_free
+	if (lane && lane->waiting_count == 0)
+	{
+		for (int i = 0; i < animator_impl->lane_count; ++i)
+		{
+			if (animator_impl->lanes[i] == lane)
+				animator_impl->lanes[i] = animator_impl->lanes[--animator_impl->lane_count];
+		}
+	}
+	else
+	{
+		lane = NULL;
+	}
+
+	scdk_cond_signal(&animator_impl->cond);
+	scdk_mutex_unlock(&animator_impl->mutex);
+
+	if (lane)
+		scdk_animator_free_lane(animator_impl, lane);
+
+	return true;
+}
+
+bool scdk_animator_get_stats(scdk_animator_t animator, scdk_animator_stats_t* stats)
+{
+	if (animator == NULL || stats == NULL)
+		return false;
+
+	scdk_animator_impl_t* animator_impl = animator;
+
+	scdk_mutex_lock(&animator_impl->mutex);
+	*stats = animator_impl->stats;
+	scdk_mutex_unlock(&animator_impl->mutex);
+
+	return true;
+}
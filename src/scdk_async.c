@@ -0,0 +1,319 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Changes between sent and failed frames remembered, beyond which older frames report failure
+#define SCDK_ASYNC_OUTCOME_RUN_COUNT 16
+
+// Frames from first_frame_id up to the start of the next run, or the last completed frame, all share an outcome
+typedef struct scdk_async_outcome_run_t
+{
+	uint64_t first_frame_id;
+	bool is_success;
+
+} scdk_async_outcome_run_t;
+
+struct scdk_async_t
+{
+	scdk_device_impl_t* device_impl;
+	scdk_thread_t thread;
+
+	scdk_mutex_t mutex;
+	scdk_cond_t pending_cond;
+	scdk_cond_t completed_cond;
+
+	size_t frame_buffer_length;
+	unsigned char* back_buffer;
+	unsigned char* front_buffer;
+
+	uint64_t next_frame_id;
+	uint64_t pending_frame_id;
+	scdk_pixel_format_e pending_pixel_format;
+	int pending_quality_percentage;
+
+	// A frame dropped before it was sent takes the outcome of the frame that superseded it, which is the next one
+	// completed
+	uint64_t completed_frame_id;
+	scdk_async_outcome_run_t outcome_runs[SCDK_ASYNC_OUTCOME_RUN_COUNT];
+	size_t outcome_run_head;
+	size_t outcome_run_count;
+
+	scdk_frame_callback_t callback;
+	void* callback_user_data;
+
+	bool is_shutdown;
+};
+
+// Must be called with the mutex held
+static void scdk_async_record_outcome(scdk_async_t* async, uint64_t frame_id, bool is_success)
+{
+	const size_t last_run = (async->outcome_run_head + async->outcome_run_count - 1) % SCDK_ASYNC_OUTCOME_RUN_COUNT;
+
+	if (async->outcome_run_count == 0 || async->outcome_runs[last_run].is_success != is_success)
+	{
+		if (async->outcome_run_count == SCDK_ASYNC_OUTCOME_RUN_COUNT)
+		{
+			async->outcome_run_head = (async->outcome_run_head + 1) % SCDK_ASYNC_OUTCOME_RUN_COUNT;
+			--async->outcome_run_count;
+		}
+
+		scdk_async_outcome_run_t* run = async->outcome_runs
+			+ ((async->outcome_run_head + async->outcome_run_count) % SCDK_ASYNC_OUTCOME_RUN_COUNT);
+		run->first_frame_id = async->completed_frame_id + 1;
+		run->is_success = is_success;
+		++async->outcome_run_count;
+	}
+
+	async->completed_frame_id = frame_id;
+}
+
+// Must be called with the mutex held, for a frame no newer than completed_frame_id
+static bool scdk_async_is_frame_sent(const scdk_async_t* async, uint64_t frame_id)
+{
+	for (size_t i = async->outcome_run_count; i > 0; --i)
+	{
+		const scdk_async_outcome_run_t* run = async->outcome_runs
+			+ ((async->outcome_run_head + i - 1) % SCDK_ASYNC_OUTCOME_RUN_COUNT);
+
+		if (run->first_frame_id <= frame_id)
+			return run->is_success;
+	}
+
+	return false;
+}
+
+static void scdk_async_sender(void* arg)
+{
+	scdk_async_t* async = arg;
+
+	scdk_mutex_lock(&async->mutex);
+
+	while (true)
+	{
+		while (!async->is_shutdown && async->pending_frame_id == 0)
+			scdk_cond_wait(&async->pending_cond, &async->mutex);
+
+		if (async->is_shutdown)
+			break;
+
+		unsigned char* buffer = async->back_buffer;
+		async->back_buffer = async->front_buffer;
+		async->front_buffer = buffer;
+
+		const uint64_t frame_id = async->pending_frame_id;
+		const scdk_pixel_format_e pixel_format = async->pending_pixel_format;
+		const int quality_percentage = async->pending_quality_percentage;
+		async->pending_frame_id = 0;
+
+		scdk_mutex_unlock(&async->mutex);
+
+		const bool is_success = scdk_set_image(async->device_impl, async->front_buffer, pixel_format,
+		                                       quality_percentage);
+
+		scdk_mutex_lock(&async->mutex);
+
+		scdk_async_record_outcome(async, frame_id, is_success);
+		scdk_cond_broadcast(&async->completed_cond);
+
+		const scdk_frame_callback_t callback = async->callback;
+		void* user_data = async->callback_user_data;
+
+		scdk_mutex_unlock(&async->mutex);
+
+		if (callback)
+			callback(async->device_impl, frame_id, is_success ? SCDK_FRAME_STATUS_SENT : SCDK_FRAME_STATUS_FAILED,
+			         user_data);
+
+		scdk_mutex_lock(&async->mutex);
+	}
+
+	scdk_mutex_unlock(&async->mutex);
+}
+
+static scdk_async_t* scdk_async_create(scdk_device_impl_t* device_impl)
+{
+	scdk_async_t* async = malloc(sizeof(scdk_async_t));
+	if (async == NULL)
+		abort();
+
+	async->device_impl = device_impl;
+	async->frame_buffer_length = device_impl->type_info->image_width * device_impl->type_info->image_height * 4;
+	async->back_buffer = malloc(async->frame_buffer_length);
+	async->front_buffer = malloc(async->frame_buffer_length);
+	if (async->back_buffer == NULL || async->front_buffer == NULL)
+		abort();
+
+	async->next_frame_id = 1;
+	async->pending_frame_id = 0;
+	async->completed_frame_id = 0;
+	async->outcome_run_head = 0;
+	async->outcome_run_count = 0;
+	async->callback = NULL;
+	async->callback_user_data = NULL;
+	async->is_shutdown = false;
+
+	scdk_mutex_init(&async->mutex);
+	scdk_cond_init(&async->pending_cond);
+	scdk_cond_init(&async->completed_cond);
+
+	if (!scdk_thread_create(&async->thread, scdk_async_sender, async))
+	{
+		scdk_cond_destroy(&async->completed_cond);
+		scdk_cond_destroy(&async->pending_cond);
+		scdk_mutex_destroy(&async->mutex);
+		free(async->back_buffer);
+		free(async->front_buffer);
+		free(async);
+		return NULL;
+	}
+
+	return async;
+}
+
+// Returns the device's async state, creating it and starting the sender thread on first use
+static scdk_async_t* scdk_async_get(scdk_device_impl_t* device_impl)
+{
+	scdk_mutex_lock(&device_impl->lifecycle_mutex);
+
+	if (device_impl->async == NULL)
+		device_impl->async = scdk_async_create(device_impl);
+
+	scdk_async_t* async = device_impl->async;
+
+	scdk_mutex_unlock(&device_impl->lifecycle_mutex);
+
+	return async;
+}
+
+void scdk_async_free(scdk_async_t* async)
+{
+	if (async == NULL)
+		return;
+
+	scdk_mutex_lock(&async->mutex);
+	async->is_shutdown = true;
+	const uint64_t dropped_frame_id = async->pending_frame_id;
+	async->pending_frame_id = 0;
+	scdk_cond_broadcast(&async->pending_cond);
+	scdk_cond_broadcast(&async->completed_cond);
+	scdk_mutex_unlock(&async->mutex);
+
+	scdk_thread_join(async->thread);
+
+	if (dropped_frame_id != 0 && async->callback)
+		async->callback(async->device_impl, dropped_frame_id, SCDK_FRAME_STATUS_DROPPED, async->callback_user_data);
+
+	scdk_cond_destroy(&async->completed_cond);
+	scdk_cond_destroy(&async->pending_cond);
+	scdk_mutex_destroy(&async->mutex);
+
+	free(async->back_buffer);
+	free(async->front_buffer);
+	free(async);
+}
+
+uint64_t scdk_submit_image_async(scdk_device_t device, const unsigned char* image_buffer,
+                                 scdk_pixel_format_e pixel_format, int quality_percentage)
+{
+	if (device == NULL || image_buffer == NULL || pixel_format < SCDK_PIXEL_FORMAT_RGB
+	    || pixel_format > SCDK_PIXEL_FORMAT_NV12)
+		return 0;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_async_t* async = scdk_async_get(device_impl);
+	if (async == NULL)
+		return 0;
+
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+
+	scdk_mutex_lock(&async->mutex);
+
+	const uint64_t dropped_frame_id = async->pending_frame_id;
+	const uint64_t frame_id = async->next_frame_id++;
+
+	memcpy(async->back_buffer, image_buffer,
+	       scdk_image_length(type_info->image_width, type_info->image_height, pixel_format));
+
+	async->pending_frame_id = frame_id;
+	async->pending_pixel_format = pixel_format;
+	async->pending_quality_percentage = quality_percentage;
+	scdk_cond_signal(&async->pending_cond);
+
+	const scdk_frame_callback_t callback = async->callback;
+	void* user_data = async->callback_user_data;
+
+	scdk_mutex_unlock(&async->mutex);
+
+	if (dropped_frame_id != 0 && callback)
+		callback(device, dropped_frame_id, SCDK_FRAME_STATUS_DROPPED, user_data);
+
+	return frame_id;
+}
+
+bool scdk_set_frame_callback(scdk_device_t device, scdk_frame_callback_t callback, void* user_data)
+{
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_async_t* async = scdk_async_get(device_impl);
+	if (async == NULL)
+		return false;
+
+
+	scdk_mutex_lock(&async->mutex);
+	async->callback = callback;
+	async->callback_user_data = user_data;
+	scdk_mutex_unlock(&async->mutex);
+
+	return true;
+}
+
+bool scdk_wait_frame(scdk_device_t device, uint64_t frame_id, int timeout_ms)
+{
+	if (device == NULL || frame_id == 0)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+	scdk_mutex_lock(&device_impl->lifecycle_mutex);
+	scdk_async_t* async = device_impl->async;
+	scdk_mutex_unlock(&device_impl->lifecycle_mutex);
+
+	if (async == NULL)
+		return false;
+
+	const uint64_t deadline = scdk_time_now_us() + (uint64_t)SCDK_MAX(timeout_ms, 0) * 1000;
+
+	scdk_mutex_lock(&async->mutex);
+
+	// A frame that was never submitted would otherwise be waited for until a later one completes, or forever
+	if (frame_id >= async->next_frame_id)
+	{
+		scdk_mutex_unlock(&async->mutex);
+		return false;
+	}
+
+	while (!async->is_shutdown && async->completed_frame_id < frame_id)
+	{
+		if (timeout_ms < 0)
+		{
+			scdk_cond_wait(&async->completed_cond, &async->mutex);
+			continue;
+		}
+
+		const uint64_t now = scdk_time_now_us();
+		if (now >= deadline)
+			break;
+
+		scdk_cond_timed_wait(&async->completed_cond, &async->mutex, (int)((deadline - now + 999) / 1000));
+	}
+
+	const bool is_success = async->completed_frame_id >= frame_id && scdk_async_is_frame_sent(async, frame_id);
+
+	scdk_mutex_unlock(&async->mutex);
+
+	return is_success;
+}
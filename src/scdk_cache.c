@@ -0,0 +1,609 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SCDK_JPEG_CACHE_INITIAL_BUCKET_COUNT 64
+
+#define SCDK_JPEG_CACHE_FILE_MAGIC 0x4A434453u // "SDCJ"
+// Files from older versions, including those keyed by older tile hashes or without the encoder, are reset when opened
+#define SCDK_JPEG_CACHE_FILE_VERSION 3
+
+// Slots a key may be stored in, starting from the slot its key hashes to
+#define SCDK_JPEG_CACHE_FILE_PROBE_COUNT 8
+
+// Data bytes allowed for each slot, around the size of a typical key JPEG
+#define SCDK_JPEG_CACHE_FILE_BYTES_PER_SLOT 4096
+
+// Persistent cache files hold this header, a table of slots and then a ring of JPEG data, all in native byte order.
+// The layout is derived from the file length, so every process opening the file agrees on it.
+typedef struct scdk_jpeg_cache_file_header_t
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t file_length;
+
+	// Total bytes ever appended to the data ring. Data is intact while it lies within the last ring length bytes.
+	uint64_t write_position;
+	uint64_t reserved;
+
+} scdk_jpeg_cache_file_header_t;
+
+// A slot is empty when jpeg_length is 0. The checksum catches slots torn by a process dying part way through a write.
+typedef struct scdk_jpeg_cache_file_slot_t
+{
+	uint64_t hash;
+	uint64_t position;
+	uint64_t checksum;
+	int32_t quality_percentage;
+	int32_t device_type;
+	int32_t pixel_format;
+	int32_t jpeg_encoder;
+	uint32_t jpeg_length;
+
+} scdk_jpeg_cache_file_slot_t;
+
+typedef struct scdk_jpeg_cache_entry_t
+{
+	scdk_jpeg_cache_key_t key;
+
+	struct scdk_jpeg_cache_entry_t* bucket_next;
+	struct scdk_jpeg_cache_entry_t* lru_prev;
+	struct scdk_jpeg_cache_entry_t* lru_next;
+
+	size_t jpeg_length;
+	unsigned char jpeg[];
+
+} scdk_jpeg_cache_entry_t;
+
+struct scdk_jpeg_cache_impl_t
+{
+	scdk_mutex_t mutex;
+	int reference_count;
+
+	size_t bucket_count;
+	scdk_jpeg_cache_entry_t** buckets;
+
+	// Most recently used entry is at the head
+	scdk_jpeg_cache_entry_t* lru_head;
+	scdk_jpeg_cache_entry_t* lru_tail;
+
+	size_t entry_count;
+	size_t size_bytes;
+	size_t max_size_bytes;
+
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+
+	// Persistent caches only. Access to the file is under mutex within the process and the file lock across processes.
+	bool is_persistent;
+	scdk_shared_file_t file;
+	size_t file_slot_count;
+	size_t file_data_length;
+	uint64_t file_hits;
+};
+
+static size_t scdk_jpeg_cache_bucket(const scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key)
+{
+	uint64_t h = key->hash;
+	h ^= ((uint64_t)key->quality_percentage << 32) ^ ((uint64_t)key->jpeg_encoder << 24)
+		^ ((uint64_t)key->device_type << 8) ^ (uint64_t)key->pixel_format;
+	h *= 0x9E3779B97F4A7C15ull;
+
+	return (size_t)(h >> 32) & (cache->bucket_count - 1);
+}
+
+static bool scdk_jpeg_cache_key_equals(const scdk_jpeg_cache_key_t* a, const scdk_jpeg_cache_key_t* b)
+{
+	return a->hash == b->hash
+		&& a->quality_percentage == b->quality_percentage
+		&& a->device_type == b->device_type
+		&& a->pixel_format == b->pixel_format
+		&& a->jpeg_encoder == b->jpeg_encoder;
+}
+
+static void scdk_jpeg_cache_lru_unlink(scdk_jpeg_cache_impl_t* cache, scdk_jpeg_cache_entry_t* entry)
+{
+	if (entry->lru_prev)
+		entry->lru_prev->lru_next = entry->lru_next;
+	else
+		cache->lru_head = entry->lru_next;
+
+	if (entry->lru_next)
+		entry->lru_next->lru_prev = entry->lru_prev;
+	else
+		cache->lru_tail = entry->lru_prev;
+}
+
+static void scdk_jpeg_cache_lru_push_front(scdk_jpeg_cache_impl_t* cache, scdk_jpeg_cache_entry_t* entry)
+{
+	entry->lru_prev = NULL;
+	entry->lru_next = cache->lru_head;
+
+	if (cache->lru_head)
+		cache->lru_head->lru_prev = entry;
+	else
+		cache->lru_tail = entry;
+
+	cache->lru_head = entry;
+}
+
+static void scdk_jpeg_cache_remove(scdk_jpeg_cache_impl_t* cache, scdk_jpeg_cache_entry_t* entry)
+{
+	scdk_jpeg_cache_entry_t** link = cache->buckets + scdk_jpeg_cache_bucket(cache, &entry->key);
+	while (*link != entry)
+		link = &(*link)->bucket_next;
+
+	*link = entry->bucket_next;
+
+	scdk_jpeg_cache_lru_unlink(cache, entry);
+
+	cache->size_bytes -= sizeof(scdk_jpeg_cache_entry_t) + entry->jpeg_length;
+	--cache->entry_count;
+
+	free(entry);
+}
+
+static void scdk_jpeg_cache_grow(scdk_jpeg_cache_impl_t* cache)
+{
+	const size_t old_bucket_count = cache->bucket_count;
+	scdk_jpeg_cache_entry_t** old_buckets = cache->buckets;
+
+	cache->bucket_count = old_bucket_count * 2;
+	cache->buckets = calloc(cache->bucket_count, sizeof(scdk_jpeg_cache_entry_t*));
+	if (cache->buckets == NULL)
+		abort();
+
+	for (size_t i = 0; i < old_bucket_count; ++i)
+	{
+		scdk_jpeg_cache_entry_t* entry = old_buckets[i];
+		while (entry)
+		{
+			scdk_jpeg_cache_entry_t* next = entry->bucket_next;
+			const size_t bucket = scdk_jpeg_cache_bucket(cache, &entry->key);
+
+			entry->bucket_next = cache->buckets[bucket];
+			cache->buckets[bucket] = entry;
+
+			entry = next;
+		}
+	}
+
+	free(old_buckets);
+}
+
+static scdk_jpeg_cache_file_header_t* scdk_jpeg_cache_file_header(const scdk_jpeg_cache_impl_t* cache)
+{
+	return (scdk_jpeg_cache_file_header_t*)cache->file.data;
+}
+
+static scdk_jpeg_cache_file_slot_t* scdk_jpeg_cache_file_slots(const scdk_jpeg_cache_impl_t* cache)
+{
+	return (scdk_jpeg_cache_file_slot_t*)(cache->file.data + sizeof(scdk_jpeg_cache_file_header_t));
+}
+
+static unsigned char* scdk_jpeg_cache_file_data(const scdk_jpeg_cache_impl_t* cache)
+{
+	return cache->file.data + cache->file.length - cache->file_data_length;
+}
+
+static bool scdk_jpeg_cache_file_slot_matches(const scdk_jpeg_cache_file_slot_t* slot, const scdk_jpeg_cache_key_t* key)
+{
+	return slot->hash == key->hash
+		&& slot->quality_percentage == key->quality_percentage
+		&& slot->device_type == (int32_t)key->device_type
+		&& slot->pixel_format == (int32_t)key->pixel_format
+		&& slot->jpeg_encoder == (int32_t)key->jpeg_encoder;
+}
+
+// Slots pointing at data the ring has since wrapped over are treated as empty, as are torn slots whose data would run
+// off the end of the ring
+static bool scdk_jpeg_cache_file_slot_is_live(const scdk_jpeg_cache_impl_t* cache,
+                                              const scdk_jpeg_cache_file_slot_t* slot)
+{
+	const uint64_t write_position = scdk_jpeg_cache_file_header(cache)->write_position;
+
+	return slot->jpeg_length > 0
+		&& slot->position <= write_position
+		&& write_position - slot->position <= cache->file_data_length
+		&& (slot->position % cache->file_data_length) + slot->jpeg_length <= cache->file_data_length;
+}
+
+// Must be called with the file locked exclusively
+static void scdk_jpeg_cache_file_reset(scdk_jpeg_cache_impl_t* cache)
+{
+	scdk_jpeg_cache_file_header_t* header = scdk_jpeg_cache_file_header(cache);
+
+	memset(scdk_jpeg_cache_file_slots(cache), 0, cache->file_slot_count * sizeof(scdk_jpeg_cache_file_slot_t));
+
+	header->file_length = cache->file.length;
+	header->write_position = 0;
+	header->reserved = 0;
+	header->version = SCDK_JPEG_CACHE_FILE_VERSION;
+	header->magic = SCDK_JPEG_CACHE_FILE_MAGIC;
+}
+
+static bool scdk_jpeg_cache_file_open(scdk_jpeg_cache_impl_t* cache, const char* path, size_t max_file_size_bytes)
+{
+	if (!scdk_shared_file_open(&cache->file, path, max_file_size_bytes))
+		return false;
+
+	const size_t table_offset = sizeof(scdk_jpeg_cache_file_header_t);
+	const size_t bytes_per_slot = sizeof(scdk_jpeg_cache_file_slot_t) + SCDK_JPEG_CACHE_FILE_BYTES_PER_SLOT;
+
+	const size_t slot_count = cache->file.length > table_offset
+		? (cache->file.length - table_offset) / bytes_per_slot : 0;
+
+	if (slot_count < SCDK_JPEG_CACHE_FILE_PROBE_COUNT)
+	{
+		scdk_shared_file_close(&cache->file);
+		return false;
+	}
+
+	cache->file_slot_count = slot_count;
+	cache->file_data_length = cache->file.length - table_offset - (slot_count * sizeof(scdk_jpeg_cache_file_slot_t));
+
+	scdk_shared_file_lock(&cache->file, true);
+
+	const scdk_jpeg_cache_file_header_t* header = scdk_jpeg_cache_file_header(cache);
+	if (header->magic != SCDK_JPEG_CACHE_FILE_MAGIC || header->version != SCDK_JPEG_CACHE_FILE_VERSION
+	    || header->file_length != cache->file.length)
+		scdk_jpeg_cache_file_reset(cache);
+
+	scdk_shared_file_unlock(&cache->file);
+
+	return true;
+}
+
+static size_t scdk_jpeg_cache_file_first_slot(const scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key)
+{
+	uint64_t h = key->hash;
+	h ^= ((uint64_t)key->quality_percentage << 32) ^ ((uint64_t)key->jpeg_encoder << 24)
+		^ ((uint64_t)key->device_type << 8) ^ (uint64_t)key->pixel_format;
+	h *= 0xC2B2AE3D27D4EB4Full;
+
+	return (size_t)(h >> 32) % cache->file_slot_count;
+}
+
+// Must be called with mutex held
+static bool scdk_jpeg_cache_file_lookup(scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key,
+                                        unsigned char* dst_buffer, unsigned long* dst_buffer_length)
+{
+	bool is_hit = false;
+
+	scdk_shared_file_lock(&cache->file, false);
+
+	const scdk_jpeg_cache_file_slot_t* slots = scdk_jpeg_cache_file_slots(cache);
+	const size_t first_slot = scdk_jpeg_cache_file_first_slot(cache, key);
+
+	for (size_t i = 0; i < SCDK_JPEG_CACHE_FILE_PROBE_COUNT && !is_hit; ++i)
+	{
+		const scdk_jpeg_cache_file_slot_t* slot = slots + ((first_slot + i) % cache->file_slot_count);
+
+		if (!scdk_jpeg_cache_file_slot_is_live(cache, slot) || !scdk_jpeg_cache_file_slot_matches(slot, key)
+		    || slot->jpeg_length > *dst_buffer_length)
+			continue;
+
+		memcpy(dst_buffer, scdk_jpeg_cache_file_data(cache) + (slot->position % cache->file_data_length),
+		       slot->jpeg_length);
+
+		if (XXH64(dst_buffer, slot->jpeg_length, 0) == slot->checksum)
+		{
+			*dst_buffer_length = slot->jpeg_length;
+			is_hit = true;
+		}
+	}
+
+	scdk_shared_file_unlock(&cache->file);
+
+	return is_hit;
+}
+
+// Must be called with mutex held
+static void scdk_jpeg_cache_file_insert(scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key,
+                                        const unsigned char* jpeg_buffer, unsigned long jpeg_length)
+{
+	if (jpeg_length == 0 || jpeg_length > cache->file_data_length)
+		return;
+
+	scdk_shared_file_lock(&cache->file, true);
+
+	scdk_jpeg_cache_file_header_t* header = scdk_jpeg_cache_file_header(cache);
+	scdk_jpeg_cache_file_slot_t* slots = scdk_jpeg_cache_file_slots(cache);
+	const size_t first_slot = scdk_jpeg_cache_file_first_slot(cache, key);
+
+	// Reuse the first free slot, otherwise the one holding the oldest data
+	scdk_jpeg_cache_file_slot_t* target = NULL;
+
+	for (size_t i = 0; i < SCDK_JPEG_CACHE_FILE_PROBE_COUNT; ++i)
+	{
+		scdk_jpeg_cache_file_slot_t* slot = slots + ((first_slot + i) % cache->file_slot_count);
+
+		if (!scdk_jpeg_cache_file_slot_is_live(cache, slot))
+		{
+			if (target == NULL || scdk_jpeg_cache_file_slot_is_live(cache, target))
+				target = slot;
+
+			continue;
+		}
+
+		// Another process may have encoded the same tile since this one missed it
+		if (scdk_jpeg_cache_file_slot_matches(slot, key))
+		{
+			target = NULL;
+			break;
+		}
+
+		if (target == NULL || (scdk_jpeg_cache_file_slot_is_live(cache, target) && slot->position < target->position))
+			target = slot;
+	}
+
+	if (target)
+	{
+		// Entries never wrap around the end of the ring, so the data of a slot is always contiguous
+		uint64_t position = header->write_position;
+		const size_t offset = position % cache->file_data_length;
+		if (offset + jpeg_length > cache->file_data_length)
+			position += cache->file_data_length - offset;
+
+		target->jpeg_length = 0;
+
+		header->write_position = position + jpeg_length;
+		memcpy(scdk_jpeg_cache_file_data(cache) + (position % cache->file_data_length), jpeg_buffer, jpeg_length);
+
+		target->hash = key->hash;
+		target->position = position;
+		target->checksum = XXH64(jpeg_buffer, jpeg_length, 0);
+		target->quality_percentage = key->quality_percentage;
+		target->device_type = (int32_t)key->device_type;
+		target->pixel_format = (int32_t)key->pixel_format;
+		target->jpeg_encoder = (int32_t)key->jpeg_encoder;
+		target->jpeg_length = (uint32_t)jpeg_length;
+	}
+
+	scdk_shared_file_unlock(&cache->file);
+}
+
+scdk_jpeg_cache_t scdk_jpeg_cache_create(size_t max_size_bytes)
+{
+	scdk_jpeg_cache_impl_t* cache = malloc(sizeof(scdk_jpeg_cache_impl_t));
+	if (cache == NULL)
+		abort();
+
+	scdk_mutex_init(&cache->mutex);
+	cache->reference_count = 1;
+
+	cache->bucket_count = SCDK_JPEG_CACHE_INITIAL_BUCKET_COUNT;
+	cache->buckets = calloc(cache->bucket_count, sizeof(scdk_jpeg_cache_entry_t*));
+	if (cache->buckets == NULL)
+		abort();
+
+	cache->lru_head = NULL;
+	cache->lru_tail = NULL;
+	cache->entry_count = 0;
+	cache->size_bytes = 0;
+	cache->max_size_bytes = max_size_bytes;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->evictions = 0;
+	cache->is_persistent = false;
+	cache->file_slot_count = 0;
+	cache->file_data_length = 0;
+	cache->file_hits = 0;
+
+	return cache;
+}
+
+scdk_jpeg_cache_t scdk_jpeg_cache_create_persistent(const char* path, size_t max_size_bytes,
+                                                    size_t max_file_size_bytes)
+{
+	if (path == NULL)
+		return NULL;
+
+	scdk_jpeg_cache_impl_t* cache = scdk_jpeg_cache_create(max_size_bytes);
+
+	if (!scdk_jpeg_cache_file_open(cache, path, max_file_size_bytes))
+	{
+		scdk_jpeg_cache_free(cache);
+		return NULL;
+	}
+
+	cache->is_persistent = true;
+
+	return cache;
+}
+
+scdk_jpeg_cache_impl_t* scdk_jpeg_cache_retain(scdk_jpeg_cache_impl_t* cache)
+{
+	if (cache == NULL)
+		return NULL;
+
+	scdk_mutex_lock(&cache->mutex);
+	++cache->reference_count;
+	scdk_mutex_unlock(&cache->mutex);
+
+	return cache;
+}
+
+void scdk_jpeg_cache_free(scdk_jpeg_cache_t cache)
+{
+	if (cache == NULL)
+		return;
+
+	scdk_jpeg_cache_impl_t* cache_impl = cache;
+
+	scdk_mutex_lock(&cache_impl->mutex);
+	const int reference_count = --cache_impl->reference_count;
+	scdk_mutex_unlock(&cache_impl->mutex);
+
+	if (reference_count > 0)
+		return;
+
+	scdk_jpeg_cache_entry_t* entry = cache_impl->lru_head;
+	while (entry)
+	{
+		scdk_jpeg_cache_entry_t* next = entry->lru_next;
+		free(entry);
+		entry = next;
+	}
+
+	if (cache_impl->is_persistent)
+		scdk_shared_file_close(&cache_impl->file);
+
+	scdk_mutex_destroy(&cache_impl->mutex);
+
+	free(cache_impl->buckets);
+	free(cache_impl);
+}
+
+void scdk_jpeg_cache_clear(scdk_jpeg_cache_t cache)
+{
+	if (cache == NULL)
+		return;
+
+	scdk_jpeg_cache_impl_t* cache_impl = cache;
+
+	scdk_mutex_lock(&cache_impl->mutex);
+
+	while (cache_impl->lru_head)
+		scdk_jpeg_cache_remove(cache_impl, cache_impl->lru_head);
+
+	if (cache_impl->is_persistent)
+	{
+		scdk_shared_file_lock(&cache_impl->file, true);
+		scdk_jpeg_cache_file_reset(cache_impl);
+		scdk_shared_file_unlock(&cache_impl->file);
+	}
+
+	scdk_mutex_unlock(&cache_impl->mutex);
+}
+
+bool scdk_jpeg_cache_get_stats(scdk_jpeg_cache_t cache, scdk_jpeg_cache_stats_t* stats)
+{
+	if (cache == NULL || stats == NULL)
+		return false;
+
+	scdk_jpeg_cache_impl_t* cache_impl = cache;
+
+	scdk_mutex_lock(&cache_impl->mutex);
+
+	stats->hits = cache_impl->hits;
+	stats->misses = cache_impl->misses;
+	stats->evictions = cache_impl->evictions;
+	stats->entry_count = cache_impl->entry_count;
+	stats->size_bytes = cache_impl->size_bytes;
+	stats->max_size_bytes = cache_impl->max_size_bytes;
+	stats->file_hits = cache_impl->file_hits;
+	stats->file_size_bytes = 0;
+	stats->max_file_size_bytes = cache_impl->file_data_length;
+
+	if (cache_impl->is_persistent)
+	{
+		scdk_shared_file_lock(&cache_impl->file, false);
+		stats->file_size_bytes = (size_t)SCDK_MIN(scdk_jpeg_cache_file_header(cache_impl)->write_position,
+		                                          (uint64_t)cache_impl->file_data_length);
+		scdk_shared_file_unlock(&cache_impl->file);
+	}
+
+	scdk_mutex_unlock(&cache_impl->mutex);
+
+	return true;
+}
+
+// Must be called with mutex held. Returns false if the key was already cached by another device sharing the cache.
+static bool scdk_jpeg_cache_memory_insert(scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key,
+                                          const unsigned char* jpeg_buffer, unsigned long jpeg_length)
+{
+	const size_t entry_size = sizeof(scdk_jpeg_cache_entry_t) + jpeg_length;
+
+	if (entry_size > cache->max_size_bytes)
+		return true;
+
+	scdk_jpeg_cache_entry_t* existing = cache->buckets[scdk_jpeg_cache_bucket(cache, key)];
+	while (existing && !scdk_jpeg_cache_key_equals(&existing->key, key))
+		existing = existing->bucket_next;
+
+	// Another device sharing the cache may have encoded the same tile concurrently
+	if (existing)
+		return false;
+
+	while (cache->size_bytes + entry_size > cache->max_size_bytes && cache->lru_tail)
+	{
+		scdk_jpeg_cache_remove(cache, cache->lru_tail);
+		++cache->evictions;
+	}
+
+	scdk_jpeg_cache_entry_t* entry = malloc(entry_size);
+	if (entry == NULL)
+		abort();
+
+	entry->key = *key;
+	entry->jpeg_length = jpeg_length;
+	memcpy(entry->jpeg, jpeg_buffer, jpeg_length);
+
+	if (cache->entry_count >= cache->bucket_count)
+		scdk_jpeg_cache_grow(cache);
+
+	const size_t bucket = scdk_jpeg_cache_bucket(cache, key);
+	entry->bucket_next = cache->buckets[bucket];
+	cache->buckets[bucket] = entry;
+
+	scdk_jpeg_cache_lru_push_front(cache, entry);
+
+	cache->size_bytes += entry_size;
+	++cache->entry_count;
+
+	return true;
+}
+
+bool scdk_jpeg_cache_lookup(scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key,
+                            unsigned char* dst_buffer, unsigned long* dst_buffer_length)
+{
+	bool is_hit = false;
+
+	scdk_mutex_lock(&cache->mutex);
+
+	scdk_jpeg_cache_entry_t* entry = cache->buckets[scdk_jpeg_cache_bucket(cache, key)];
+	while (entry && !scdk_jpeg_cache_key_equals(&entry->key, key))
+		entry = entry->bucket_next;
+
+	if (entry && entry->jpeg_length <= *dst_buffer_length)
+	{
+		memcpy(dst_buffer, entry->jpeg, entry->jpeg_length);
+		*dst_buffer_length = entry->jpeg_length;
+
+		scdk_jpeg_cache_lru_unlink(cache, entry);
+		scdk_jpeg_cache_lru_push_front(cache, entry);
+
+		++cache->hits;
+		is_hit = true;
+	}
+	else if (cache->is_persistent && scdk_jpeg_cache_file_lookup(cache, key, dst_buffer, dst_buffer_length))
+	{
+		scdk_jpeg_cache_memory_insert(cache, key, dst_buffer, *dst_buffer_length);
+
+		++cache->hits;
+		++cache->file_hits;
+		is_hit = true;
+	}
+	else
+	{
+		++cache->misses;
+	}
+
+	scdk_mutex_unlock(&cache->mutex);
+
+	return is_hit;
+}
+
+void scdk_jpeg_cache_insert(scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key,
+                            const unsigned char* jpeg_buffer, unsigned long jpeg_length)
+{
+	scdk_mutex_lock(&cache->mutex);
+
+	if (scdk_jpeg_cache_memory_insert(cache, key, jpeg_buffer, jpeg_length) && cache->is_persistent)
+		scdk_jpeg_cache_file_insert(cache, key, jpeg_buffer, jpeg_length);
+
+	scdk_mutex_unlock(&cache->mutex);
+}
@@ -0,0 +1,322 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+
+typedef struct scdk_canvas_impl_t scdk_canvas_impl_t;
+
+// Sends each frame to one device from its own thread, so devices are encoded and written in parallel
+typedef struct scdk_canvas_lane_t
+{
+	scdk_canvas_impl_t* canvas_impl;
+	scdk_device_impl_t* device_impl;
+	scdk_thread_t thread;
+
+	int column;
+	int row;
+	int left;
+	int top;
+
+	uint64_t frame_index;
+
+} scdk_canvas_lane_t;
+
+struct scdk_canvas_impl_t
+{
+	int bezel_width;
+	int bezel_height;
+	int width;
+	int height;
+
+	// Serializes frames and layout changes, so a frame is never split against a layout that changes under it
+	scdk_mutex_t submit_mutex;
+
+	scdk_mutex_t mutex;
+	scdk_cond_t work_cond;
+	scdk_cond_t done_cond;
+
+	int lane_count;
+	scdk_canvas_lane_t** lanes;
+
+	const unsigned char* image_buffer;
+	scdk_pixel_format_e pixel_format;
+	int quality_percentage;
+	uint64_t frame_index;
+	int completed_count;
+	bool is_success;
+
+	bool is_shutdown;
+};
+
+static void scdk_canvas_lane_sender(void* arg)
+{
+	scdk_canvas_lane_t* lane = arg;
+	scdk_canvas_impl_t* canvas_impl = lane->canvas_impl;
+
+	scdk_mutex_lock(&canvas_impl->mutex);
+
+	while (true)
+	{
+		while (!canvas_impl->is_shutdown && lane->frame_index == canvas_impl->frame_index)
+			scdk_cond_wait(&canvas_impl->work_cond, &canvas_impl->mutex);
+
+		if (canvas_impl->is_shutdown)
+			break;
+
+		lane->frame_index = canvas_impl->frame_index;
+
+		const scdk_image_view_t image =
+		{
+			canvas_impl->image_buffer, canvas_impl->width, canvas_impl->height, lane->left, lane->top
+		};
+		const scdk_pixel_format_e pixel_format = canvas_impl->pixel_format;
+		const int quality_percentage = canvas_impl->quality_percentage;
+
+		scdk_mutex_unlock(&canvas_impl->mutex);
+
+		const bool is_success = scdk_set_image_view(lane->device_impl, &image, pixel_format, quality_percentage,
+		                                            SCDK_KEY_MASK_ALL);
+
+		scdk_mutex_lock(&canvas_impl->mutex);
+
+		if (!is_success)
+			canvas_impl->is_success = false;
+
+		++canvas_impl->completed_count;
+		scdk_cond_broadcast(&canvas_impl->done_cond);
+	}
+
+	scdk_mutex_unlock(&canvas_impl->mutex);
+}
+
+// Each column is as wide as its widest panel and each row as tall as its tallest, with panels at the top left of their
+// cell. Must be called with the mutex held.
+static void scdk_canvas_layout(scdk_canvas_impl_t* canvas_impl)
+{
+	int column_count = 0;
+	int row_count = 0;
+
+	for (int i = 0; i < canvas_impl->lane_count; ++i)
+	{
+		column_count = SCDK_MAX(column_count, canvas_impl->lanes[i]->column + 1);
+		row_count = SCDK_MAX(row_count, canvas_impl->lanes[i]->row + 1);
+	}
+
+	int* column_lefts = calloc(column_count + 1, sizeof(int));
+	int* row_tops = calloc(row_count + 1, sizeof(int));
+	if (column_lefts == NULL || row_tops == NULL)
+		abort();
+
+	// Accumulate each cell's size into the offset of the next, then turn the sizes into running offsets
+	for (int i = 0; i < canvas_impl->lane_count; ++i)
+	{
+		const scdk_canvas_lane_t* lane = canvas_impl->lanes[i];
+		const scdk_device_type_info_t* type_info = lane->device_impl->type_info;
+
+		column_lefts[lane->column + 1] = SCDK_MAX(column_lefts[lane->column + 1], type_info->image_width);
+		row_tops[lane->row + 1] = SCDK_MAX(row_tops[lane->row + 1], type_info->image_height);
+	}
+
+	for (int column = 1; column <= column_count; ++column)
+		column_lefts[column] += column_lefts[column - 1] + (column > 1 ? canvas_impl->bezel_width : 0);
+
+	for (int row = 1; row <= row_count; ++row)
+		row_tops[row] += row_tops[row - 1] + (row > 1 ? canvas_impl->bezel_height : 0);
+
+	for (int i = 0; i < canvas_impl->lane_count; ++i)
+	{
+		scdk_canvas_lane_t* lane = canvas_impl->lanes[i];
+
+		lane->left = column_lefts[lane->column] + (lane->column > 0 ? canvas_impl->bezel_width : 0);
+		lane->top = row_tops[lane->row] + (lane->row > 0 ? canvas_impl->bezel_height : 0);
+	}
+
+	canvas_impl->width = column_lefts[column_count];
+	canvas_impl->height = row_tops[row_count];
+
+	free(column_lefts);
+	free(row_tops);
+}
+
+scdk_canvas_t scdk_canvas_create(int bezel_width, int bezel_height)
+{
+	// Odd bezels would put panels at odd offsets, where I420 and NV12 chroma samples straddle key edges
+	if (bezel_width < 0 || bezel_height < 0 || bezel_width % 2 != 0 || bezel_height % 2 != 0)
+		return NULL;
+
+	scdk_canvas_impl_t* canvas_impl = malloc(sizeof(scdk_canvas_impl_t));
+	if (canvas_impl == NULL)
+		abort();
+
+	canvas_impl->bezel_width = bezel_width;
+	canvas_impl->bezel_height = bezel_height;
+	canvas_impl->width = 0;
+	canvas_impl->height = 0;
+	canvas_impl->lane_count = 0;
+	canvas_impl->lanes = NULL;
+	canvas_impl->image_buffer = NULL;
+	canvas_impl->frame_index = 0;
+	canvas_impl->completed_count = 0;
+	canvas_impl->is_success = true;
+	canvas_impl->is_shutdown = false;
+
+	scdk_mutex_init(&canvas_impl->submit_mutex);
+	scdk_mutex_init(&canvas_impl->mutex);
+	scdk_cond_init(&canvas_impl->work_cond);
+	scdk_cond_init(&canvas_impl->done_cond);
+
+	return canvas_impl;
+}
+
+void scdk_canvas_free(scdk_canvas_t canvas)
+{
+	if (canvas == NULL)
+		return;
+
+	scdk_canvas_impl_t* canvas_impl = canvas;
+
+	scdk_mutex_lock(&canvas_impl->mutex);
+	canvas_impl->is_shutdown = true;
+	scdk_cond_broadcast(&canvas_impl->work_cond);
+	scdk_mutex_unlock(&canvas_impl->mutex);
+
+	for (int i = 0; i < canvas_impl->lane_count; ++i)
+	{
+		scdk_thread_join(canvas_impl->lanes[i]->thread);
+		free(canvas_impl->lanes[i]);
+	}
+
+	scdk_cond_destroy(&canvas_impl->done_cond);
+	scdk_cond_destroy(&canvas_impl->work_cond);
+	scdk_mutex_destroy(&canvas_impl->mutex);
+	scdk_mutex_destroy(&canvas_impl->submit_mutex);
+
+	free(canvas_impl->lanes);
+	free(canvas_impl);
+}
+
+bool scdk_canvas_add_device(scdk_canvas_t canvas, scdk_device_t device, int column, int row)
+{
+	if (canvas == NULL || device == NULL || column < 0 || row < 0)
+		return false;
+
+	scdk_canvas_impl_t* canvas_impl = canvas;
+	bool is_success = false;
+
+	scdk_mutex_lock(&canvas_impl->submit_mutex);
+	scdk_mutex_lock(&canvas_impl->mutex);
+
+	bool is_taken = false;
+	for (int i = 0; i < canvas_impl->lane_count && !is_taken; ++i)
+	{
+		const scdk_canvas_lane_t* lane = canvas_impl->lanes[i];
+		is_taken = lane->device_impl == device || (lane->column == column && lane->row == row);
+	}
+
+	if (!is_taken)
+	{
+		scdk_canvas_lane_t* lane = malloc(sizeof(scdk_canvas_lane_t));
+		scdk_canvas_lane_t** lanes = realloc(canvas_impl->lanes,
+		                                     (canvas_impl->lane_count + 1) * sizeof(scdk_canvas_lane_t*));
+		if (lane == NULL || lanes == NULL)
+			abort();
+
+		canvas_impl->lanes = lanes;
+
+		lane->canvas_impl = canvas_impl;
+		lane->device_impl = device;
+		lane->column = column;
+		lane->row = row;
+		lane->left = 0;
+		lane->top = 0;
+		lane->frame_index = canvas_impl->frame_index;
+
+		if (scdk_thread_create(&lane->thread, scdk_canvas_lane_sender, lane))
+		{
+			canvas_impl->lanes[canvas_impl->lane_count++] = lane;
+			scdk_canvas_layout(canvas_impl);
+			is_success = true;
+		}
+		else
+		{
+			free(lane);
+		}
+	}
+
+	scdk_mutex_unlock(&canvas_impl->mutex);
+	scdk_mutex_unlock(&canvas_impl->submit_mutex);
+
+	return is_success;
+}
+
+bool scdk_canvas_get_size(scdk_canvas_t canvas, int* width, int* height)
+{
+	if (canvas == NULL || width == NULL || height == NULL)
+		return false;
+
+	scdk_canvas_impl_t* canvas_impl = canvas;
+
+	scdk_mutex_lock(&canvas_impl->mutex);
+	*width = canvas_impl->width;
+	*height = canvas_impl->height;
+	scdk_mutex_unlock(&canvas_impl->mutex);
+
+	return true;
+}
+
+bool scdk_canvas_get_device_position(scdk_canvas_t canvas, scdk_device_t device, int* x, int* y)
+{
+	if (canvas == NULL || device == NULL || x == NULL || y == NULL)
+		return false;
+
+	scdk_canvas_impl_t* canvas_impl = canvas;
+	bool is_found = false;
+
+	scdk_mutex_lock(&canvas_impl->mutex);
+
+	for (int i = 0; i < canvas_impl->lane_count && !is_found; ++i)
+	{
+		if (canvas_impl->lanes[i]->device_impl == device)
+		{
+			*x = canvas_impl->lanes[i]->left;
+			*y = canvas_impl->lanes[i]->top;
+			is_found = true;
+		}
+	}
+
+	scdk_mutex_unlock(&canvas_impl->mutex);
+
+	return is_found;
+}
+
+bool scdk_canvas_set_image(scdk_canvas_t canvas, const unsigned char* image_buffer,
+                           scdk_pixel_format_e pixel_format, int quality_percentage)
+{
+	if (canvas == NULL || image_buffer == NULL || pixel_format < SCDK_PIXEL_FORMAT_RGB
+	    || pixel_format > SCDK_PIXEL_FORMAT_NV12)
+		return false;
+
+	scdk_canvas_impl_t* canvas_impl = canvas;
+
+	scdk_mutex_lock(&canvas_impl->submit_mutex);
+	scdk_mutex_lock(&canvas_impl->mutex);
+
+	canvas_impl->image_buffer = image_buffer;
+	canvas_impl->pixel_format = pixel_format;
+	canvas_impl->quality_percentage = quality_percentage;
+	canvas_impl->completed_count = 0;
+	canvas_impl->is_success = true;
+	++canvas_impl->frame_index;
+	scdk_cond_broadcast(&canvas_impl->work_cond);
+
+	// Every lane references the caller's buffer, so wait for all of them before returning
+	while (canvas_impl->completed_count < canvas_impl->lane_count)
+		scdk_cond_wait(&canvas_impl->done_cond, &canvas_impl->mutex);
+
+	const bool is_success = canvas_impl->is_success;
+	canvas_impl->image_buffer = NULL;
+
+	scdk_mutex_unlock(&canvas_impl->mutex);
+	scdk_mutex_unlock(&canvas_impl->submit_mutex);
+
+	return is_success;
+}
@@ -0,0 +1,207 @@
+#include "scdk_internal.h"
+
+// Extraction is written once against geometry parameters and forced inline into a copy for each key geometry, where
+// the geometry is a compile time constant, and into a generic copy reading it from the type info at runtime. Rows are
+// copied by the row kernels instantiated for the key width, so their lengths are constant as well.
+
+// Distinct key geometries of SCDK_DEVICE_TYPES: X(key_width, key_height, key_gap_width, key_gap_height). Key widths
+// should be among SCDK_KERNELS_KEY_WIDTHS.
+#define SCDK_KEY_GEOMETRIES(X) \
+	X(72, 72, 38, 38)          \
+	X(80, 80, 38, 38)          \
+	X(96, 96, 38, 38)
+
+static SCDK_ALWAYS_INLINE void scdk_extract_key_geometry(const scdk_key_row_kernels_t* row_kernels,
+                                                         const scdk_image_view_t* image,
+                                                         int pixel_size, int key_x, int key_y, unsigned char* dst,
+                                                         const int key_width, const int key_height,
+                                                         const int key_gap_width, const int key_gap_height)
+{
+	const size_t image_line_length = (size_t)image->width * pixel_size;
+	const int key_image_line_length = key_width * pixel_size;
+	const int row = (image->left + (key_x * (key_width + key_gap_width))) * pixel_size;
+	const scdk_reverse_row_func_t reverse_row = pixel_size == 3 ? row_kernels->reverse_row_24
+	                                                            : row_kernels->reverse_row_32;
+
+	for (int y = 0; y < key_height; ++y)
+	{
+		const int line = image->top + ((key_y * (key_height + key_gap_height)) + key_height) - y - 1;
+
+		reverse_row(image->buffer + (line * image_line_length) + row, dst, key_width);
+		dst += key_image_line_length;
+	}
+}
+
+static SCDK_ALWAYS_INLINE void scdk_extract_key_yuv420_geometry(const scdk_key_row_kernels_t* row_kernels,
+                                                                const scdk_image_view_t* image,
+                                                                scdk_pixel_format_e pixel_format,
+                                                                int key_x, int key_y, unsigned char* dst,
+                                                                const int key_width, const int key_height,
+                                                                const int key_gap_width, const int key_gap_height)
+{
+	const int pixel_size = scdk_pixel_size(pixel_format);
+	const size_t image_line_length = (size_t)image->width * pixel_size;
+	const int row = (image->left + (key_x * (key_width + key_gap_width))) * pixel_size;
+	const int chroma_width = key_width / 2;
+	const scdk_reverse_rows_yuv420_func_t reverse_rows = row_kernels->reverse_rows_yuv420[pixel_format];
+
+	unsigned char* y_plane = dst;
+	unsigned char* cb_plane = y_plane + (key_width * key_height);
+	unsigned char* cr_plane = cb_plane + (chroma_width * (key_height / 2));
+
+	for (int y = 0; y < key_height; y += 2)
+	{
+		const int line = image->top + ((key_y * (key_height + key_gap_height)) + key_height) - y - 1;
+		const unsigned char* src = image->buffer + (line * image_line_length) + row;
+
+		reverse_rows(src, src - image_line_length, y_plane, y_plane + key_width, cb_plane, cr_plane, key_width);
+
+		y_plane += key_width * 2;
+		cb_plane += chroma_width;
+		cr_plane += chroma_width;
+	}
+}
+
+static SCDK_ALWAYS_INLINE void scdk_extract_key_yuv_geometry(const scdk_key_row_kernels_t* row_kernels,
+                                                             const scdk_image_view_t* image,
+                                                             scdk_pixel_format_e pixel_format,
+                                                             int key_x, int key_y, unsigned char* dst,
+                                                             const int key_width, const int key_height,
+                                                             const int key_gap_width, const int key_gap_height)
+{
+	// Key positions and sizes are even on every device, and panels are placed at even offsets, so chroma samples never
+	// straddle a key edge
+	const int chroma_image_width = image->width / 2;
+	const int chroma_key_width = key_width / 2;
+	const int chroma_key_height = key_height / 2;
+	const int top = image->top + (key_y * (key_height + key_gap_height));
+	const int left = image->left + (key_x * (key_width + key_gap_width));
+
+	const unsigned char* y_src = image->buffer + left;
+	const unsigned char* chroma_src = image->buffer + ((size_t)image->width * image->height);
+
+	unsigned char* y_plane = dst;
+	unsigned char* cb_plane = y_plane + (key_width * key_height);
+	unsigned char* cr_plane = cb_plane + (chroma_key_width * chroma_key_height);
+
+	for (int y = 0; y < key_height; ++y)
+	{
+		const int line = top + key_height - y - 1;
+
+		row_kernels->reverse_row_8(y_src + ((size_t)line * image->width), y_plane, key_width);
+		y_plane += key_width;
+	}
+
+	for (int y = 0; y < chroma_key_height; ++y)
+	{
+		const int line = (top / 2) + chroma_key_height - y - 1;
+
+		if (pixel_format == SCDK_PIXEL_FORMAT_NV12)
+		{
+			row_kernels->reverse_row_uv_chroma(chroma_src + ((size_t)line * image->width) + left, cb_plane, cr_plane,
+			                                   chroma_key_width);
+		}
+		else
+		{
+			const unsigned char* cb_src = chroma_src + ((size_t)line * chroma_image_width) + (left / 2);
+			const unsigned char* cr_src = cb_src + ((size_t)chroma_image_width * (image->height / 2));
+
+			row_kernels->reverse_row_8_chroma(cb_src, cb_plane, chroma_key_width);
+			row_kernels->reverse_row_8_chroma(cr_src, cr_plane, chroma_key_width);
+		}
+
+		cb_plane += chroma_key_width;
+		cr_plane += chroma_key_width;
+	}
+}
+
+static void scdk_extract_key_generic(const scdk_key_row_kernels_t* row_kernels,
+                                     const scdk_device_type_info_t* type_info,
+                                     const scdk_image_view_t* image, int pixel_size, int key_x, int key_y,
+                                     unsigned char* dst)
+{
+	scdk_extract_key_geometry(row_kernels, image, pixel_size, key_x, key_y, dst, type_info->key_image_width,
+	                          type_info->key_image_height, type_info->key_gap_width, type_info->key_gap_height);
+}
+
+static void scdk_extract_key_yuv420_generic(const scdk_key_row_kernels_t* row_kernels,
+                                            const scdk_device_type_info_t* type_info,
+                                            const scdk_image_view_t* image, scdk_pixel_format_e pixel_format,
+                                            int key_x, int key_y, unsigned char* dst)
+{
+	scdk_extract_key_yuv420_geometry(row_kernels, image, pixel_format, key_x, key_y, dst,
+	                                 type_info->key_image_width, type_info->key_image_height,
+	                                 type_info->key_gap_width, type_info->key_gap_height);
+}
+
+static void scdk_extract_key_yuv_generic(const scdk_key_row_kernels_t* row_kernels,
+                                         const scdk_device_type_info_t* type_info,
+                                         const scdk_image_view_t* image, scdk_pixel_format_e pixel_format,
+                                         int key_x, int key_y, unsigned char* dst)
+{
+	scdk_extract_key_yuv_geometry(row_kernels, image, pixel_format, key_x, key_y, dst, type_info->key_image_width,
+	                              type_info->key_image_height, type_info->key_gap_width, type_info->key_gap_height);
+}
+
+static const scdk_extractors_t scdk_extractors_generic =
+{
+	"generic",
+	scdk_extract_key_generic,
+	scdk_extract_key_yuv420_generic,
+	scdk_extract_key_yuv_generic
+};
+
+#define SCDK_EXTRACTORS(key_width, key_height, key_gap_width, key_gap_height)                                        \
+static void scdk_extract_key_##key_width##x##key_height(const scdk_key_row_kernels_t* row_kernels,                   \
+                                                       const scdk_device_type_info_t* type_info,                      \
+                                                       const scdk_image_view_t* image, int pixel_size,                \
+                                                       int key_x, int key_y, unsigned char* dst)                      \
+{                                                                                                                     \
+	(void)type_info;                                                                                                  \
+	scdk_extract_key_geometry(row_kernels, image, pixel_size, key_x, key_y, dst,                                      \
+	                          key_width, key_height, key_gap_width, key_gap_height);                                  \
+}                                                                                                                     \
+                                                                                                                      \
+static void scdk_extract_key_yuv420_##key_width##x##key_height(const scdk_key_row_kernels_t* row_kernels,            \
+                                                              const scdk_device_type_info_t* type_info,               \
+                                                              const scdk_image_view_t* image,                         \
+                                                              scdk_pixel_format_e pixel_format,                       \
+                                                              int key_x, int key_y, unsigned char* dst)               \
+{                                                                                                                     \
+	(void)type_info;                                                                                                  \
+	scdk_extract_key_yuv420_geometry(row_kernels, image, pixel_format, key_x, key_y, dst,                             \
+	                                 key_width, key_height, key_gap_width, key_gap_height);                           \
+}                                                                                                                     \
+                                                                                                                      \
+static void scdk_extract_key_yuv_##key_width##x##key_height(const scdk_key_row_kernels_t* row_kernels,               \
+                                                           const scdk_device_type_info_t* type_info,                  \
+                                                           const scdk_image_view_t* image,                            \
+                                                           scdk_pixel_format_e pixel_format,                          \
+                                                           int key_x, int key_y, unsigned char* dst)                  \
+{                                                                                                                     \
+	(void)type_info;                                                                                                  \
+	scdk_extract_key_yuv_geometry(row_kernels, image, pixel_format, key_x, key_y, dst,                                \
+	                              key_width, key_height, key_gap_width, key_gap_height);                              \
+}                                                                                                                     \
+                                                                                                                      \
+static const scdk_extractors_t scdk_extractors_##key_width##x##key_height =                                          \
+{                                                                                                                     \
+	#key_width "x" #key_height,                                                                                       \
+	scdk_extract_key_##key_width##x##key_height,                                                                      \
+	scdk_extract_key_yuv420_##key_width##x##key_height,                                                               \
+	scdk_extract_key_yuv_##key_width##x##key_height                                                                   \
+};
+
+SCDK_KEY_GEOMETRIES(SCDK_EXTRACTORS)
+
+#define SCDK_EXTRACTORS_MATCH(width, height, gap_width, gap_height)                                                   \
+	if (type_info->key_image_width == width && type_info->key_image_height == height                                  \
+	    && type_info->key_gap_width == gap_width && type_info->key_gap_height == gap_height)                          \
+		return &scdk_extractors_##width##x##height;
+
+const scdk_extractors_t* scdk_get_extractors(const scdk_device_type_info_t* type_info)
+{
+	SCDK_KEY_GEOMETRIES(SCDK_EXTRACTORS_MATCH)
+
+	return &scdk_extractors_generic;
+}
@@ -0,0 +1,513 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define SCDK_INPUT_QUEUE_CAPACITY 256
+
+// Bounds how long stopping input waits for the input thread to notice
+#define SCDK_INPUT_READ_TIMEOUT_MS 50
+
+struct scdk_input_t
+{
+	scdk_device_impl_t* device_impl;
+	scdk_thread_t thread;
+	scdk_mutex_t mutex;
+
+	// Owned by the input thread, so reads never share a buffer with the caller's threads
+	size_t report_buffer_length;
+	unsigned char* report_buffer;
+
+	// Also owned by the input thread. raw_states is the last state reported by the device, key_states the debounced
+	// state events have been sent for. Keys in hold_mask are down and waiting for their next long press or repeat.
+	scdk_key_mask_t raw_states;
+	scdk_key_mask_t key_states;
+	scdk_key_mask_t hold_mask;
+	scdk_key_mask_t long_pressed_mask;
+	uint64_t* change_times_us;
+	uint64_t* hold_deadlines_us;
+
+	scdk_key_event_callback_t callback;
+	void* callback_user_data;
+	scdk_input_config_t config;
+
+	scdk_key_event_t queue[SCDK_INPUT_QUEUE_CAPACITY];
+	size_t queue_head;
+	size_t queue_count;
+
+	// Readable while the queue is not empty, or once the thread has failed
+	int notify_fds[2];
+
+	bool is_shutdown;
+	bool is_failed;
+};
+
+#ifndef _WIN32
+
+static bool scdk_input_notify_create(int* fds)
+{
+	if (pipe(fds) != 0)
+		return false;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+		fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	return true;
+}
+
+static void scdk_input_notify_free(int* fds)
+{
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static void scdk_input_notify_set(int* fds)
+{
+	const unsigned char byte = 1;
+	while (write(fds[1], &byte, 1) == -1 && errno == EINTR)
+		;
+}
+
+static void scdk_input_notify_clear(int* fds)
+{
+	unsigned char bytes[64];
+	while (read(fds[0], bytes, sizeof(bytes)) > 0)
+		;
+}
+
+#else
+
+static bool scdk_input_notify_create(int* fds)
+{
+	fds[0] = -1;
+	fds[1] = -1;
+	return true;
+}
+
+static void scdk_input_notify_free(int* fds)
+{
+	(void)fds;
+}
+
+static void scdk_input_notify_set(int* fds)
+{
+	(void)fds;
+}
+
+static void scdk_input_notify_clear(int* fds)
+{
+	(void)fds;
+}
+
+#endif
+
+// Must be called with the mutex held. When the queue is full the oldest event is dropped.
+static void scdk_input_push(scdk_input_t* input, const scdk_key_event_t* event)
+{
+	if (input->queue_count == SCDK_INPUT_QUEUE_CAPACITY)
+	{
+		input->queue_head = (input->queue_head + 1) % SCDK_INPUT_QUEUE_CAPACITY;
+		--input->queue_count;
+	}
+
+	input->queue[(input->queue_head + input->queue_count) % SCDK_INPUT_QUEUE_CAPACITY] = *event;
+
+	if (input->queue_count++ == 0)
+		scdk_input_notify_set(input->notify_fds);
+}
+
+static void scdk_input_emit(scdk_input_t* input, int key_index, scdk_key_event_type_e type, uint64_t timestamp_us)
+{
+	const bool is_pressed = type != SCDK_KEY_EVENT_TYPE_UP && type != SCDK_KEY_EVENT_TYPE_DISCONNECTED;
+	const scdk_key_event_t event = { key_index, is_pressed, timestamp_us, type };
+
+	scdk_mutex_lock(&input->mutex);
+	const scdk_key_event_callback_t callback = input->callback;
+	void* user_data = input->callback_user_data;
+
+	if (callback == NULL)
+		scdk_input_push(input, &event);
+
+	scdk_mutex_unlock(&input->mutex);
+
+	if (callback)
+		callback(input->device_impl, &event, user_data);
+}
+
+// Packs the key bytes of a report into a mask, keeping the previous state of any keys the report is too short to hold
+static scdk_key_mask_t scdk_input_parse_report(const scdk_input_t* input, int report_key_count)
+{
+	const unsigned char* key_bytes = input->report_buffer + SD_IN_REPORT_HEADER_LENGTH;
+	scdk_key_mask_t states = 0;
+
+	for (int key_index = 0; key_index < report_key_count; ++key_index)
+		states |= (scdk_key_mask_t)(key_bytes[key_index] != 0) << key_index;
+
+	const scdk_key_mask_t report_mask = SCDK_KEY_MASK_BIT(report_key_count) - 1;
+
+	return (input->raw_states & ~report_mask) | states;
+}
+
+// Sends events for debounced state changes and for held keys that are due a long press or repeat
+static void scdk_input_update(scdk_input_t* input, const scdk_input_config_t* config, uint64_t now_us)
+{
+	const uint64_t debounce_us = (uint64_t)config->debounce_ms * 1000;
+	const uint64_t long_press_us = (uint64_t)config->long_press_ms * 1000;
+	const uint64_t repeat_interval_us = (uint64_t)config->repeat_interval_ms * 1000;
+
+	// Long presses may have been turned off while keys were held
+	if (long_press_us == 0)
+		input->hold_mask = 0;
+
+	scdk_key_mask_t changed_mask = input->raw_states ^ input->key_states;
+
+	while (changed_mask)
+	{
+		const int key_index = scdk_key_mask_first(changed_mask);
+		const scdk_key_mask_t key_bit = SCDK_KEY_MASK_BIT(key_index);
+		changed_mask &= changed_mask - 1;
+
+		// Left pending until the debounce time is up, when it is only reported if the key is still in the new state
+		if (now_us - input->change_times_us[key_index] < debounce_us)
+			continue;
+
+		input->key_states ^= key_bit;
+		input->change_times_us[key_index] = now_us;
+		input->long_pressed_mask &= ~key_bit;
+
+		const bool is_pressed = (input->key_states & key_bit) != 0;
+
+		if (is_pressed && long_press_us > 0)
+		{
+			input->hold_mask |= key_bit;
+			input->hold_deadlines_us[key_index] = now_us + long_press_us;
+		}
+		else
+		{
+			input->hold_mask &= ~key_bit;
+		}
+
+		scdk_input_emit(input, key_index, is_pressed ? SCDK_KEY_EVENT_TYPE_DOWN : SCDK_KEY_EVENT_TYPE_UP, now_us);
+	}
+
+	scdk_key_mask_t due_mask = input->hold_mask;
+
+	while (due_mask)
+	{
+		const int key_index = scdk_key_mask_first(due_mask);
+		const scdk_key_mask_t key_bit = SCDK_KEY_MASK_BIT(key_index);
+		due_mask &= due_mask - 1;
+
+		if (now_us < input->hold_deadlines_us[key_index])
+			continue;
+
+		const bool is_repeat = (input->long_pressed_mask & key_bit) != 0;
+		input->long_pressed_mask |= key_bit;
+
+		// Repeats missed while the thread was delayed are skipped rather than sent in a burst
+		if (repeat_interval_us > 0)
+			input->hold_deadlines_us[key_index] = SCDK_MAX(input->hold_deadlines_us[key_index] + repeat_interval_us,
+			                                               now_us + 1);
+		else
+			input->hold_mask &= ~key_bit;
+
+		scdk_input_emit(input, key_index, is_repeat ? SCDK_KEY_EVENT_TYPE_REPEAT : SCDK_KEY_EVENT_TYPE_LONG_PRESS,
+		                now_us);
+	}
+}
+
+// Reads wait no longer than until the next pending debounce or hold deadline, so those events are sent on time
+static int scdk_input_read_timeout_ms(const scdk_input_t* input, const scdk_input_config_t* config, uint64_t now_us)
+{
+	const uint64_t debounce_us = (uint64_t)config->debounce_ms * 1000;
+	uint64_t deadline_us = now_us + (SCDK_INPUT_READ_TIMEOUT_MS * 1000);
+
+	scdk_key_mask_t pending_mask = input->raw_states ^ input->key_states;
+
+	while (pending_mask)
+	{
+		const int key_index = scdk_key_mask_first(pending_mask);
+		pending_mask &= pending_mask - 1;
+
+		deadline_us = SCDK_MIN(deadline_us, input->change_times_us[key_index] + debounce_us);
+	}
+
+	scdk_key_mask_t hold_mask = input->hold_mask;
+
+	while (hold_mask)
+	{
+		const int key_index = scdk_key_mask_first(hold_mask);
+		hold_mask &= hold_mask - 1;
+
+		deadline_us = SCDK_MIN(deadline_us, input->hold_deadlines_us[key_index]);
+	}
+
+	return deadline_us > now_us ? (int)((deadline_us - now_us + 999) / 1000) : 0;
+}
+
+static void scdk_input_reader(void* arg)
+{
+	scdk_input_t* input = arg;
+	scdk_device_impl_t* device_impl = input->device_impl;
+	const int key_count = device_impl->type_info->columns * device_impl->type_info->rows;
+
+	while (true)
+	{
+		scdk_mutex_lock(&input->mutex);
+		const bool is_shutdown = input->is_shutdown;
+		const scdk_input_config_t config = input->config;
+		scdk_mutex_unlock(&input->mutex);
+
+		if (is_shutdown)
+			break;
+
+		const int bytes = device_impl->transport->read_timeout(device_impl->transport_context, input->report_buffer,
+		                                                       input->report_buffer_length,
+		                                                       scdk_input_read_timeout_ms(input, &config,
+		                                                                                  scdk_time_now_us()));
+		if (bytes == -1)
+		{
+			scdk_device_set_disconnected(device_impl);
+
+			// Marked before the event is sent, so a caller woken by it can already read keys or restart input
+			scdk_mutex_lock(&input->mutex);
+			input->is_failed = true;
+			scdk_input_notify_set(input->notify_fds);
+			scdk_mutex_unlock(&input->mutex);
+
+			scdk_input_emit(input, -1, SCDK_KEY_EVENT_TYPE_DISCONNECTED, scdk_time_now_us());
+			break;
+		}
+
+		if (bytes > SD_IN_REPORT_HEADER_LENGTH)
+			input->raw_states = scdk_input_parse_report(input,
+			                                            SCDK_MIN(bytes - SD_IN_REPORT_HEADER_LENGTH, key_count));
+
+		scdk_input_update(input, &config, scdk_time_now_us());
+	}
+}
+
+bool scdk_input_is_running(scdk_input_t* input)
+{
+	scdk_mutex_lock(&input->mutex);
+	const bool is_running = !input->is_failed;
+	scdk_mutex_unlock(&input->mutex);
+
+	return is_running;
+}
+
+void scdk_input_free(scdk_input_t* input)
+{
+	if (input == NULL)
+		return;
+
+	scdk_mutex_lock(&input->mutex);
+	input->is_shutdown = true;
+	scdk_mutex_unlock(&input->mutex);
+
+	scdk_thread_join(input->thread);
+
+	scdk_input_notify_free(input->notify_fds);
+	scdk_mutex_destroy(&input->mutex);
+
+	free(input->report_buffer);
+	free(input->change_times_us);
+	free(input->hold_deadlines_us);
+	free(input);
+}
+
+static scdk_input_t* scdk_input_create(scdk_device_impl_t* device_impl, scdk_key_event_callback_t callback,
+                                       void* user_data, const scdk_input_config_t* config)
+{
+	const int key_count = device_impl->type_info->columns * device_impl->type_info->rows;
+
+	scdk_input_t* input = malloc(sizeof(scdk_input_t));
+	if (input == NULL)
+		abort();
+
+	input->device_impl = device_impl;
+	input->report_buffer_length = key_count + SD_IN_REPORT_HEADER_LENGTH;
+	input->report_buffer = malloc(input->report_buffer_length);
+	input->change_times_us = calloc(key_count, sizeof(uint64_t));
+	input->hold_deadlines_us = calloc(key_count, sizeof(uint64_t));
+	if (input->report_buffer == NULL || input->change_times_us == NULL || input->hold_deadlines_us == NULL)
+		abort();
+
+	input->raw_states = 0;
+	input->key_states = 0;
+	input->hold_mask = 0;
+	input->long_pressed_mask = 0;
+	input->callback = callback;
+	input->callback_user_data = user_data;
+	input->config = *config;
+	input->queue_head = 0;
+	input->queue_count = 0;
+	input->is_shutdown = false;
+	input->is_failed = false;
+
+	if (!scdk_input_notify_create(input->notify_fds))
+	{
+		free(input->report_buffer);
+		free(input->change_times_us);
+		free(input->hold_deadlines_us);
+		free(input);
+		return NULL;
+	}
+
+	scdk_mutex_init(&input->mutex);
+
+	if (!scdk_thread_create(&input->thread, scdk_input_reader, input))
+	{
+		scdk_mutex_destroy(&input->mutex);
+		scdk_input_notify_free(input->notify_fds);
+		free(input->report_buffer);
+		free(input->change_times_us);
+		free(input->hold_deadlines_us);
+		free(input);
+		return NULL;
+	}
+
+	return input;
+}
+
+static void scdk_input_set_callback(scdk_input_t* input, scdk_key_event_callback_t callback, void* user_data)
+{
+	scdk_mutex_lock(&input->mutex);
+	input->callback = callback;
+	input->callback_user_data = user_data;
+	scdk_mutex_unlock(&input->mutex);
+}
+
+bool scdk_start_input(scdk_device_t device, scdk_key_event_callback_t callback, void* user_data)
+{
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	// Waits for any synchronous key read in progress, so the input thread never reads concurrently with one
+	scdk_mutex_lock(&device_impl->read_mutex);
+	scdk_mutex_lock(&device_impl->lifecycle_mutex);
+
+	// A thread that stopped on a read failure is replaced. It is freed after unlocking, as it may still be in the
+	// callback for its disconnected event.
+	scdk_input_t* failed_input = NULL;
+
+	if (device_impl->input && !scdk_input_is_running(device_impl->input))
+	{
+		failed_input = device_impl->input;
+		device_impl->input = NULL;
+	}
+
+	if (device_impl->input == NULL)
+		device_impl->input = scdk_input_create(device_impl, callback, user_data, &device_impl->input_config);
+	else
+		scdk_input_set_callback(device_impl->input, callback, user_data);
+
+	const bool is_success = device_impl->input != NULL;
+
+	scdk_mutex_unlock(&device_impl->lifecycle_mutex);
+	scdk_mutex_unlock(&device_impl->read_mutex);
+
+	scdk_input_free(failed_input);
+
+	return is_success;
+}
+
+bool scdk_set_input_config(scdk_device_t device, const scdk_input_config_t* config)
+{
+	if (device == NULL || config == NULL || config->debounce_ms < 0 || config->long_press_ms < 0
+	    || config->repeat_interval_ms < 0)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->lifecycle_mutex);
+
+	device_impl->input_config = *config;
+
+	if (device_impl->input)
+	{
+		scdk_mutex_lock(&device_impl->input->mutex);
+		device_impl->input->config = *config;
+		scdk_mutex_unlock(&device_impl->input->mutex);
+	}
+
+	scdk_mutex_unlock(&device_impl->lifecycle_mutex);
+
+	return true;
+}
+
+void scdk_stop_input(scdk_device_t device)
+{
+	if (device == NULL)
+		return;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->lifecycle_mutex);
+	scdk_input_t* input = device_impl->input;
+	device_impl->input = NULL;
+	scdk_mutex_unlock(&device_impl->lifecycle_mutex);
+
+	scdk_input_free(input);
+}
+
+size_t scdk_poll_key_events(scdk_device_t device, scdk_key_event_t* events, size_t max_event_count)
+{
+	if (device == NULL || events == NULL)
+		return 0;
+
+	scdk_device_impl_t* device_impl = device;
+	size_t event_count = 0;
+
+	// Holding the lifecycle mutex keeps the input state alive against a concurrent scdk_stop_input
+	scdk_mutex_lock(&device_impl->lifecycle_mutex);
+
+	scdk_input_t* input = device_impl->input;
+
+	if (input)
+	{
+		scdk_mutex_lock(&input->mutex);
+
+		event_count = SCDK_MIN(input->queue_count, max_event_count);
+
+		for (size_t i = 0; i < event_count; ++i)
+			events[i] = input->queue[(input->queue_head + i) % SCDK_INPUT_QUEUE_CAPACITY];
+
+		input->queue_head = (input->queue_head + event_count) % SCDK_INPUT_QUEUE_CAPACITY;
+		input->queue_count -= event_count;
+
+		if (input->queue_count == 0 && !input->is_failed)
+			scdk_input_notify_clear(input->notify_fds);
+
+		scdk_mutex_unlock(&input->mutex);
+	}
+
+	scdk_mutex_unlock(&device_impl->lifecycle_mutex);
+
+	return event_count;
+}
+
+int scdk_get_input_fd(scdk_device_t device)
+{
+	if (device == NULL)
+		return -1;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->lifecycle_mutex);
+	const int fd = device_impl->input ? device_impl->input->notify_fds[0] : -1;
+	scdk_mutex_unlock(&device_impl->lifecycle_mutex);
+
+	return fd;
+}
@@ -0,0 +1,438 @@
+#ifndef SCDK_INTERNAL_H
+#define SCDK_INTERNAL_H
+
+#include "screamdeck.h"
+#include "scdk_kernels.h"
+#include "scdk_platform.h"
+
+#include <hidapi/hidapi.h>
+#include <turbojpeg.h>
+
+// Exposes XXH3_state_t so streaming hash state can live on the stack
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
+
+#define SD_VENDOR_ID 0x0fd9
+
+#define SCDK_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define SCDK_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define SCDK_CLAMP(x, lo, hi) SCDK_MIN(hi, (SCDK_MAX(lo, x)))
+
+#define SD_OUT_FEATURE_REPORT_LENGTH 32
+#define SD_OUT_REPORT_LENGTH 1024
+#define SD_OUT_REPORT_HEADER_LENGTH 8
+#define SD_OUT_REPORT_IMAGE_LENGTH (SD_OUT_REPORT_LENGTH - SD_OUT_REPORT_HEADER_LENGTH)
+#define SD_IN_REPORT_HEADER_LENGTH 4
+
+// Geometry of every device type, as name, columns, rows, key width and height, and key gap width and height. Device
+// type info and extraction specialized for each device type are both generated from this table.
+#define SCDK_DEVICE_TYPES(X)               \
+	X(MINI, 3, 2, 80, 80, 38, 38)         \
+	X(MINI_MK2, 3, 2, 80, 80, 38, 38)     \
+	X(ORIGINAL, 5, 3, 72, 72, 38, 38)     \
+	X(ORIGINAL_MK2, 5, 3, 72, 72, 38, 38) \
+	X(MK2, 5, 3, 72, 72, 38, 38)          \
+	X(XL, 8, 4, 96, 96, 38, 38)           \
+	X(XL_MK2, 8, 4, 96, 96, 38, 38)
+
+// Times a failed report write is retried before the upload is abandoned
+#define SCDK_WRITE_RETRY_COUNT 2
+
+// Internal format of key tiles extracted straight to contiguous Y, Cb and Cr planes subsampled 4:2:0
+#define SCDK_PIXEL_FORMAT_TILE_YUV420 ((scdk_pixel_format_e)0x100)
+
+// One bit per key index; every supported device has at most 32 keys
+typedef uint64_t scdk_key_mask_t;
+
+#define SCDK_KEY_MASK_ALL (~(scdk_key_mask_t)0)
+#define SCDK_KEY_MASK_BIT(key_index) ((scdk_key_mask_t)1 << (key_index))
+
+// Returns the lowest key index in a mask, which must not be empty
+static inline int scdk_key_mask_first(scdk_key_mask_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(mask);
+#else
+	int key_index = 0;
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		++key_index;
+	}
+
+	return key_index;
+#endif
+}
+
+typedef struct scdk_jpeg_cache_key_t
+{
+	XXH64_hash_t hash;
+	int quality_percentage;
+	scdk_device_type_e device_type;
+	scdk_pixel_format_e pixel_format;
+	scdk_jpeg_encoder_e jpeg_encoder;
+
+} scdk_jpeg_cache_key_t;
+
+// Moves reports to and from a device. Like the hidapi functions they wrap, functions return -1 on failure.
+typedef struct scdk_transport_t
+{
+	int (*write)(void* context, const unsigned char* data, size_t length);
+	int (*read_timeout)(void* context, unsigned char* data, size_t length, int timeout_ms);
+	int (*send_feature_report)(void* context, const unsigned char* data, size_t length);
+	int (*get_serial_number)(void* context, wchar_t* serial_number, size_t serial_number_length);
+	void (*close)(void* context);
+
+} scdk_transport_t;
+
+extern const scdk_transport_t scdk_transport_hid;
+extern const scdk_transport_t scdk_transport_virtual;
+
+// Encodes key tiles to JPEG. create returns a context for encoding tiles of a device type from one thread, or NULL on
+// failure. encode takes a tile in a packed RGB format or TILE_YUV420, and like tjCompress2 with TJFLAG_NOREALLOC,
+// dst_buffer_length holds the buffer's capacity on entry and the JPEG's length on return.
+typedef struct scdk_encoder_t
+{
+	const char* name;
+
+	// Encoders differ in their output, so JPEG caches keep each one's apart by this
+	scdk_jpeg_encoder_e type;
+
+	void* (*create)(const scdk_device_type_info_t* type_info);
+	bool (*encode)(void* context, const unsigned char* image_buffer, scdk_pixel_format_e pixel_format,
+	               int quality_percentage, unsigned char* dst_buffer, unsigned long* dst_buffer_length);
+	void (*free)(void* context);
+
+} scdk_encoder_t;
+
+extern const scdk_encoder_t scdk_encoder_turbojpeg;
+extern const scdk_encoder_t scdk_encoder_builtin;
+
+// A thread's context for whichever encoder it last encoded with, recreated when the encoder changes
+typedef struct scdk_encoder_state_t
+{
+	const scdk_encoder_t* encoder;
+	void* context;
+
+} scdk_encoder_state_t;
+
+void scdk_encoder_state_free(scdk_encoder_state_t* encoder_state);
+
+typedef struct scdk_jpeg_cache_impl_t scdk_jpeg_cache_impl_t;
+typedef struct scdk_pool_t scdk_pool_t;
+typedef struct scdk_writer_t scdk_writer_t;
+typedef struct scdk_async_t scdk_async_t;
+typedef struct scdk_input_t scdk_input_t;
+typedef struct scdk_rate_control_t scdk_rate_control_t;
+typedef struct scdk_change_tolerance_t scdk_change_tolerance_t;
+typedef struct scdk_scheduler_t scdk_scheduler_t;
+
+// An image holding a device's panel, which may be part of a larger image: the buffer's full size in pixels and the
+// position of the panel's top left corner within it. For I420 and NV12 the position must be even.
+typedef struct scdk_image_view_t
+{
+	const unsigned char* buffer;
+	int width;
+	int height;
+	int left;
+	int top;
+
+} scdk_image_view_t;
+
+// Key extraction for one key geometry. Each function writes a key, rotated as the device expects, from the panel
+// within image to dst: extract_key as packed 24 or 32 bit pixels, extract_key_yuv420 converting a packed RGB format
+// to the TILE_YUV420 layout, and extract_key_yuv slicing the Y, Cb and Cr planes of an I420 or NV12 image into it.
+// Rows are copied with row_kernels, which must be the row kernels for the key width.
+typedef struct scdk_extractors_t
+{
+	const char* name;
+	void (*extract_key)(const scdk_key_row_kernels_t* row_kernels, const scdk_device_type_info_t* type_info,
+	                    const scdk_image_view_t* image, int pixel_size, int key_x, int key_y, unsigned char* dst);
+	void (*extract_key_yuv420)(const scdk_key_row_kernels_t* row_kernels, const scdk_device_type_info_t* type_info,
+	                           const scdk_image_view_t* image, scdk_pixel_format_e pixel_format,
+	                           int key_x, int key_y, unsigned char* dst);
+	void (*extract_key_yuv)(const scdk_key_row_kernels_t* row_kernels, const scdk_device_type_info_t* type_info,
+	                        const scdk_image_view_t* image, scdk_pixel_format_e pixel_format,
+	                        int key_x, int key_y, unsigned char* dst);
+
+} scdk_extractors_t;
+
+// Qualities the keys of one frame are encoded at. Keys in refine_mask are re-sent at refine_quality_percentage even if
+// they are unchanged.
+typedef struct scdk_frame_quality_t
+{
+	int quality_percentage;
+	scdk_key_mask_t refine_mask;
+	int refine_quality_percentage;
+
+} scdk_frame_quality_t;
+
+typedef struct scdk_device_impl_t
+{
+	const scdk_transport_t* transport;
+	void* transport_context;
+	const scdk_device_type_info_t* type_info;
+	const scdk_kernels_t* kernels;
+	const scdk_key_row_kernels_t* key_row_kernels;
+	const scdk_extractors_t* extractors;
+	const scdk_encoder_t* encoder;
+	scdk_encoder_state_t encoder_state;
+
+	size_t key_image_src_buffer_length;
+	unsigned char* key_image_src_buffer;
+	size_t key_image_dst_buffer_length;
+	unsigned char* key_image_dst_buffer;
+	unsigned char* hid_out_feature_report_buffer;
+	size_t hid_out_report_buffer_length;
+	unsigned char* hid_out_report_buffer;
+	size_t hid_in_report_buffer_length;
+	unsigned char* hid_in_report_buffer;
+
+	XXH64_hash_t* key_image_hashes;
+	scdk_key_mask_t valid_key_hashes;
+	scdk_jpeg_cache_impl_t* jpeg_cache;
+
+	tjhandle jpeg_decompress_handle;
+	bool is_jpeg_validation_enabled;
+	bool is_planar_encoding_enabled;
+
+	scdk_pool_t* pool;
+	scdk_writer_t* writer;
+	scdk_async_t* async;
+	scdk_input_t* input;
+	scdk_input_config_t input_config;
+	scdk_rate_control_t* rate_control;
+	scdk_change_tolerance_t* change_tolerance;
+	scdk_scheduler_t* scheduler;
+
+	// Stage timings gathered under image_mutex, folded into stats under stats_mutex once each call completes
+	scdk_stats_t pending_stats;
+	scdk_stats_t stats;
+
+	// Set under stats_mutex once a transport call fails for good, which means the device has been unplugged
+	bool is_disconnected;
+
+	// image_mutex guards the image output path: its buffers, key hashes, encoder state and settings. key_mutex guards
+	// keys set through the scheduler, which don't wait for image_mutex; encoder, jpeg_cache and scheduler are only
+	// changed with both held, so either is enough to read them, and key_mutex is always taken after image_mutex.
+	// feature_mutex guards feature reports and read_mutex synchronous key reads. lifecycle_mutex guards creating and
+	// destroying async and input, and input_config, and is always taken after read_mutex when both are held.
+	scdk_mutex_t image_mutex;
+	scdk_mutex_t key_mutex;
+	scdk_mutex_t feature_mutex;
+	scdk_mutex_t read_mutex;
+	scdk_mutex_t lifecycle_mutex;
+	scdk_mutex_t stats_mutex;
+} scdk_device_impl_t;
+
+// Creates a device around an open transport, taking ownership of its context
+scdk_device_impl_t* scdk_device_create(const scdk_device_type_info_t* type_info, const scdk_transport_t* transport,
+                                       void* transport_context);
+
+int scdk_pixel_size(scdk_pixel_format_e pixel_format);
+
+static inline bool scdk_is_yuv_pixel_format(scdk_pixel_format_e pixel_format)
+{
+	return pixel_format == SCDK_PIXEL_FORMAT_I420 || pixel_format == SCDK_PIXEL_FORMAT_NV12
+		|| pixel_format == SCDK_PIXEL_FORMAT_TILE_YUV420;
+}
+
+// Returns the length in bytes of an image of the given size and pixel format
+size_t scdk_image_length(int width, int height, scdk_pixel_format_e pixel_format);
+
+// Keys whose stored hash is not valid, such as keys never sent or set directly with scdk_set_key_image or
+// scdk_set_key_jpeg, are always treated as changed
+static inline bool scdk_is_key_unchanged(scdk_key_mask_t valid_key_hashes, const XXH64_hash_t* key_image_hashes,
+                                         int key_index, XXH64_hash_t hash)
+{
+	return (valid_key_hashes & SCDK_KEY_MASK_BIT(key_index)) && key_image_hashes[key_index] == hash;
+}
+
+// Returns the extractors specialized for the key geometry of the device type, or generic extractors for other types
+const scdk_extractors_t* scdk_get_extractors(const scdk_device_type_info_t* type_info);
+
+// Hashes of key images passed to scdk_set_key_image are seeded with this and their pixel format
+#define SCDK_KEY_IMAGE_HASH_SEED ((XXH64_hash_t)1 << 32)
+
+// Hashes a key's pixels straight from the rows of the panel image, without extracting it. Unchanged keys are detected
+// by comparing these hashes, which also key the JPEG cache.
+XXH64_hash_t scdk_hash_key(const scdk_device_type_info_t* type_info, const scdk_image_view_t* image,
+                           scdk_pixel_format_e pixel_format, int key_x, int key_y);
+
+// Extracts a key from the panel image into the form it will be encoded from, returning the tile length in bytes
+size_t scdk_extract_key_tile(const scdk_device_impl_t* device_impl, const scdk_image_view_t* image,
+                             scdk_pixel_format_e pixel_format, int key_x, int key_y, unsigned char* dst,
+                             scdk_pixel_format_e* tile_pixel_format);
+
+// Converts a key image passed to scdk_set_key_image into the form it is encoded from, updating pixel_format. Images
+// that need rearranging are written to dst, which must hold a key tile.
+const unsigned char* scdk_prepare_key_image(const scdk_device_type_info_t* type_info, const unsigned char* image_buffer,
+                                            scdk_pixel_format_e* pixel_format, unsigned char* dst);
+
+// Sends the keys in key_mask from the device's panel within image, as scdk_set_image_region does
+bool scdk_set_image_view(scdk_device_impl_t* device_impl, const scdk_image_view_t* image,
+                         scdk_pixel_format_e pixel_format, int quality_percentage, scdk_key_mask_t key_mask);
+
+// Encodes with encoder, using the context in encoder_state or creating one for it
+bool scdk_encode_key(scdk_encoder_state_t* encoder_state, const scdk_encoder_t* encoder,
+                     const scdk_device_type_info_t* type_info, const unsigned char* image_buffer,
+                     scdk_pixel_format_e pixel_format, int quality_percentage,
+                     unsigned char* dst_buffer, unsigned long* dst_buffer_length);
+
+// Encodes with the device's encoder, through its JPEG cache when one is attached, keyed by the hash of the key being
+// encoded
+bool scdk_encode_key_cached(const scdk_device_impl_t* device_impl, scdk_encoder_state_t* encoder_state,
+                            const unsigned char* image_buffer, XXH64_hash_t hash,
+                            scdk_pixel_format_e pixel_format, int quality_percentage,
+                            unsigned char* dst_buffer, unsigned long* dst_buffer_length);
+
+static inline int scdk_key_report_count(unsigned long jpeg_length)
+{
+	return (int)((jpeg_length + (SD_OUT_REPORT_IMAGE_LENGTH - 1)) / SD_OUT_REPORT_IMAGE_LENGTH);
+}
+
+// Builds every report for a key image back to back in dst, which must hold scdk_key_report_count reports, returning
+// the number of reports built
+int scdk_packetize_key(int key_index, const unsigned char* jpeg_buffer, unsigned long jpeg_length,
+                       unsigned char* dst);
+
+// Marks the device as gone after a transport call fails, so a manager reopens it rather than keeping a dead handle
+void scdk_device_set_disconnected(scdk_device_impl_t* device_impl);
+
+bool scdk_device_is_disconnected(scdk_device_impl_t* device_impl);
+
+// Writes consecutive reports built by scdk_packetize_key, recording write timings and counters into stats
+bool scdk_write_reports(scdk_device_impl_t* device_impl, const unsigned char* reports, int report_count,
+                        scdk_stats_t* stats);
+
+bool scdk_write_key(scdk_device_impl_t* device_impl, int key_index, const unsigned char* jpeg_buffer,
+                    unsigned long jpeg_length);
+
+// Creates a thread that writes packetized keys in the order submitted, so a key's reports can be written while the
+// next key is encoded. Returns NULL if the thread can't be started.
+scdk_writer_t* scdk_writer_create(scdk_device_impl_t* device_impl);
+
+void scdk_writer_free(scdk_writer_t* writer);
+
+// Packetizes the key and queues it for writing, waiting for a free buffer if the writer is behind. Returns false
+// without queueing once an earlier write has failed. Must be called with image_mutex held.
+bool scdk_writer_submit(scdk_writer_t* writer, int key_index, const unsigned char* jpeg_buffer,
+                        unsigned long jpeg_length);
+
+// Waits for every queued key to be written and folds the writer's counters into pending_stats. Returns false if any
+// write failed since the last flush, setting failed_mask to the keys not written. Must be called with image_mutex
+// held.
+bool scdk_writer_flush(scdk_writer_t* writer, scdk_key_mask_t* failed_mask);
+
+scdk_jpeg_cache_impl_t* scdk_jpeg_cache_retain(scdk_jpeg_cache_impl_t* cache);
+
+bool scdk_jpeg_cache_lookup(scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key,
+                            unsigned char* dst_buffer, unsigned long* dst_buffer_length);
+
+void scdk_jpeg_cache_insert(scdk_jpeg_cache_impl_t* cache, const scdk_jpeg_cache_key_t* key,
+                            const unsigned char* jpeg_buffer, unsigned long jpeg_length);
+
+scdk_pool_t* scdk_pool_create(scdk_device_impl_t* device_impl, int thread_count);
+
+void scdk_pool_free(scdk_pool_t* pool);
+
+// Sends the keys in key_mask that changed or are due for refinement, setting sent_mask to the keys written
+bool scdk_pool_set_image(scdk_pool_t* pool, const scdk_image_view_t* image, scdk_pixel_format_e pixel_format,
+                         const scdk_frame_quality_t* frame_quality, scdk_key_mask_t key_mask,
+                         scdk_key_mask_t* sent_mask);
+
+static inline int scdk_stats_histogram_bucket(uint64_t duration_ns)
+{
+	if (duration_ns == 0)
+		return 0;
+
+#if defined(__GNUC__) || defined(__clang__)
+	const int bucket = 63 - __builtin_clzll(duration_ns);
+#else
+	int bucket = 0;
+	while (duration_ns >>= 1)
+		++bucket;
+#endif
+
+	return SCDK_MIN(bucket, SCDK_STATS_HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+static inline void scdk_stats_record_stage(scdk_stats_t* stats, scdk_stage_e stage, uint64_t duration_ns)
+{
+	scdk_stage_stats_t* stage_stats = stats->stages + stage;
+
+	++stage_stats->count;
+	stage_stats->total_ns += duration_ns;
+	stage_stats->max_ns = SCDK_MAX(stage_stats->max_ns, duration_ns);
+	++stage_stats->histogram[scdk_stats_histogram_bucket(duration_ns)];
+}
+
+// Adds the counters and stage timings of src_stats to stats
+void scdk_stats_merge(scdk_stats_t* stats, const scdk_stats_t* src_stats);
+
+// Must be called with image_mutex held
+void scdk_stats_flush(scdk_device_impl_t* device_impl);
+
+scdk_rate_control_t* scdk_rate_control_create(const scdk_device_type_info_t* type_info,
+                                              const scdk_rate_control_config_t* config);
+
+void scdk_rate_control_free(scdk_rate_control_t* rate_control);
+
+void scdk_rate_control_begin_frame(scdk_rate_control_t* rate_control, int quality_percentage,
+                                   scdk_key_mask_t key_mask, scdk_key_mask_t valid_key_hashes,
+                                   scdk_frame_quality_t* frame_quality);
+
+void scdk_rate_control_end_frame(scdk_rate_control_t* rate_control, const scdk_frame_quality_t* frame_quality,
+                                 scdk_key_mask_t key_mask, scdk_key_mask_t sent_mask, uint64_t frame_start_us,
+                                 uint64_t frame_end_us, uint64_t frame_bytes);
+
+// Returns NULL if the device's keys are too wide to compare
+scdk_change_tolerance_t* scdk_change_tolerance_create(const scdk_device_impl_t* device_impl,
+                                                      const scdk_change_tolerance_config_t* config);
+
+void scdk_change_tolerance_free(scdk_change_tolerance_t* change_tolerance);
+
+// Returns true if the tile is within tolerance of the tile the key was last sent from and the key isn't due a refresh,
+// counting the frame towards the refresh. May be called for different keys from several threads at once.
+bool scdk_change_tolerance_is_within(scdk_change_tolerance_t* change_tolerance, int key_index,
+                                     const unsigned char* tile, scdk_pixel_format_e tile_pixel_format);
+
+// Records the tile the key is being sent from, to compare later frames against
+void scdk_change_tolerance_set_sent(scdk_change_tolerance_t* change_tolerance, int key_index,
+                                    const unsigned char* tile, size_t tile_length,
+                                    scdk_pixel_format_e tile_pixel_format);
+
+// Forgets the tiles of keys that were not sent or were set some other way, so they are next compared as changed.
+// Accepts a NULL change_tolerance.
+void scdk_change_tolerance_invalidate(scdk_change_tolerance_t* change_tolerance, scdk_key_mask_t key_mask);
+
+// Creates a thread that writes every key upload a report at a time, most urgent first. Returns NULL if the thread can't
+// be started.
+scdk_scheduler_t* scdk_scheduler_create(scdk_device_impl_t* device_impl, const scdk_update_scheduler_config_t* config);
+
+// Waits for queued uploads to be written before stopping the thread
+void scdk_scheduler_free(scdk_scheduler_t* scheduler);
+
+// Queues the key for writing in the class configured for image calls and waits until it has been written or replaced
+// by a newer upload, recording packetization into stats. Returns false if the write failed.
+bool scdk_scheduler_write_key(scdk_scheduler_t* scheduler, int key_index, const unsigned char* jpeg_buffer,
+                              unsigned long jpeg_length, scdk_stats_t* stats);
+
+// Encodes and sends a key image passed to scdk_set_key_image_priority through the scheduler, without taking
+// image_mutex. Sets is_scheduled to false, and sends nothing, if the scheduler isn't enabled.
+bool scdk_scheduler_set_key_image(scdk_device_impl_t* device_impl, int key_index, const unsigned char* image_buffer,
+                                  scdk_pixel_format_e pixel_format, int quality_percentage,
+                                  scdk_update_priority_e priority, bool* is_scheduled);
+
+// Returns the keys set through the scheduler since the last call, whose stored hashes no longer match what the device
+// shows. Must be called with image_mutex held.
+scdk_key_mask_t scdk_scheduler_take_replaced_keys(scdk_device_impl_t* device_impl);
+
+void scdk_async_free(scdk_async_t* async);
+
+void scdk_input_free(scdk_input_t* input);
+
+// False once the input thread has stopped after failing to read from the device
+bool scdk_input_is_running(scdk_input_t* input);
+
+#endif // SCDK_INTERNAL_H
@@ -0,0 +1,611 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Baseline JPEG encoder specialized for key tiles: always 4:2:0 with the standard Huffman tables, so the headers,
+// quantization divisors and Huffman codes only depend on the tile size and quality and are prepared once
+
+// Worst case bytes for one block: an 11 bit DC difference and 63 10 bit AC coefficients with 16 bit codes, with every
+// byte stuffed
+#define SCDK_JPEG_BLOCK_MAX_LENGTH (2 * ((16 + 11 + (63 * (16 + 10)) + 7) / 8))
+
+// SOI, JFIF APP0, DQT with both tables, SOF0, DHT with all four tables and SOS
+#define SCDK_JPEG_HEADER_MAX_LENGTH 640
+
+#define SCDK_JPEG_QUALITY_COUNT 100
+
+// Bytes of padding either side of the scratch rows converted by the SIMD kernels
+#define SCDK_JPEG_ROW_PADDING 16
+
+static const unsigned char scdk_jpeg_natural_order[64] =
+{
+	0, 1, 8, 16, 9, 2, 3, 10,
+	17, 24, 32, 25, 18, 11, 4, 5,
+	12, 19, 26, 33, 40, 48, 41, 34,
+	27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36,
+	29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46,
+	53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// Quantization tables from Annex K of the JPEG standard, in natural order, scaled by quality as libjpeg does
+static const unsigned char scdk_jpeg_luma_quant[64] =
+{
+	16, 11, 10, 16, 24, 40, 51, 61,
+	12, 12, 14, 19, 26, 58, 60, 55,
+	14, 13, 16, 24, 40, 57, 69, 56,
+	14, 17, 22, 29, 51, 87, 80, 62,
+	18, 22, 37, 56, 68, 109, 103, 77,
+	24, 35, 55, 64, 81, 104, 113, 92,
+	49, 64, 78, 87, 103, 121, 120, 101,
+	72, 92, 95, 98, 112, 100, 103, 99
+};
+
+static const unsigned char scdk_jpeg_chroma_quant[64] =
+{
+	17, 18, 24, 47, 99, 99, 99, 99,
+	18, 21, 26, 66, 99, 99, 99, 99,
+	24, 26, 56, 99, 99, 99, 99, 99,
+	47, 66, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99
+};
+
+// Scale factors of the AAN DCT outputs for each frequency
+static const double scdk_jpeg_aan_scales[8] =
+{
+	1.0, 1.387039845, 1.306562965, 1.175875602, 1.0, 0.785694958, 0.541196100, 0.275899379
+};
+
+// Huffman tables from Annex K of the JPEG standard, as code counts for each length from 1 to 16 and symbol values
+typedef struct scdk_jpeg_huffman_spec_t
+{
+	unsigned char table_class_id;
+	unsigned char counts[16];
+	int value_count;
+	const unsigned char* values;
+
+} scdk_jpeg_huffman_spec_t;
+
+static const unsigned char scdk_jpeg_dc_values[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const unsigned char scdk_jpeg_luma_ac_values[162] =
+{
+	0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+	0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+	0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+	0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+	0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+	0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+	0xf9, 0xfa
+};
+
+static const unsigned char scdk_jpeg_chroma_ac_values[162] =
+{
+	0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+	0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+	0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+	0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+	0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+	0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+	0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+	0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+	0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+	0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+	0xf9, 0xfa
+};
+
+// Luma DC, luma AC, chroma DC and chroma AC, in the order their codes are kept
+static const scdk_jpeg_huffman_spec_t scdk_jpeg_huffman_specs[4] =
+{
+	{ 0x00, { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 }, 12, scdk_jpeg_dc_values },
+	{ 0x10, { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d }, 162, scdk_jpeg_luma_ac_values },
+	{ 0x01, { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 }, 12, scdk_jpeg_dc_values },
+	{ 0x11, { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 }, 162, scdk_jpeg_chroma_ac_values }
+};
+
+typedef struct scdk_jpeg_huffman_t
+{
+	uint16_t codes[256];
+	unsigned char lengths[256];
+
+} scdk_jpeg_huffman_t;
+
+// Everything that depends on quality: the complete header up to the entropy coded data, and the luma and chroma
+// divisors passed to the DCT kernel
+typedef struct scdk_jpeg_quality_tables_t
+{
+	size_t header_length;
+	unsigned char header[SCDK_JPEG_HEADER_MAX_LENGTH];
+	float divisors[2][64];
+
+} scdk_jpeg_quality_tables_t;
+
+typedef struct scdk_jpeg_encoder_t
+{
+	const scdk_kernels_t* kernels;
+	int width;
+	int height;
+
+	// Luma DC, luma AC, chroma DC and chroma AC codes
+	scdk_jpeg_huffman_t huffman[4];
+
+	// Maps each row's byte of the natural order non-zero mask returned by the DCT kernel to the zigzag order bits of the
+	// same coefficients, so the mask is reordered with eight lookups rather than the coefficients one at a time
+	uint64_t zigzag_masks[8][256];
+
+	// Built the first time each quality is used
+	scdk_jpeg_quality_tables_t* quality_tables[SCDK_JPEG_QUALITY_COUNT];
+
+	// Scratch reused by every call: YCbCr planes converted from packed RGB tiles, the two rows being converted, and an
+	// edge block padded by replicating its last column and row
+	unsigned char* planes;
+	unsigned char* rows;
+	unsigned char edge_block[64];
+
+} scdk_jpeg_encoder_t;
+
+typedef struct scdk_jpeg_bit_writer_t
+{
+	uint64_t bits;
+	int bit_count;
+	unsigned char* p;
+
+} scdk_jpeg_bit_writer_t;
+
+static void scdk_jpeg_build_huffman(const scdk_jpeg_huffman_spec_t* spec, scdk_jpeg_huffman_t* huffman)
+{
+	memset(huffman, 0, sizeof(scdk_jpeg_huffman_t));
+
+	// Canonical codes, assigned in order of length as in Annex C of the JPEG standard
+	int value_index = 0;
+	uint16_t code = 0;
+
+	for (int length = 1; length <= 16; ++length)
+	{
+		for (int i = 0; i < spec->counts[length - 1]; ++i)
+		{
+			const unsigned char value = spec->values[value_index++];
+			huffman->codes[value] = code++;
+			huffman->lengths[value] = (unsigned char)length;
+		}
+
+		code <<= 1;
+	}
+}
+
+static unsigned char* scdk_jpeg_write_marker(unsigned char* p, unsigned char marker, int length)
+{
+	*p++ = 0xFF;
+	*p++ = marker;
+	*p++ = (unsigned char)(length >> 8);
+	*p++ = (unsigned char)(length & 0xFF);
+	return p;
+}
+
+static scdk_jpeg_quality_tables_t* scdk_jpeg_build_quality_tables(const scdk_jpeg_encoder_t* encoder,
+                                                                  int quality_percentage)
+{
+	scdk_jpeg_quality_tables_t* tables = malloc(sizeof(scdk_jpeg_quality_tables_t));
+	if (tables == NULL)
+		abort();
+
+	const int scale = quality_percentage < 50 ? 5000 / quality_percentage : 200 - (quality_percentage * 2);
+	const unsigned char* base_tables[2] = { scdk_jpeg_luma_quant, scdk_jpeg_chroma_quant };
+	unsigned char quant[2][64];
+
+	for (int t = 0; t < 2; ++t)
+	{
+		for (int i = 0; i < 64; ++i)
+		{
+			quant[t][i] = (unsigned char)SCDK_CLAMP(((base_tables[t][i] * scale) + 50) / 100, 1, 255);
+
+			const int v = i / 8;
+			const int u = i % 8;
+			tables->divisors[t][i] = (float)(1.0 / (quant[t][i] * scdk_jpeg_aan_scales[v] * scdk_jpeg_aan_scales[u]
+			                                        * 8.0));
+		}
+	}
+
+	unsigned char* p = tables->header;
+
+	*p++ = 0xFF;
+	*p++ = 0xD8;
+
+	static const unsigned char jfif[14] = { 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+	p = scdk_jpeg_write_marker(p, 0xE0, 2 + (int)sizeof(jfif));
+	memcpy(p, jfif, sizeof(jfif));
+	p += sizeof(jfif);
+
+	p = scdk_jpeg_write_marker(p, 0xDB, 2 + (2 * 65));
+	for (int t = 0; t < 2; ++t)
+	{
+		*p++ = (unsigned char)t;
+		for (int k = 0; k < 64; ++k)
+			*p++ = quant[t][scdk_jpeg_natural_order[k]];
+	}
+
+	p = scdk_jpeg_write_marker(p, 0xC0, 17);
+	*p++ = 8;
+	*p++ = (unsigned char)(encoder->height >> 8);
+	*p++ = (unsigned char)(encoder->height & 0xFF);
+	*p++ = (unsigned char)(encoder->width >> 8);
+	*p++ = (unsigned char)(encoder->width & 0xFF);
+	*p++ = 3;
+	*p++ = 1; *p++ = 0x22; *p++ = 0;
+	*p++ = 2; *p++ = 0x11; *p++ = 1;
+	*p++ = 3; *p++ = 0x11; *p++ = 1;
+
+	int dht_length = 2;
+	for (int i = 0; i < 4; ++i)
+		dht_length += 17 + scdk_jpeg_huffman_specs[i].value_count;
+
+	p = scdk_jpeg_write_marker(p, 0xC4, dht_length);
+	for (int i = 0; i < 4; ++i)
+	{
+		const scdk_jpeg_huffman_spec_t* spec = scdk_jpeg_huffman_specs + i;
+
+		*p++ = spec->table_class_id;
+		memcpy(p, spec->counts, 16);
+		p += 16;
+		memcpy(p, spec->values, spec->value_count);
+		p += spec->value_count;
+	}
+
+	p = scdk_jpeg_write_marker(p, 0xDA, 12);
+	*p++ = 3;
+	*p++ = 1; *p++ = 0x00;
+	*p++ = 2; *p++ = 0x11;
+	*p++ = 3; *p++ = 0x11;
+	*p++ = 0;
+	*p++ = 63;
+	*p++ = 0;
+
+	tables->header_length = p - tables->header;
+
+	return tables;
+}
+
+static void* scdk_jpeg_encoder_create(const scdk_device_type_info_t* type_info)
+{
+	// Tiles are converted to 4:2:0 two rows at a time
+	if (type_info->key_image_width % 2 != 0 || type_info->key_image_height % 2 != 0)
+		return NULL;
+
+	scdk_jpeg_encoder_t* encoder = calloc(1, sizeof(scdk_jpeg_encoder_t));
+	if (encoder == NULL)
+		abort();
+
+	encoder->kernels = scdk_get_kernels();
+	encoder->width = type_info->key_image_width;
+	encoder->height = type_info->key_image_height;
+
+	for (int i = 0; i < 4; ++i)
+		scdk_jpeg_build_huffman(scdk_jpeg_huffman_specs + i, encoder->huffman + i);
+
+	for (int k = 0; k < 64; ++k)
+	{
+		const int row = scdk_jpeg_natural_order[k] / 8;
+		const int column_bit = 1 << (scdk_jpeg_natural_order[k] % 8);
+
+		for (int byte = 0; byte < 256; ++byte)
+		{
+			if (byte & column_bit)
+				encoder->zigzag_masks[row][byte] |= (uint64_t)1 << k;
+		}
+	}
+
+	// SIMD kernels may load a little either side of the rows they are given, so the scratch rows are padded
+	encoder->planes = malloc(((size_t)encoder->width * encoder->height * 3) / 2);
+	encoder->rows = malloc(((size_t)encoder->width * 4 * 2) + (SCDK_JPEG_ROW_PADDING * 2));
+	if (encoder->planes == NULL || encoder->rows == NULL)
+		abort();
+
+	return encoder;
+}
+
+static void scdk_jpeg_encoder_free(void* context)
+{
+	scdk_jpeg_encoder_t* encoder = context;
+
+	for (int i = 0; i < SCDK_JPEG_QUALITY_COUNT; ++i)
+		free(encoder->quality_tables[i]);
+
+	free(encoder->planes);
+	free(encoder->rows);
+	free(encoder);
+}
+
+static inline int scdk_jpeg_bit_length(unsigned int value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return value ? 32 - __builtin_clz(value) : 0;
+#else
+	int length = 0;
+	while (value)
+	{
+		value >>= 1;
+		++length;
+	}
+
+	return length;
+#endif
+}
+
+// Returns the index of the lowest set bit, which must exist
+static inline int scdk_jpeg_lowest_bit(uint64_t bits)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(bits);
+#else
+	int index = 0;
+	while (!(bits & 1))
+	{
+		bits >>= 1;
+		++index;
+	}
+
+	return index;
+#endif
+}
+
+static inline void scdk_jpeg_write_byte(scdk_jpeg_bit_writer_t* writer, unsigned char byte)
+{
+	*writer->p++ = byte;
+	if (byte == 0xFF)
+		*writer->p++ = 0;
+}
+
+// Puts at most 27 bits. Bits are written out 32 at a time, taking the fast path when none of the 4 bytes is 0xFF and
+// needs a stuffed 0 after it.
+static inline void scdk_jpeg_put_bits(scdk_jpeg_bit_writer_t* writer, uint32_t bits, int length)
+{
+	writer->bits = (writer->bits << length) | bits;
+	writer->bit_count += length;
+
+	if (writer->bit_count < 32)
+		return;
+
+	writer->bit_count -= 32;
+	const uint32_t word = (uint32_t)(writer->bits >> writer->bit_count);
+
+	if ((((~word) - 0x01010101u) & word & 0x80808080u) == 0)
+	{
+		writer->p[0] = (unsigned char)(word >> 24);
+		writer->p[1] = (unsigned char)(word >> 16);
+		writer->p[2] = (unsigned char)(word >> 8);
+		writer->p[3] = (unsigned char)word;
+		writer->p += 4;
+	}
+	else
+	{
+		for (int shift = 24; shift >= 0; shift -= 8)
+			scdk_jpeg_write_byte(writer, (unsigned char)(word >> shift));
+	}
+}
+
+// Writes out whole bytes still held, then pads the last partial byte with 1 bits
+static void scdk_jpeg_flush_bits(scdk_jpeg_bit_writer_t* writer)
+{
+	for (; writer->bit_count >= 8; writer->bit_count -= 8)
+		scdk_jpeg_write_byte(writer, (unsigned char)(writer->bits >> (writer->bit_count - 8)));
+
+	if (writer->bit_count > 0)
+	{
+		const int padding = 8 - writer->bit_count;
+		scdk_jpeg_write_byte(writer, (unsigned char)((writer->bits << padding) | ((1u << padding) - 1)));
+		writer->bit_count = 0;
+	}
+}
+
+// Writes a Huffman code followed by the bits of value, as one put of at most 16 + 11 bits
+static inline void scdk_jpeg_put_symbol(scdk_jpeg_bit_writer_t* writer, const scdk_jpeg_huffman_t* huffman,
+                                        int symbol, int value, int value_length)
+{
+	const uint32_t value_bits = (uint32_t)(value < 0 ? value - 1 : value) & ((1u << value_length) - 1);
+	scdk_jpeg_put_bits(writer, ((uint32_t)huffman->codes[symbol] << value_length) | value_bits,
+	                   huffman->lengths[symbol] + value_length);
+}
+
+static inline void scdk_jpeg_encode_block(const scdk_jpeg_encoder_t* encoder, scdk_jpeg_bit_writer_t* writer,
+                                          const int16_t* coefficients, uint64_t natural_mask, int* last_dc,
+                                          const scdk_jpeg_huffman_t* dc_huffman,
+                                          const scdk_jpeg_huffman_t* ac_huffman)
+{
+	const int dc_difference = coefficients[0] - *last_dc;
+	*last_dc = coefficients[0];
+
+	const int dc_length = scdk_jpeg_bit_length(abs(dc_difference));
+	scdk_jpeg_put_symbol(writer, dc_huffman, dc_length, dc_difference, dc_length);
+
+	// Non-zero AC coefficients in zigzag order, so runs of zeros are skipped whole
+	uint64_t nonzero_mask = 0;
+	for (int row = 0; row < 8; ++row)
+		nonzero_mask |= encoder->zigzag_masks[row][(natural_mask >> (row * 8)) & 0xFF];
+	nonzero_mask &= ~(uint64_t)1;
+
+	int last_k = 0;
+
+	while (nonzero_mask)
+	{
+		const int k = scdk_jpeg_lowest_bit(nonzero_mask);
+		nonzero_mask &= nonzero_mask - 1;
+
+		int run = k - last_k - 1;
+		for (; run > 15; run -= 16)
+			scdk_jpeg_put_symbol(writer, ac_huffman, 0xF0, 0, 0);
+
+		int value = coefficients[scdk_jpeg_natural_order[k]];
+		int value_length = scdk_jpeg_bit_length(abs(value));
+
+		// Baseline AC coefficients are limited to 10 bits
+		if (value_length > 10)
+		{
+			value = value < 0 ? -1023 : 1023;
+			value_length = 10;
+		}
+
+		scdk_jpeg_put_symbol(writer, ac_huffman, (run << 4) | value_length, value, value_length);
+		last_k = k;
+	}
+
+	if (last_k != 63)
+		scdk_jpeg_put_symbol(writer, ac_huffman, 0x00, 0, 0);
+}
+
+// Transforms and encodes the block at block_x, block_y of a plane. Blocks entirely in the padding beyond the plane are
+// encoded as a repeat of the previous block's DC with no AC, and blocks straddling its edge are padded by replication.
+static void scdk_jpeg_encode_plane_block(scdk_jpeg_encoder_t* encoder, scdk_jpeg_bit_writer_t* writer,
+                                         const unsigned char* plane, int plane_width, int plane_height,
+                                         int block_x, int block_y, const float* divisors, int* last_dc,
+                                         const scdk_jpeg_huffman_t* dc_huffman, const scdk_jpeg_huffman_t* ac_huffman)
+{
+	const int x = block_x * 8;
+	const int y = block_y * 8;
+
+	if (x >= plane_width || y >= plane_height)
+	{
+		scdk_jpeg_put_symbol(writer, dc_huffman, 0, 0, 0);
+		scdk_jpeg_put_symbol(writer, ac_huffman, 0x00, 0, 0);
+		return;
+	}
+
+	const unsigned char* src = plane + ((size_t)y * plane_width) + x;
+	int stride = plane_width;
+
+	if (x + 8 > plane_width || y + 8 > plane_height)
+	{
+		for (int row = 0; row < 8; ++row)
+		{
+			const unsigned char* src_row = plane + ((size_t)SCDK_MIN(y + row, plane_height - 1) * plane_width);
+			for (int column = 0; column < 8; ++column)
+				encoder->edge_block[(row * 8) + column] = src_row[SCDK_MIN(x + column, plane_width - 1)];
+		}
+
+		src = encoder->edge_block;
+		stride = 8;
+	}
+
+	int16_t coefficients[64];
+	const uint64_t natural_mask = encoder->kernels->fdct_8x8(src, stride, divisors, coefficients);
+
+	scdk_jpeg_encode_block(encoder, writer, coefficients, natural_mask, last_dc, dc_huffman, ac_huffman);
+}
+
+static bool scdk_jpeg_encoder_encode(void* context, const unsigned char* image_buffer,
+                                     scdk_pixel_format_e pixel_format, int quality_percentage,
+                                     unsigned char* dst_buffer, unsigned long* dst_buffer_length)
+{
+	scdk_jpeg_encoder_t* encoder = context;
+	const int width = encoder->width;
+	const int height = encoder->height;
+	const int chroma_width = width / 2;
+	const int chroma_height = height / 2;
+
+	const unsigned char* y_plane = image_buffer;
+
+	if (pixel_format >= 0 && pixel_format < SCDK_KERNELS_RGB_FORMAT_COUNT)
+	{
+		// The colour conversion kernels also reverse pixel order, so each row is reversed into scratch first
+		const int pixel_size = scdk_pixel_size(pixel_format);
+		const size_t line_length = (size_t)width * pixel_size;
+		const scdk_reverse_row_func_t reverse_row = pixel_size == 3 ? encoder->kernels->reverse_row_24
+		                                                            : encoder->kernels->reverse_row_32;
+		const scdk_reverse_rows_yuv420_func_t reverse_rows = encoder->kernels->reverse_rows_yuv420[pixel_format];
+
+		unsigned char* row0 = encoder->rows + SCDK_JPEG_ROW_PADDING;
+		unsigned char* row1 = row0 + line_length;
+		unsigned char* cb_plane = encoder->planes + ((size_t)width * height);
+		unsigned char* cr_plane = cb_plane + ((size_t)chroma_width * chroma_height);
+
+		for (int y = 0; y < height; y += 2)
+		{
+			reverse_row(image_buffer + (y * line_length), row0, width);
+			reverse_row(image_buffer + ((y + 1) * line_length), row1, width);
+
+			reverse_rows(row0, row1, encoder->planes + ((size_t)y * width), encoder->planes + ((size_t)(y + 1) * width),
+			             cb_plane + ((size_t)(y / 2) * chroma_width), cr_plane + ((size_t)(y / 2) * chroma_width),
+			             width);
+		}
+
+		y_plane = encoder->planes;
+	}
+	else if (pixel_format != SCDK_PIXEL_FORMAT_TILE_YUV420)
+	{
+		return false;
+	}
+
+	const unsigned char* cb_plane = y_plane + ((size_t)width * height);
+	const unsigned char* cr_plane = cb_plane + ((size_t)chroma_width * chroma_height);
+
+	quality_percentage = SCDK_CLAMP(quality_percentage, 1, SCDK_JPEG_QUALITY_COUNT);
+
+	scdk_jpeg_quality_tables_t* tables = encoder->quality_tables[quality_percentage - 1];
+	if (tables == NULL)
+	{
+		tables = scdk_jpeg_build_quality_tables(encoder, quality_percentage);
+		encoder->quality_tables[quality_percentage - 1] = tables;
+	}
+
+	const unsigned long capacity = *dst_buffer_length;
+	if (capacity < tables->header_length + 2)
+		return false;
+
+	memcpy(dst_buffer, tables->header, tables->header_length);
+
+	scdk_jpeg_bit_writer_t writer = { 0, 0, dst_buffer + tables->header_length };
+	unsigned char* const dst_end = dst_buffer + capacity;
+
+	const scdk_jpeg_huffman_t* huffman = encoder->huffman;
+	int last_dc[3] = { 0, 0, 0 };
+
+	const int mcu_columns = (width + 15) / 16;
+	const int mcu_rows = (height + 15) / 16;
+
+	for (int mcu_y = 0; mcu_y < mcu_rows; ++mcu_y)
+	{
+		for (int mcu_x = 0; mcu_x < mcu_columns; ++mcu_x)
+		{
+			// Leaves room for the bits still held by the writer and EOI after the last MCU
+			if (dst_end - writer.p < (6 * SCDK_JPEG_BLOCK_MAX_LENGTH) + 10)
+				return false;
+
+			for (int i = 0; i < 4; ++i)
+			{
+				scdk_jpeg_encode_plane_block(encoder, &writer, y_plane, width, height, (mcu_x * 2) + (i % 2),
+				                             (mcu_y * 2) + (i / 2), tables->divisors[0], last_dc + 0,
+				                             huffman + 0, huffman + 1);
+			}
+
+			scdk_jpeg_encode_plane_block(encoder, &writer, cb_plane, chroma_width, chroma_height, mcu_x, mcu_y,
+			                             tables->divisors[1], last_dc + 1, huffman + 2, huffman + 3);
+			scdk_jpeg_encode_plane_block(encoder, &writer, cr_plane, chroma_width, chroma_height, mcu_x, mcu_y,
+			                             tables->divisors[1], last_dc + 2, huffman + 2, huffman + 3);
+		}
+	}
+
+	scdk_jpeg_flush_bits(&writer);
+
+	*writer.p++ = 0xFF;
+	*writer.p++ = 0xD9;
+
+	*dst_buffer_length = (unsigned long)(writer.p - dst_buffer);
+	return true;
+}
+
+const scdk_encoder_t scdk_encoder_builtin =
+{
+	"builtin",
+	SCDK_JPEG_ENCODER_BUILTIN,
+	scdk_jpeg_encoder_create,
+	scdk_jpeg_encoder_encode,
+	scdk_jpeg_encoder_free
+};
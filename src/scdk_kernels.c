@@ -0,0 +1,981 @@
+#include "scdk_kernels.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCDK_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define SCDK_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(SCDK_KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SCDK_TARGET(x) __attribute__((target(x)))
+#else
+#define SCDK_TARGET(x)
+#endif
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_24_scalar(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	src += (pixel_count - 1) * 3;
+
+	for (int i = 0; i < pixel_count; ++i)
+	{
+		*dst++ = src[0];
+		*dst++ = src[1];
+		*dst++ = src[2];
+		src -= 3;
+	}
+}
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_32_scalar(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	src += (pixel_count - 1) * 4;
+
+	for (int i = 0; i < pixel_count; ++i)
+	{
+		uint32_t pixel;
+		memcpy(&pixel, src, 4);
+		memcpy(dst, &pixel, 4);
+		dst += 4;
+		src -= 4;
+	}
+}
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_8_scalar(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	src += pixel_count - 1;
+
+	for (int i = 0; i < pixel_count; ++i)
+		*dst++ = *src--;
+}
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_uv_scalar(const unsigned char* src, unsigned char* dst_u,
+                                                          unsigned char* dst_v, int pixel_count)
+{
+	src += (pixel_count - 1) * 2;
+
+	for (int i = 0; i < pixel_count; ++i)
+	{
+		*dst_u++ = src[0];
+		*dst_v++ = src[1];
+		src -= 2;
+	}
+}
+
+// JFIF full range BT.601 conversion with 16 fractional bits, matching libjpeg's jccolor.c. Chroma is computed from the
+// sum of each 2x2 block, which is equivalent to converting each pixel and averaging.
+#define SCDK_FIX(x) ((int)((x) * 65536.0 + 0.5))
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_rows_yuv420_scalar(const unsigned char* src0, const unsigned char* src1,
+                                                   unsigned char* y0, unsigned char* y1,
+                                                   unsigned char* cb, unsigned char* cr, int pixel_count,
+                                                   const int pixel_size, const int r, const int g, const int b)
+{
+	const unsigned char* p0 = src0 + (pixel_count - 1) * pixel_size;
+	const unsigned char* p1 = src1 + (pixel_count - 1) * pixel_size;
+
+	for (int x = 0; x < pixel_count; x += 2)
+	{
+		const int r00 = p0[r], g00 = p0[g], b00 = p0[b];
+		const int r01 = p0[r - pixel_size], g01 = p0[g - pixel_size], b01 = p0[b - pixel_size];
+		const int r10 = p1[r], g10 = p1[g], b10 = p1[b];
+		const int r11 = p1[r - pixel_size], g11 = p1[g - pixel_size], b11 = p1[b - pixel_size];
+
+		*y0++ = (unsigned char)((SCDK_FIX(0.29900) * r00 + SCDK_FIX(0.58700) * g00 + SCDK_FIX(0.11400) * b00 + 32768) >> 16);
+		*y0++ = (unsigned char)((SCDK_FIX(0.29900) * r01 + SCDK_FIX(0.58700) * g01 + SCDK_FIX(0.11400) * b01 + 32768) >> 16);
+		*y1++ = (unsigned char)((SCDK_FIX(0.29900) * r10 + SCDK_FIX(0.58700) * g10 + SCDK_FIX(0.11400) * b10 + 32768) >> 16);
+		*y1++ = (unsigned char)((SCDK_FIX(0.29900) * r11 + SCDK_FIX(0.58700) * g11 + SCDK_FIX(0.11400) * b11 + 32768) >> 16);
+
+		const int rs = r00 + r01 + r10 + r11;
+		const int gs = g00 + g01 + g10 + g11;
+		const int bs = b00 + b01 + b10 + b11;
+
+		*cb++ = (unsigned char)((-SCDK_FIX(0.16874) * rs - SCDK_FIX(0.33126) * gs + SCDK_FIX(0.50000) * bs
+			+ (128 << 18) + (1 << 17)) >> 18);
+		*cr++ = (unsigned char)((SCDK_FIX(0.50000) * rs - SCDK_FIX(0.41869) * gs - SCDK_FIX(0.08131) * bs
+			+ (128 << 18) + (1 << 17)) >> 18);
+
+		p0 -= pixel_size * 2;
+		p1 -= pixel_size * 2;
+	}
+}
+
+#define SCDK_REVERSE_ROWS_YUV420(name, pixel_size, r, g, b)                                                          \
+static SCDK_ALWAYS_INLINE void scdk_reverse_rows_yuv420_##name(const unsigned char* src0, const unsigned char* src1,  \
+                                                               unsigned char* y0, unsigned char* y1,                  \
+                                                               unsigned char* cb, unsigned char* cr, int pixel_count) \
+{                                                                                                                     \
+	scdk_reverse_rows_yuv420_scalar(src0, src1, y0, y1, cb, cr, pixel_count, pixel_size, r, g, b);                   \
+}
+
+SCDK_REVERSE_ROWS_YUV420(rgb, 3, 0, 1, 2)
+SCDK_REVERSE_ROWS_YUV420(bgr, 3, 2, 1, 0)
+SCDK_REVERSE_ROWS_YUV420(rgbx, 4, 0, 1, 2)
+SCDK_REVERSE_ROWS_YUV420(bgrx, 4, 2, 1, 0)
+SCDK_REVERSE_ROWS_YUV420(xbgr, 4, 3, 2, 1)
+SCDK_REVERSE_ROWS_YUV420(xrgb, 4, 1, 2, 3)
+
+static const scdk_reverse_rows_yuv420_func_t scdk_reverse_rows_yuv420_scalar_table[SCDK_KERNELS_RGB_FORMAT_COUNT] =
+{
+	scdk_reverse_rows_yuv420_rgb,
+	scdk_reverse_rows_yuv420_bgr,
+	scdk_reverse_rows_yuv420_rgbx,
+	scdk_reverse_rows_yuv420_bgrx,
+	scdk_reverse_rows_yuv420_xbgr,
+	scdk_reverse_rows_yuv420_xrgb,
+	scdk_reverse_rows_yuv420_rgbx,
+	scdk_reverse_rows_yuv420_bgrx,
+	scdk_reverse_rows_yuv420_xbgr,
+	scdk_reverse_rows_yuv420_xrgb
+};
+
+// Instantiate row kernels for a constant pixel count, named with the count as a suffix. target is the SCDK_TARGET of
+// the kernel, which its instance needs to inline it.
+#define SCDK_REVERSE_ROW_AT(target, func, count)                                                                     \
+target                                                                                                                \
+static void func##_##count(const unsigned char* src, unsigned char* dst, int pixel_count)                            \
+{                                                                                                                     \
+	(void)pixel_count;                                                                                                \
+	func(src, dst, count);                                                                                            \
+}
+
+#define SCDK_REVERSE_ROW_UV_AT(target, func, count)                                                                  \
+target                                                                                                                \
+static void func##_##count(const unsigned char* src, unsigned char* dst_u, unsigned char* dst_v, int pixel_count)    \
+{                                                                                                                     \
+	(void)pixel_count;                                                                                                \
+	func(src, dst_u, dst_v, count);                                                                                   \
+}
+
+#define SCDK_REVERSE_ROWS_YUV420_FORMAT_AT(target, func, count)                                                      \
+target                                                                                                                \
+static void func##_##count(const unsigned char* src0, const unsigned char* src1,                                      \
+                           unsigned char* y0, unsigned char* y1,                                                     \
+                           unsigned char* cb, unsigned char* cr, int pixel_count)                                    \
+{                                                                                                                     \
+	(void)pixel_count;                                                                                                \
+	func(src0, src1, y0, y1, cb, cr, count);                                                                          \
+}
+
+// Instantiates the yuv420 kernels of every format named with prefix, and their table prefix##_table_##count
+#define SCDK_REVERSE_ROWS_YUV420_AT(target, prefix, count)                                                           \
+SCDK_REVERSE_ROWS_YUV420_FORMAT_AT(target, prefix##_rgb, count)                                                      \
+SCDK_REVERSE_ROWS_YUV420_FORMAT_AT(target, prefix##_bgr, count)                                                      \
+SCDK_REVERSE_ROWS_YUV420_FORMAT_AT(target, prefix##_rgbx, count)                                                     \
+SCDK_REVERSE_ROWS_YUV420_FORMAT_AT(target, prefix##_bgrx, count)                                                     \
+SCDK_REVERSE_ROWS_YUV420_FORMAT_AT(target, prefix##_xbgr, count)                                                     \
+SCDK_REVERSE_ROWS_YUV420_FORMAT_AT(target, prefix##_xrgb, count)                                                     \
+                                                                                                                      \
+static const scdk_reverse_rows_yuv420_func_t prefix##_table_##count[SCDK_KERNELS_RGB_FORMAT_COUNT] =                 \
+{                                                                                                                     \
+	prefix##_rgb_##count,                                                                                             \
+	prefix##_bgr_##count,                                                                                             \
+	prefix##_rgbx_##count,                                                                                            \
+	prefix##_bgrx_##count,                                                                                            \
+	prefix##_xbgr_##count,                                                                                            \
+	prefix##_xrgb_##count,                                                                                            \
+	prefix##_rgbx_##count,                                                                                            \
+	prefix##_bgrx_##count,                                                                                            \
+	prefix##_xbgr_##count,                                                                                            \
+	prefix##_xrgb_##count                                                                                             \
+};
+
+// Initializes the scdk_key_row_kernels_t of one key width from the instances of the named kernels
+#define SCDK_KEY_ROW_KERNELS(width, chroma_width, row_24, row_32, row_8, row_uv, rows_yuv420)                        \
+	{                                                                                                                 \
+		width,                                                                                                        \
+		row_24##_##width,                                                                                             \
+		row_32##_##width,                                                                                             \
+		row_8##_##width,                                                                                              \
+		row_8##_##chroma_width,                                                                                       \
+		row_uv##_##chroma_width,                                                                                      \
+		rows_yuv420##_table_##width                                                                                   \
+	},
+
+#define SCDK_KEY_ROW_KERNELS_SCALAR_AT(width, chroma_width)                                                          \
+SCDK_REVERSE_ROW_AT(, scdk_reverse_row_24_scalar, width)                                                             \
+SCDK_REVERSE_ROW_AT(, scdk_reverse_row_32_scalar, width)                                                             \
+SCDK_REVERSE_ROW_AT(, scdk_reverse_row_8_scalar, width)                                                              \
+SCDK_REVERSE_ROW_AT(, scdk_reverse_row_8_scalar, chroma_width)                                                       \
+SCDK_REVERSE_ROW_UV_AT(, scdk_reverse_row_uv_scalar, chroma_width)                                                   \
+SCDK_REVERSE_ROWS_YUV420_AT(, scdk_reverse_rows_yuv420, width)
+
+SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_SCALAR_AT)
+
+#define SCDK_KEY_ROW_KERNELS_SCALAR(width, chroma_width)                                                             \
+	SCDK_KEY_ROW_KERNELS(width, chroma_width, scdk_reverse_row_24_scalar, scdk_reverse_row_32_scalar,                \
+	                     scdk_reverse_row_8_scalar, scdk_reverse_row_uv_scalar, scdk_reverse_rows_yuv420)
+
+static const scdk_key_row_kernels_t scdk_key_row_kernels_scalar[] =
+{
+	SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_SCALAR)
+	{
+		0,
+		scdk_reverse_row_24_scalar,
+		scdk_reverse_row_32_scalar,
+		scdk_reverse_row_8_scalar,
+		scdk_reverse_row_8_scalar,
+		scdk_reverse_row_uv_scalar,
+		scdk_reverse_rows_yuv420_scalar_table
+	}
+};
+
+static void scdk_sad_row_16_scalar(const unsigned char* a, const unsigned char* b, int length, uint32_t* sums)
+{
+	for (int i = 0; i < length; ++i)
+		sums[i / 16] += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+}
+
+// Float AAN forward DCT over one dimension of 8 values in d, as in libjpeg's jfdctflt.c, with outputs scaled by the
+// AAN factors that the quantization divisors undo. Written against the vector operations so every variant performs the
+// same arithmetic in the same order and matches the scalar kernel exactly.
+#define SCDK_FDCT_AAN(T, ADD, SUB, MUL, SET, d)                  \
+	do                                                            \
+	{                                                             \
+		const T tmp0 = ADD(d[0], d[7]);                           \
+		const T tmp7 = SUB(d[0], d[7]);                           \
+		const T tmp1 = ADD(d[1], d[6]);                           \
+		const T tmp6 = SUB(d[1], d[6]);                           \
+		const T tmp2 = ADD(d[2], d[5]);                           \
+		const T tmp5 = SUB(d[2], d[5]);                           \
+		const T tmp3 = ADD(d[3], d[4]);                           \
+		const T tmp4 = SUB(d[3], d[4]);                           \
+                                                                  \
+		const T tmp10 = ADD(tmp0, tmp3);                          \
+		const T tmp13 = SUB(tmp0, tmp3);                          \
+		const T tmp11 = ADD(tmp1, tmp2);                          \
+		const T tmp12 = SUB(tmp1, tmp2);                          \
+                                                                  \
+		d[0] = ADD(tmp10, tmp11);                                 \
+		d[4] = SUB(tmp10, tmp11);                                 \
+                                                                  \
+		const T z1 = MUL(ADD(tmp12, tmp13), SET(0.707106781f));   \
+		d[2] = ADD(tmp13, z1);                                    \
+		d[6] = SUB(tmp13, z1);                                    \
+                                                                  \
+		const T odd10 = ADD(tmp4, tmp5);                          \
+		const T odd11 = ADD(tmp5, tmp6);                          \
+		const T odd12 = ADD(tmp6, tmp7);                          \
+                                                                  \
+		const T z5 = MUL(SUB(odd10, odd12), SET(0.382683433f));   \
+		const T z2 = ADD(MUL(odd10, SET(0.541196100f)), z5);      \
+		const T z4 = ADD(MUL(odd12, SET(1.306562965f)), z5);      \
+		const T z3 = MUL(odd11, SET(0.707106781f));               \
+                                                                  \
+		const T z11 = ADD(tmp7, z3);                              \
+		const T z13 = SUB(tmp7, z3);                              \
+                                                                  \
+		d[5] = ADD(z13, z2);                                      \
+		d[3] = SUB(z13, z2);                                      \
+		d[1] = ADD(z11, z4);                                      \
+		d[7] = SUB(z11, z4);                                      \
+	} while (0)
+
+#define SCDK_FDCT_ADD_SCALAR(a, b) ((a) + (b))
+#define SCDK_FDCT_SUB_SCALAR(a, b) ((a) - (b))
+#define SCDK_FDCT_MUL_SCALAR(a, b) ((a) * (b))
+#define SCDK_FDCT_SET_SCALAR(x) (x)
+
+// Rounds to nearest by truncating a biased positive value, as libjpeg's float quantization does
+#define SCDK_FDCT_ROUND_BIAS 16384
+
+// Columns are transformed before rows, the same order the SIMD variants use
+static uint64_t scdk_fdct_8x8_scalar(const unsigned char* src, int stride, const float* divisors,
+                                     int16_t* coefficients)
+{
+	float block[8][8];
+	uint64_t nonzero_mask = 0;
+
+	for (int x = 0; x < 8; ++x)
+	{
+		float d[8];
+		for (int y = 0; y < 8; ++y)
+			d[y] = (float)(src[(y * stride) + x] - 128);
+
+		SCDK_FDCT_AAN(float, SCDK_FDCT_ADD_SCALAR, SCDK_FDCT_SUB_SCALAR, SCDK_FDCT_MUL_SCALAR, SCDK_FDCT_SET_SCALAR, d);
+
+		for (int v = 0; v < 8; ++v)
+			block[v][x] = d[v];
+	}
+
+	for (int v = 0; v < 8; ++v)
+	{
+		SCDK_FDCT_AAN(float, SCDK_FDCT_ADD_SCALAR, SCDK_FDCT_SUB_SCALAR, SCDK_FDCT_MUL_SCALAR, SCDK_FDCT_SET_SCALAR,
+		              block[v]);
+
+		for (int u = 0; u < 8; ++u)
+		{
+			const float value = (block[v][u] * divisors[(v * 8) + u]) + ((float)SCDK_FDCT_ROUND_BIAS + 0.5f);
+			coefficients[(v * 8) + u] = (int16_t)((int)value - SCDK_FDCT_ROUND_BIAS);
+			nonzero_mask |= (uint64_t)(coefficients[(v * 8) + u] != 0) << ((v * 8) + u);
+		}
+	}
+
+	return nonzero_mask;
+}
+
+static const scdk_kernels_t scdk_kernels_scalar =
+{
+	"scalar",
+	scdk_reverse_row_8_scalar,
+	scdk_reverse_row_uv_scalar,
+	scdk_reverse_row_24_scalar,
+	scdk_reverse_row_32_scalar,
+	scdk_reverse_rows_yuv420_scalar_table,
+	scdk_sad_row_16_scalar,
+	scdk_fdct_8x8_scalar,
+	scdk_key_row_kernels_scalar
+};
+
+#ifdef SCDK_KERNELS_X86
+
+SCDK_TARGET("sse2")
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_32_sse2(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	int i = 0;
+
+	for (; i + 4 <= pixel_count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + (pixel_count - i - 4) * 4));
+		v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+		_mm_storeu_si128((__m128i*)(dst + i * 4), v);
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_32_scalar(src, dst + i * 4, pixel_count - i);
+}
+
+SCDK_TARGET("sse2")
+static void scdk_sad_row_16_sse2(const unsigned char* a, const unsigned char* b, int length, uint32_t* sums)
+{
+	int i = 0;
+
+	for (; i + 16 <= length; i += 16)
+	{
+		const __m128i sad = _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(a + i)),
+		                                 _mm_loadu_si128((const __m128i*)(b + i)));
+		sums[i / 16] += (uint32_t)(_mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_srli_si128(sad, 8)));
+	}
+
+	if (i < length)
+		scdk_sad_row_16_scalar(a + i, b + i, length - i, sums + (i / 16));
+}
+
+// Transposes the 8x8 block held as the left (lo) and right (hi) halves of 8 rows
+#define SCDK_TRANSPOSE_8X8_PS(lo, hi)                                                            \
+	do                                                                                           \
+	{                                                                                            \
+		_MM_TRANSPOSE4_PS(lo[0], lo[1], lo[2], lo[3]);                                           \
+		_MM_TRANSPOSE4_PS(hi[0], hi[1], hi[2], hi[3]);                                           \
+		_MM_TRANSPOSE4_PS(lo[4], lo[5], lo[6], lo[7]);                                           \
+		_MM_TRANSPOSE4_PS(hi[4], hi[5], hi[6], hi[7]);                                           \
+		for (int i = 0; i < 4; ++i)                                                              \
+		{                                                                                        \
+			const __m128 swap = hi[i];                                                           \
+			hi[i] = lo[i + 4];                                                                   \
+			lo[i + 4] = swap;                                                                    \
+		}                                                                                        \
+	} while (0)
+
+// Each vector holds four columns of a row, so a pass of the AAN butterflies transforms four columns at once. The block
+// is transposed between the column and row passes, and back again for quantization.
+SCDK_TARGET("sse2")
+static uint64_t scdk_fdct_8x8_sse2(const unsigned char* src, int stride, const float* divisors,
+                                   int16_t* coefficients)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i level_shift = _mm_set1_epi16(128);
+	__m128 lo[8];
+	__m128 hi[8];
+
+	for (int y = 0; y < 8; ++y)
+	{
+		const __m128i samples = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + (y * stride))),
+		                                                        zero), level_shift);
+		lo[y] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+		hi[y] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+	}
+
+	SCDK_FDCT_AAN(__m128, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_set1_ps, lo);
+	SCDK_FDCT_AAN(__m128, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_set1_ps, hi);
+
+	SCDK_TRANSPOSE_8X8_PS(lo, hi);
+
+	SCDK_FDCT_AAN(__m128, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_set1_ps, lo);
+	SCDK_FDCT_AAN(__m128, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_set1_ps, hi);
+
+	SCDK_TRANSPOSE_8X8_PS(lo, hi);
+
+	const __m128 bias = _mm_set1_ps((float)SCDK_FDCT_ROUND_BIAS + 0.5f);
+	const __m128i unbias = _mm_set1_epi32(SCDK_FDCT_ROUND_BIAS);
+	uint64_t zero_mask = 0;
+
+	for (int v = 0; v < 8; v += 2)
+	{
+		__m128i quantized[2];
+
+		for (int i = 0; i < 2; ++i)
+		{
+			const __m128 scaled_lo = _mm_add_ps(_mm_mul_ps(lo[v + i], _mm_loadu_ps(divisors + ((v + i) * 8))), bias);
+			const __m128 scaled_hi = _mm_add_ps(_mm_mul_ps(hi[v + i], _mm_loadu_ps(divisors + ((v + i) * 8) + 4)),
+			                                    bias);
+
+			quantized[i] = _mm_packs_epi32(_mm_sub_epi32(_mm_cvttps_epi32(scaled_lo), unbias),
+			                               _mm_sub_epi32(_mm_cvttps_epi32(scaled_hi), unbias));
+			_mm_storeu_si128((__m128i*)(coefficients + ((v + i) * 8)), quantized[i]);
+		}
+
+		const __m128i is_zero = _mm_packs_epi16(_mm_cmpeq_epi16(quantized[0], zero),
+		                                        _mm_cmpeq_epi16(quantized[1], zero));
+		zero_mask |= (uint64_t)(uint32_t)_mm_movemask_epi8(is_zero) << (v * 8);
+	}
+
+	return ~zero_mask;
+}
+
+// Each iteration loads 16 bytes starting one byte before the 5 pixels being moved, so the load never reads past the
+// end of the source row. The 16th byte stored is garbage and is overwritten by the next iteration or the scalar tail.
+SCDK_TARGET("ssse3")
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_24_ssse3(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	const __m128i mask = _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, 0);
+	int i = 0;
+
+	for (; i + 6 <= pixel_count; i += 5)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + (pixel_count - i - 5) * 3 - 1));
+		v = _mm_shuffle_epi8(v, mask);
+		_mm_storeu_si128((__m128i*)(dst + i * 3), v);
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_24_scalar(src, dst + i * 3, pixel_count - i);
+}
+
+SCDK_TARGET("ssse3")
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_8_ssse3(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	const __m128i mask = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	int i = 0;
+
+	for (; i + 16 <= pixel_count; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + pixel_count - i - 16));
+		v = _mm_shuffle_epi8(v, mask);
+		_mm_storeu_si128((__m128i*)(dst + i), v);
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_8_scalar(src, dst + i, pixel_count - i);
+}
+
+SCDK_TARGET("ssse3")
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_uv_ssse3(const unsigned char* src, unsigned char* dst_u,
+                                                         unsigned char* dst_v, int pixel_count)
+{
+	const __m128i mask = _mm_setr_epi8(14, 12, 10, 8, 6, 4, 2, 0, 15, 13, 11, 9, 7, 5, 3, 1);
+	int i = 0;
+
+	for (; i + 8 <= pixel_count; i += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(src + (pixel_count - i - 8) * 2));
+		v = _mm_shuffle_epi8(v, mask);
+		_mm_storel_epi64((__m128i*)(dst_u + i), v);
+		_mm_storel_epi64((__m128i*)(dst_v + i), _mm_unpackhi_epi64(v, v));
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_uv_scalar(src, dst_u + i, dst_v + i, pixel_count - i);
+}
+
+SCDK_TARGET("avx2")
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_32_avx2(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	const __m256i permutation = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	int i = 0;
+
+	for (; i + 8 <= pixel_count; i += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(src + (pixel_count - i - 8) * 4));
+		v = _mm256_permutevar8x32_epi32(v, permutation);
+		_mm256_storeu_si256((__m256i*)(dst + i * 4), v);
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_32_sse2(src, dst + i * 4, pixel_count - i);
+}
+
+// Builds a pshufb mask that reverses a group of 4 pixels starting at byte offset base of the loaded vector, placing
+// channels c0 and c1 of each pixel as a pair of 16-bit values in one 32-bit lane ready for _mm_madd_epi16
+SCDK_TARGET("ssse3")
+static inline __m128i scdk_pair_mask(const int base, const int pixel_size, const int c0, const int c1)
+{
+	return _mm_setr_epi8(
+		(char)(base + (3 * pixel_size) + c0), -1, (char)(base + (3 * pixel_size) + c1), -1,
+		(char)(base + (2 * pixel_size) + c0), -1, (char)(base + (2 * pixel_size) + c1), -1,
+		(char)(base + pixel_size + c0), -1, (char)(base + pixel_size + c1), -1,
+		(char)(base + c0), -1, (char)(base + c1), -1);
+}
+
+// Same arithmetic as the scalar kernel, so results match it exactly. 0.587 is split as 0.337 + 0.25 and the 0.5
+// chroma terms are applied as shifts so every coefficient fits in a signed 16-bit multiplier.
+SCDK_TARGET("ssse3")
+static SCDK_ALWAYS_INLINE void scdk_reverse_rows_yuv420_ssse3(const unsigned char* src0, const unsigned char* src1,
+                                                  unsigned char* y0, unsigned char* y1,
+                                                  unsigned char* cb, unsigned char* cr, int pixel_count,
+                                                  const int pixel_size, const int r, const int g, const int b)
+{
+	if (pixel_count % 8 != 0)
+	{
+		scdk_reverse_rows_yuv420_scalar(src0, src1, y0, y1, cb, cr, pixel_count, pixel_size, r, g, b);
+		return;
+	}
+
+	// 24-bit groups are loaded from 4 bytes before the group so the load never reads past the end of the row, except
+	// for the group at the start of the row
+	const int base = pixel_size == 3 ? 4 : 0;
+	const __m128i rg_mask = scdk_pair_mask(base, pixel_size, r, g);
+	const __m128i bg_mask = scdk_pair_mask(base, pixel_size, b, g);
+	const __m128i rg_mask_start = scdk_pair_mask(0, pixel_size, r, g);
+	const __m128i bg_mask_start = scdk_pair_mask(0, pixel_size, b, g);
+
+	const __m128i y_rg = _mm_setr_epi16(SCDK_FIX(0.29900), SCDK_FIX(0.33700), SCDK_FIX(0.29900), SCDK_FIX(0.33700),
+	                                    SCDK_FIX(0.29900), SCDK_FIX(0.33700), SCDK_FIX(0.29900), SCDK_FIX(0.33700));
+	const __m128i y_bg = _mm_setr_epi16(SCDK_FIX(0.11400), SCDK_FIX(0.25000), SCDK_FIX(0.11400), SCDK_FIX(0.25000),
+	                                    SCDK_FIX(0.11400), SCDK_FIX(0.25000), SCDK_FIX(0.11400), SCDK_FIX(0.25000));
+	const __m128i cb_rg = _mm_setr_epi16(-SCDK_FIX(0.16874), -SCDK_FIX(0.33126), -SCDK_FIX(0.16874), -SCDK_FIX(0.33126),
+	                                     -SCDK_FIX(0.16874), -SCDK_FIX(0.33126), -SCDK_FIX(0.16874), -SCDK_FIX(0.33126));
+	const __m128i cr_bg = _mm_setr_epi16(-SCDK_FIX(0.08131), -SCDK_FIX(0.41869), -SCDK_FIX(0.08131), -SCDK_FIX(0.41869),
+	                                     -SCDK_FIX(0.08131), -SCDK_FIX(0.41869), -SCDK_FIX(0.08131), -SCDK_FIX(0.41869));
+	const __m128i y_bias = _mm_set1_epi32(32768);
+	const __m128i c_bias = _mm_set1_epi32((128 << 18) + (1 << 17));
+	const __m128i low_mask = _mm_set1_epi32(0xFFFF);
+
+	const unsigned char* src[2] = { src0, src1 };
+	unsigned char* dst_y[2] = { y0, y1 };
+
+	for (int x = 0; x < pixel_count; x += 8)
+	{
+		__m128i rg[2][2];
+		__m128i bg[2][2];
+
+		for (int row = 0; row < 2; ++row)
+		{
+			for (int group = 0; group < 2; ++group)
+			{
+				const int j = pixel_count - 4 - x - (group * 4);
+
+				if (pixel_size == 3 && j == 0)
+				{
+					const __m128i v = _mm_loadu_si128((const __m128i*)src[row]);
+					rg[row][group] = _mm_shuffle_epi8(v, rg_mask_start);
+					bg[row][group] = _mm_shuffle_epi8(v, bg_mask_start);
+				}
+				else
+				{
+					const __m128i v = _mm_loadu_si128((const __m128i*)(src[row] + (j * pixel_size) - base));
+					rg[row][group] = _mm_shuffle_epi8(v, rg_mask);
+					bg[row][group] = _mm_shuffle_epi8(v, bg_mask);
+				}
+			}
+
+			__m128i y_values[2];
+			for (int group = 0; group < 2; ++group)
+			{
+				const __m128i sum = _mm_add_epi32(_mm_madd_epi16(rg[row][group], y_rg),
+				                                  _mm_madd_epi16(bg[row][group], y_bg));
+				y_values[group] = _mm_srli_epi32(_mm_add_epi32(sum, y_bias), 16);
+			}
+
+			const __m128i y_packed = _mm_packs_epi32(y_values[0], y_values[1]);
+			_mm_storel_epi64((__m128i*)(dst_y[row] + x), _mm_packus_epi16(y_packed, y_packed));
+		}
+
+		__m128i cb_values[2];
+		__m128i cr_values[2];
+
+		for (int group = 0; group < 2; ++group)
+		{
+			// Sum vertically then horizontally, leaving each 2x2 block sum in lanes 0 and 2
+			__m128i rg_sum = _mm_add_epi16(rg[0][group], rg[1][group]);
+			__m128i bg_sum = _mm_add_epi16(bg[0][group], bg[1][group]);
+			rg_sum = _mm_add_epi16(rg_sum, _mm_srli_epi64(rg_sum, 32));
+			bg_sum = _mm_add_epi16(bg_sum, _mm_srli_epi64(bg_sum, 32));
+
+			const __m128i r_half = _mm_slli_epi32(_mm_and_si128(rg_sum, low_mask), 15);
+			const __m128i b_half = _mm_slli_epi32(_mm_and_si128(bg_sum, low_mask), 15);
+
+			const __m128i cb_value = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(rg_sum, cb_rg), b_half), c_bias);
+			const __m128i cr_value = _mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(bg_sum, cr_bg), r_half), c_bias);
+
+			cb_values[group] = _mm_shuffle_epi32(_mm_srai_epi32(cb_value, 18), _MM_SHUFFLE(0, 0, 2, 0));
+			cr_values[group] = _mm_shuffle_epi32(_mm_srai_epi32(cr_value, 18), _MM_SHUFFLE(0, 0, 2, 0));
+		}
+
+		__m128i c_packed = _mm_packs_epi32(_mm_unpacklo_epi64(cb_values[0], cb_values[1]),
+		                                   _mm_unpacklo_epi64(cr_values[0], cr_values[1]));
+		c_packed = _mm_packus_epi16(c_packed, c_packed);
+
+		const uint32_t cb_out = (uint32_t)_mm_cvtsi128_si32(c_packed);
+		const uint32_t cr_out = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(c_packed, 4));
+		memcpy(cb + (x / 2), &cb_out, 4);
+		memcpy(cr + (x / 2), &cr_out, 4);
+	}
+}
+
+#define SCDK_REVERSE_ROWS_YUV420_SSSE3(name, pixel_size, r, g, b)                                                    \
+SCDK_TARGET("ssse3")                                                                                                  \
+static SCDK_ALWAYS_INLINE void scdk_reverse_rows_yuv420_ssse3_##name(const unsigned char* src0,                       \
+                                                                     const unsigned char* src1,                       \
+                                                                     unsigned char* y0, unsigned char* y1,            \
+                                                                     unsigned char* cb, unsigned char* cr,            \
+                                                                     int pixel_count)                                 \
+{                                                                                                                     \
+	scdk_reverse_rows_yuv420_ssse3(src0, src1, y0, y1, cb, cr, pixel_count, pixel_size, r, g, b);                    \
+}
+
+SCDK_REVERSE_ROWS_YUV420_SSSE3(rgb, 3, 0, 1, 2)
+SCDK_REVERSE_ROWS_YUV420_SSSE3(bgr, 3, 2, 1, 0)
+SCDK_REVERSE_ROWS_YUV420_SSSE3(rgbx, 4, 0, 1, 2)
+SCDK_REVERSE_ROWS_YUV420_SSSE3(bgrx, 4, 2, 1, 0)
+SCDK_REVERSE_ROWS_YUV420_SSSE3(xbgr, 4, 3, 2, 1)
+SCDK_REVERSE_ROWS_YUV420_SSSE3(xrgb, 4, 1, 2, 3)
+
+static const scdk_reverse_rows_yuv420_func_t scdk_reverse_rows_yuv420_ssse3_table[SCDK_KERNELS_RGB_FORMAT_COUNT] =
+{
+	scdk_reverse_rows_yuv420_ssse3_rgb,
+	scdk_reverse_rows_yuv420_ssse3_bgr,
+	scdk_reverse_rows_yuv420_ssse3_rgbx,
+	scdk_reverse_rows_yuv420_ssse3_bgrx,
+	scdk_reverse_rows_yuv420_ssse3_xbgr,
+	scdk_reverse_rows_yuv420_ssse3_xrgb,
+	scdk_reverse_rows_yuv420_ssse3_rgbx,
+	scdk_reverse_rows_yuv420_ssse3_bgrx,
+	scdk_reverse_rows_yuv420_ssse3_xbgr,
+	scdk_reverse_rows_yuv420_ssse3_xrgb
+};
+
+#define SCDK_KEY_ROW_KERNELS_SSE2_AT(width, chroma_width)                                                            \
+SCDK_REVERSE_ROW_AT(SCDK_TARGET("sse2"), scdk_reverse_row_32_sse2, width)
+
+#define SCDK_KEY_ROW_KERNELS_SSSE3_AT(width, chroma_width)                                                           \
+SCDK_REVERSE_ROW_AT(SCDK_TARGET("ssse3"), scdk_reverse_row_24_ssse3, width)                                          \
+SCDK_REVERSE_ROW_AT(SCDK_TARGET("ssse3"), scdk_reverse_row_8_ssse3, width)                                           \
+SCDK_REVERSE_ROW_AT(SCDK_TARGET("ssse3"), scdk_reverse_row_8_ssse3, chroma_width)                                    \
+SCDK_REVERSE_ROW_UV_AT(SCDK_TARGET("ssse3"), scdk_reverse_row_uv_ssse3, chroma_width)                                \
+SCDK_REVERSE_ROWS_YUV420_AT(SCDK_TARGET("ssse3"), scdk_reverse_rows_yuv420_ssse3, width)
+
+#define SCDK_KEY_ROW_KERNELS_AVX2_AT(width, chroma_width)                                                            \
+SCDK_REVERSE_ROW_AT(SCDK_TARGET("avx2"), scdk_reverse_row_32_avx2, width)
+
+SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_SSE2_AT)
+SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_SSSE3_AT)
+SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_AVX2_AT)
+
+#define SCDK_KEY_ROW_KERNELS_SSE2(width, chroma_width)                                                               \
+	SCDK_KEY_ROW_KERNELS(width, chroma_width, scdk_reverse_row_24_scalar, scdk_reverse_row_32_sse2,                  \
+	                     scdk_reverse_row_8_scalar, scdk_reverse_row_uv_scalar, scdk_reverse_rows_yuv420)
+
+#define SCDK_KEY_ROW_KERNELS_SSSE3(width, chroma_width)                                                              \
+	SCDK_KEY_ROW_KERNELS(width, chroma_width, scdk_reverse_row_24_ssse3, scdk_reverse_row_32_sse2,                   \
+	                     scdk_reverse_row_8_ssse3, scdk_reverse_row_uv_ssse3, scdk_reverse_rows_yuv420_ssse3)
+
+#define SCDK_KEY_ROW_KERNELS_AVX2(width, chroma_width)                                                               \
+	SCDK_KEY_ROW_KERNELS(width, chroma_width, scdk_reverse_row_24_ssse3, scdk_reverse_row_32_avx2,                   \
+	                     scdk_reverse_row_8_ssse3, scdk_reverse_row_uv_ssse3, scdk_reverse_rows_yuv420_ssse3)
+
+static const scdk_key_row_kernels_t scdk_key_row_kernels_sse2[] =
+{
+	SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_SSE2)
+	{
+		0,
+		scdk_reverse_row_24_scalar,
+		scdk_reverse_row_32_sse2,
+		scdk_reverse_row_8_scalar,
+		scdk_reverse_row_8_scalar,
+		scdk_reverse_row_uv_scalar,
+		scdk_reverse_rows_yuv420_scalar_table
+	}
+};
+
+static const scdk_key_row_kernels_t scdk_key_row_kernels_ssse3[] =
+{
+	SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_SSSE3)
+	{
+		0,
+		scdk_reverse_row_24_ssse3,
+		scdk_reverse_row_32_sse2,
+		scdk_reverse_row_8_ssse3,
+		scdk_reverse_row_8_ssse3,
+		scdk_reverse_row_uv_ssse3,
+		scdk_reverse_rows_yuv420_ssse3_table
+	}
+};
+
+static const scdk_key_row_kernels_t scdk_key_row_kernels_avx2[] =
+{
+	SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_AVX2)
+	{
+		0,
+		scdk_reverse_row_24_ssse3,
+		scdk_reverse_row_32_avx2,
+		scdk_reverse_row_8_ssse3,
+		scdk_reverse_row_8_ssse3,
+		scdk_reverse_row_uv_ssse3,
+		scdk_reverse_rows_yuv420_ssse3_table
+	}
+};
+
+static const scdk_kernels_t scdk_kernels_sse2 =
+{
+	"sse2",
+	scdk_reverse_row_8_scalar,
+	scdk_reverse_row_uv_scalar,
+	scdk_reverse_row_24_scalar,
+	scdk_reverse_row_32_sse2,
+	scdk_reverse_rows_yuv420_scalar_table,
+	scdk_sad_row_16_sse2,
+	scdk_fdct_8x8_sse2,
+	scdk_key_row_kernels_sse2
+};
+
+static const scdk_kernels_t scdk_kernels_ssse3 =
+{
+	"ssse3",
+	scdk_reverse_row_8_ssse3,
+	scdk_reverse_row_uv_ssse3,
+	scdk_reverse_row_24_ssse3,
+	scdk_reverse_row_32_sse2,
+	scdk_reverse_rows_yuv420_ssse3_table,
+	scdk_sad_row_16_sse2,
+	scdk_fdct_8x8_sse2,
+	scdk_key_row_kernels_ssse3
+};
+
+static const scdk_kernels_t scdk_kernels_avx2 =
+{
+	"avx2",
+	scdk_reverse_row_8_ssse3,
+	scdk_reverse_row_uv_ssse3,
+	scdk_reverse_row_24_ssse3,
+	scdk_reverse_row_32_avx2,
+	scdk_reverse_rows_yuv420_ssse3_table,
+	scdk_sad_row_16_sse2,
+	scdk_fdct_8x8_sse2,
+	scdk_key_row_kernels_avx2
+};
+
+typedef enum scdk_cpu_feature_e
+{
+	SCDK_CPU_FEATURE_SSE2 = 1 << 0,
+	SCDK_CPU_FEATURE_SSSE3 = 1 << 1,
+	SCDK_CPU_FEATURE_AVX2 = 1 << 2
+
+} scdk_cpu_feature_e;
+
+static int scdk_get_cpu_features(void)
+{
+	int features = 0;
+
+#ifdef _MSC_VER
+	int info[4];
+
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	if (info[3] & (1 << 26))
+		features |= SCDK_CPU_FEATURE_SSE2;
+	if (info[2] & (1 << 9))
+		features |= SCDK_CPU_FEATURE_SSSE3;
+
+	const bool is_avx_usable = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+
+	if (max_leaf >= 7 && is_avx_usable)
+	{
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			features |= SCDK_CPU_FEATURE_AVX2;
+	}
+#else
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse2"))
+		features |= SCDK_CPU_FEATURE_SSE2;
+	if (__builtin_cpu_supports("ssse3"))
+		features |= SCDK_CPU_FEATURE_SSSE3;
+	if (__builtin_cpu_supports("avx2"))
+		features |= SCDK_CPU_FEATURE_AVX2;
+#endif
+
+	return features;
+}
+
+#endif // SCDK_KERNELS_X86
+
+#ifdef SCDK_KERNELS_NEON
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_24_neon(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	int i = 0;
+
+	for (; i + 16 <= pixel_count; i += 16)
+	{
+		uint8x16x3_t v = vld3q_u8(src + (pixel_count - i - 16) * 3);
+
+		for (int c = 0; c < 3; ++c)
+		{
+			const uint8x16_t reversed = vrev64q_u8(v.val[c]);
+			v.val[c] = vextq_u8(reversed, reversed, 8);
+		}
+
+		vst3q_u8(dst + i * 3, v);
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_24_scalar(src, dst + i * 3, pixel_count - i);
+}
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_32_neon(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	int i = 0;
+
+	for (; i + 4 <= pixel_count; i += 4)
+	{
+		uint32x4_t v = vreinterpretq_u32_u8(vld1q_u8(src + (pixel_count - i - 4) * 4));
+		v = vrev64q_u32(v);
+		v = vextq_u32(v, v, 2);
+		vst1q_u8(dst + i * 4, vreinterpretq_u8_u32(v));
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_32_scalar(src, dst + i * 4, pixel_count - i);
+}
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_8_neon(const unsigned char* src, unsigned char* dst, int pixel_count)
+{
+	int i = 0;
+
+	for (; i + 16 <= pixel_count; i += 16)
+	{
+		const uint8x16_t reversed = vrev64q_u8(vld1q_u8(src + pixel_count - i - 16));
+		vst1q_u8(dst + i, vextq_u8(reversed, reversed, 8));
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_8_scalar(src, dst + i, pixel_count - i);
+}
+
+static SCDK_ALWAYS_INLINE void scdk_reverse_row_uv_neon(const unsigned char* src, unsigned char* dst_u,
+                                                        unsigned char* dst_v, int pixel_count)
+{
+	int i = 0;
+
+	for (; i + 16 <= pixel_count; i += 16)
+	{
+		const uint8x16x2_t v = vld2q_u8(src + (pixel_count - i - 16) * 2);
+		const uint8x16_t reversed_u = vrev64q_u8(v.val[0]);
+		const uint8x16_t reversed_v = vrev64q_u8(v.val[1]);
+		vst1q_u8(dst_u + i, vextq_u8(reversed_u, reversed_u, 8));
+		vst1q_u8(dst_v + i, vextq_u8(reversed_v, reversed_v, 8));
+	}
+
+	if (i < pixel_count)
+		scdk_reverse_row_uv_scalar(src, dst_u + i, dst_v + i, pixel_count - i);
+}
+
+static void scdk_sad_row_16_neon(const unsigned char* a, const unsigned char* b, int length, uint32_t* sums)
+{
+	int i = 0;
+
+	for (; i + 16 <= length; i += 16)
+	{
+		const uint8x16_t difference = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+		const uint64x2_t sad = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(difference)));
+		sums[i / 16] += (uint32_t)(vgetq_lane_u64(sad, 0) + vgetq_lane_u64(sad, 1));
+	}
+
+	if (i < length)
+		scdk_sad_row_16_scalar(a + i, b + i, length - i, sums + (i / 16));
+}
+
+#define SCDK_KEY_ROW_KERNELS_NEON_AT(width, chroma_width)                                                            \
+SCDK_REVERSE_ROW_AT(, scdk_reverse_row_24_neon, width)                                                               \
+SCDK_REVERSE_ROW_AT(, scdk_reverse_row_32_neon, width)                                                               \
+SCDK_REVERSE_ROW_AT(, scdk_reverse_row_8_neon, width)                                                                \
+SCDK_REVERSE_ROW_AT(, scdk_reverse_row_8_neon, chroma_width)                                                         \
+SCDK_REVERSE_ROW_UV_AT(, scdk_reverse_row_uv_neon, chroma_width)
+
+SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_NEON_AT)
+
+#define SCDK_KEY_ROW_KERNELS_NEON(width, chroma_width)                                                               \
+	SCDK_KEY_ROW_KERNELS(width, chroma_width, scdk_reverse_row_24_neon, scdk_reverse_row_32_neon,                    \
+	                     scdk_reverse_row_8_neon, scdk_reverse_row_uv_neon, scdk_reverse_rows_yuv420)
+
+static const scdk_key_row_kernels_t scdk_key_row_kernels_neon[] =
+{
+	SCDK_KERNELS_KEY_WIDTHS(SCDK_KEY_ROW_KERNELS_NEON)
+	{
+		0,
+		scdk_reverse_row_24_neon,
+		scdk_reverse_row_32_neon,
+		scdk_reverse_row_8_neon,
+		scdk_reverse_row_8_neon,
+		scdk_reverse_row_uv_neon,
+		scdk_reverse_rows_yuv420_scalar_table
+	}
+};
+
+static const scdk_kernels_t scdk_kernels_neon =
+{
+	"neon",
+	scdk_reverse_row_8_neon,
+	scdk_reverse_row_uv_neon,
+	scdk_reverse_row_24_neon,
+	scdk_reverse_row_32_neon,
+	scdk_reverse_rows_yuv420_scalar_table,
+	scdk_sad_row_16_neon,
+	scdk_fdct_8x8_scalar,
+	scdk_key_row_kernels_neon
+};
+
+#endif // SCDK_KERNELS_NEON
+
+const scdk_kernels_t* scdk_get_kernels(void)
+{
+#if defined(SCDK_KERNELS_X86)
+	const int features = scdk_get_cpu_features();
+
+	if ((features & SCDK_CPU_FEATURE_AVX2) && (features & SCDK_CPU_FEATURE_SSSE3))
+		return &scdk_kernels_avx2;
+	if (features & SCDK_CPU_FEATURE_SSSE3)
+		return &scdk_kernels_ssse3;
+	if (features & SCDK_CPU_FEATURE_SSE2)
+		return &scdk_kernels_sse2;
+#elif defined(SCDK_KERNELS_NEON)
+	return &scdk_kernels_neon;
+#endif
+
+	return &scdk_kernels_scalar;
+}
+
+const scdk_key_row_kernels_t* scdk_get_key_row_kernels(const scdk_kernels_t* kernels, int key_width)
+{
+	const scdk_key_row_kernels_t* key_row_kernels = kernels->key_row_kernels;
+
+	while (key_row_kernels->key_width != 0 && key_row_kernels->key_width != key_width)
+		++key_row_kernels;
+
+	return key_row_kernels;
+}
+
+const scdk_kernels_t* scdk_get_reference_kernels(void)
+{
+	return &scdk_kernels_scalar;
+}
@@ -0,0 +1,84 @@
+#ifndef SCDK_KERNELS_H
+#define SCDK_KERNELS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#define SCDK_ALWAYS_INLINE __forceinline
+#else
+#define SCDK_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
+
+// Copies pixel_count pixels from src to dst in reverse pixel order, preserving channel order within each pixel
+typedef void (*scdk_reverse_row_func_t)(const unsigned char* src, unsigned char* dst, int pixel_count);
+
+// Copies pixel_count interleaved 2 byte pixels from src to separate dst_u and dst_v rows in reverse pixel order
+typedef void (*scdk_reverse_row_uv_func_t)(const unsigned char* src, unsigned char* dst_u, unsigned char* dst_v,
+                                           int pixel_count);
+
+// Converts two source rows to two rows of Y and one row each of Cb and Cr subsampled 4:2:0, reversing pixel order.
+// pixel_count must be even.
+typedef void (*scdk_reverse_rows_yuv420_func_t)(const unsigned char* src0, const unsigned char* src1,
+                                                unsigned char* y0, unsigned char* y1,
+                                                unsigned char* cb, unsigned char* cr, int pixel_count);
+
+// Adds the sum of absolute differences between each 16 byte segment of two rows to the matching element of sums. The
+// last segment is shorter when length isn't a multiple of 16.
+typedef void (*scdk_sad_row_16_func_t)(const unsigned char* a, const unsigned char* b, int length, uint32_t* sums);
+
+// Computes the forward DCT of an 8x8 block of samples read from rows stride bytes apart, and quantizes it by
+// multiplying with divisors and rounding, both in natural (row major) coefficient order. Returns a mask with bit i set
+// for each non-zero coefficient i.
+typedef uint64_t (*scdk_fdct_8x8_func_t)(const unsigned char* src, int stride, const float* divisors,
+                                         int16_t* coefficients);
+
+// Number of packed RGB pixel formats, matching the order of scdk_pixel_format_e
+#define SCDK_KERNELS_RGB_FORMAT_COUNT 10
+
+// Key image widths of the supported devices, which get row kernels instantiated for them: X(key_width, chroma_width)
+#define SCDK_KERNELS_KEY_WIDTHS(X) \
+	X(72, 36)                      \
+	X(80, 40)                      \
+	X(96, 48)
+
+// Row kernels for the rows of keys of one width. Functions instantiated for a width ignore their pixel count, always
+// processing key_width pixels or, for the _chroma rows, half that, so their loop counts and tails are constant. The
+// fallback set ending each table has a key_width of 0 and processes the pixel count it is given.
+typedef struct scdk_key_row_kernels_t
+{
+	int key_width;
+	scdk_reverse_row_func_t reverse_row_24;
+	scdk_reverse_row_func_t reverse_row_32;
+	scdk_reverse_row_func_t reverse_row_8;
+	scdk_reverse_row_func_t reverse_row_8_chroma;
+	scdk_reverse_row_uv_func_t reverse_row_uv_chroma;
+	const scdk_reverse_rows_yuv420_func_t* reverse_rows_yuv420;
+
+} scdk_key_row_kernels_t;
+
+typedef struct scdk_kernels_t
+{
+	const char* name;
+	scdk_reverse_row_func_t reverse_row_8;
+	scdk_reverse_row_uv_func_t reverse_row_uv;
+	scdk_reverse_row_func_t reverse_row_24;
+	scdk_reverse_row_func_t reverse_row_32;
+	const scdk_reverse_rows_yuv420_func_t* reverse_rows_yuv420;
+	scdk_sad_row_16_func_t sad_row_16;
+	scdk_fdct_8x8_func_t fdct_8x8;
+	// One set for each of SCDK_KERNELS_KEY_WIDTHS, then the fallback set
+	const scdk_key_row_kernels_t* key_row_kernels;
+
+} scdk_kernels_t;
+
+// Returns the fastest kernels supported by the running CPU
+const scdk_kernels_t* scdk_get_kernels(void);
+
+// Returns the row kernels of kernels instantiated for key_width, or the fallback set if there are none
+const scdk_key_row_kernels_t* scdk_get_key_row_kernels(const scdk_kernels_t* kernels, int key_width);
+
+// Returns the portable scalar kernels, which all SIMD variants must match exactly
+const scdk_kernels_t* scdk_get_reference_kernels(void);
+
+#endif // SCDK_KERNELS_H
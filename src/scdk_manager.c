@@ -0,0 +1,796 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <libudev.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Longest the monitor waits for a hotplug notification before enumerating anyway. Covers platforms without
+// notifications, and devices whose node was not yet accessible when their arrival was reported.
+#define SCDK_MANAGER_RESCAN_INTERVAL_MS 2000
+
+// Finds the devices attached to a manager and waits for them to change
+typedef struct scdk_manager_backend_t
+{
+	scdk_device_info_t* (*enumerate)(void* context);
+	bool (*open)(void* context, scdk_device_type_e device_type, const wchar_t* serial_number, scdk_device_t* p_device);
+
+	// Returns true if the attached devices may have changed, false on timeout or when woken
+	bool (*wait)(void* context, int timeout_ms);
+	void (*wake)(void* context);
+	void (*close)(void* context);
+
+} scdk_manager_backend_t;
+
+// State remembered for a device across disconnection, restored when it reappears. Entries are never removed while the
+// manager exists, so a pointer found under the manager mutex stays valid after releasing it.
+typedef struct scdk_manager_entry_t
+{
+	wchar_t* serial_number;
+	scdk_device_type_e device_type;
+
+	// Guards everything below, so that calls on one device never wait for another
+	scdk_mutex_t mutex;
+
+	scdk_device_t device;
+
+	unsigned char* image_buffer;
+	size_t image_buffer_length;
+	scdk_pixel_format_e pixel_format;
+	int quality_percentage;
+	bool has_image;
+
+	int brightness_percentage;
+
+	struct scdk_manager_entry_t* next;
+
+} scdk_manager_entry_t;
+
+typedef struct scdk_manager_impl_t
+{
+	const scdk_manager_backend_t* backend;
+	void* backend_context;
+
+	scdk_manager_callback_t callback;
+	void* callback_user_data;
+
+	scdk_thread_t thread;
+	scdk_mutex_t mutex;
+	scdk_manager_entry_t* entries;
+	bool is_shutdown;
+
+} scdk_manager_impl_t;
+
+static scdk_device_info_t* scdk_device_info_create(scdk_device_type_e device_type, const wchar_t* serial_number)
+{
+	scdk_device_info_t* device_info = malloc(sizeof(scdk_device_info_t));
+	if (device_info == NULL)
+		abort();
+
+	device_info->device_type = device_type;
+	device_info->serial_number = malloc((wcslen(serial_number) + 1) * sizeof(wchar_t));
+	if (device_info->serial_number == NULL)
+		abort();
+
+	wcscpy(device_info->serial_number, serial_number);
+	device_info->next = NULL;
+
+	return device_info;
+}
+
+#ifdef __linux__
+
+typedef struct scdk_manager_hid_t
+{
+	struct udev* udev;
+	struct udev_monitor* monitor;
+	int wake_fds[2];
+
+} scdk_manager_hid_t;
+
+static void* scdk_manager_hid_create(void)
+{
+	scdk_manager_hid_t* hid = malloc(sizeof(scdk_manager_hid_t));
+	if (hid == NULL)
+		abort();
+
+	hid->udev = udev_new();
+	hid->monitor = NULL;
+
+	if (hid->udev)
+	{
+		hid->monitor = udev_monitor_new_from_netlink(hid->udev, "udev");
+
+		if (hid->monitor && (udev_monitor_filter_add_match_subsystem_devtype(hid->monitor, "hidraw", NULL) < 0
+		                     || udev_monitor_enable_receiving(hid->monitor) < 0))
+		{
+			udev_monitor_unref(hid->monitor);
+			hid->monitor = NULL;
+		}
+	}
+
+	// Without a monitor the manager falls back to periodic enumeration
+	if (pipe(hid->wake_fds) != 0)
+		abort();
+
+	for (int i = 0; i < 2; ++i)
+	{
+		fcntl(hid->wake_fds[i], F_SETFL, fcntl(hid->wake_fds[i], F_GETFL) | O_NONBLOCK);
+		fcntl(hid->wake_fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	return hid;
+}
+
+static bool scdk_manager_hid_wait(void* context, int timeout_ms)
+{
+	scdk_manager_hid_t* hid = context;
+
+	struct pollfd fds[2] =
+	{
+		{ hid->wake_fds[0], POLLIN, 0 },
+		{ hid->monitor ? udev_monitor_get_fd(hid->monitor) : -1, POLLIN, 0 }
+	};
+
+	if (poll(fds, 2, timeout_ms) <= 0)
+		return false;
+
+	bool is_changed = false;
+
+	if (fds[1].revents & POLLIN)
+	{
+		struct udev_device* device;
+		while ((device = udev_monitor_receive_device(hid->monitor)) != NULL)
+		{
+			udev_device_unref(device);
+			is_changed = true;
+		}
+	}
+
+	if (fds[0].revents & POLLIN)
+	{
+		unsigned char bytes[16];
+		while (read(hid->wake_fds[0], bytes, sizeof(bytes)) > 0)
+			;
+	}
+
+	return is_changed;
+}
+
+static void scdk_manager_hid_wake(void* context)
+{
+	scdk_manager_hid_t* hid = context;
+
+	const unsigned char byte = 1;
+	while (write(hid->wake_fds[1], &byte, 1) == -1 && errno == EINTR)
+		;
+}
+
+static void scdk_manager_hid_close(void* context)
+{
+	scdk_manager_hid_t* hid = context;
+
+	if (hid->monitor)
+		udev_monitor_unref(hid->monitor);
+	if (hid->udev)
+		udev_unref(hid->udev);
+
+	close(hid->wake_fds[0]);
+	close(hid->wake_fds[1]);
+	free(hid);
+}
+
+#else
+
+// Other platforms have no hotplug notification wired up, so the monitor just rescans on an interval
+typedef struct scdk_manager_hid_t
+{
+	scdk_mutex_t mutex;
+	scdk_cond_t wake_cond;
+	bool is_woken;
+
+} scdk_manager_hid_t;
+
+static void* scdk_manager_hid_create(void)
+{
+	scdk_manager_hid_t* hid = malloc(sizeof(scdk_manager_hid_t));
+	if (hid == NULL)
+		abort();
+
+	scdk_mutex_init(&hid->mutex);
+	scdk_cond_init(&hid->wake_cond);
+	hid->is_woken = false;
+
+	return hid;
+}
+
+static bool scdk_manager_hid_wait(void* context, int timeout_ms)
+{
+	scdk_manager_hid_t* hid = context;
+
+	scdk_mutex_lock(&hid->mutex);
+
+	if (!hid->is_woken)
+		scdk_cond_timed_wait(&hid->wake_cond, &hid->mutex, timeout_ms);
+
+	hid->is_woken = false;
+
+	scdk_mutex_unlock(&hid->mutex);
+
+	return false;
+}
+
+static void scdk_manager_hid_wake(void* context)
+{
+	scdk_manager_hid_t* hid = context;
+
+	scdk_mutex_lock(&hid->mutex);
+	hid->is_woken = true;
+	scdk_cond_signal(&hid->wake_cond);
+	scdk_mutex_unlock(&hid->mutex);
+}
+
+static void scdk_manager_hid_close(void* context)
+{
+	scdk_manager_hid_t* hid = context;
+
+	scdk_cond_destroy(&hid->wake_cond);
+	scdk_mutex_destroy(&hid->mutex);
+	free(hid);
+}
+
+#endif
+
+static scdk_device_info_t* scdk_manager_hid_enumerate(void* context)
+{
+	(void)context;
+	return scdk_enumerate();
+}
+
+static bool scdk_manager_hid_open(void* context, scdk_device_type_e device_type, const wchar_t* serial_number,
+                                  scdk_device_t* p_device)
+{
+	(void)context;
+	return scdk_open(p_device, device_type, serial_number);
+}
+
+static const scdk_manager_backend_t scdk_manager_backend_hid =
+{
+	scdk_manager_hid_enumerate,
+	scdk_manager_hid_open,
+	scdk_manager_hid_wait,
+	scdk_manager_hid_wake,
+	scdk_manager_hid_close
+};
+
+typedef struct scdk_manager_mock_device_t
+{
+	wchar_t* serial_number;
+	scdk_virtual_device_config_t config;
+
+	struct scdk_manager_mock_device_t* next;
+
+} scdk_manager_mock_device_t;
+
+// Devices are attached and detached by the caller, and opened as virtual devices
+typedef struct scdk_manager_mock_t
+{
+	scdk_mutex_t mutex;
+	scdk_cond_t change_cond;
+	scdk_manager_mock_device_t* devices;
+	bool is_changed;
+	bool is_woken;
+
+} scdk_manager_mock_t;
+
+static scdk_device_info_t* scdk_manager_mock_enumerate(void* context)
+{
+	scdk_manager_mock_t* mock = context;
+	scdk_device_info_t* devices = NULL;
+
+	scdk_mutex_lock(&mock->mutex);
+
+	for (const scdk_manager_mock_device_t* d = mock->devices; d; d = d->next)
+	{
+		scdk_device_info_t* device_info = scdk_device_info_create(d->config.device_type, d->serial_number);
+		device_info->next = devices;
+		devices = device_info;
+	}
+
+	scdk_mutex_unlock(&mock->mutex);
+
+	return devices;
+}
+
+static bool scdk_manager_mock_open(void* context, scdk_device_type_e device_type, const wchar_t* serial_number,
+                                   scdk_device_t* p_device)
+{
+	scdk_manager_mock_t* mock = context;
+	bool is_found = false;
+	scdk_virtual_device_config_t config;
+
+	scdk_mutex_lock(&mock->mutex);
+
+	for (const scdk_manager_mock_device_t* d = mock->devices; d && !is_found; d = d->next)
+	{
+		if (d->config.device_type == device_type && wcscmp(d->serial_number, serial_number) == 0)
+		{
+			config = d->config;
+			is_found = true;
+		}
+	}
+
+	scdk_mutex_unlock(&mock->mutex);
+
+	// The device reports the serial number it was attached with, as a real device would
+	config.serial_number = serial_number;
+
+	return is_found && scdk_open_virtual(p_device, &config);
+}
+
+static bool scdk_manager_mock_wait(void* context, int timeout_ms)
+{
+	scdk_manager_mock_t* mock = context;
+
+	scdk_mutex_lock(&mock->mutex);
+
+	if (!mock->is_changed && !mock->is_woken)
+		scdk_cond_timed_wait(&mock->change_cond, &mock->mutex, timeout_ms);
+
+	const bool is_changed = mock->is_changed;
+	mock->is_changed = false;
+	mock->is_woken = false;
+
+	scdk_mutex_unlock(&mock->mutex);
+
+	return is_changed;
+}
+
+static void scdk_manager_mock_wake(void* context)
+{
+	scdk_manager_mock_t* mock = context;
+
+	scdk_mutex_lock(&mock->mutex);
+	mock->is_woken = true;
+	scdk_cond_signal(&mock->change_cond);
+	scdk_mutex_unlock(&mock->mutex);
+}
+
+static void scdk_manager_mock_close(void* context)
+{
+	scdk_manager_mock_t* mock = context;
+
+	while (mock->devices)
+	{
+		scdk_manager_mock_device_t* next = mock->devices->next;
+		free(mock->devices->serial_number);
+		free(mock->devices);
+		mock->devices = next;
+	}
+
+	scdk_cond_destroy(&mock->change_cond);
+	scdk_mutex_destroy(&mock->mutex);
+	free(mock);
+}
+
+static const scdk_manager_backend_t scdk_manager_backend_mock =
+{
+	scdk_manager_mock_enumerate,
+	scdk_manager_mock_open,
+	scdk_manager_mock_wait,
+	scdk_manager_mock_wake,
+	scdk_manager_mock_close
+};
+
+// Must be called with the manager mutex held
+static scdk_manager_entry_t* scdk_manager_find_entry(scdk_manager_impl_t* manager_impl, const wchar_t* serial_number)
+{
+	for (scdk_manager_entry_t* entry = manager_impl->entries; entry; entry = entry->next)
+	{
+		if (wcscmp(entry->serial_number, serial_number) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static scdk_manager_entry_t* scdk_manager_get_entry(scdk_manager_impl_t* manager_impl, const wchar_t* serial_number)
+{
+	scdk_mutex_lock(&manager_impl->mutex);
+	scdk_manager_entry_t* entry = scdk_manager_find_entry(manager_impl, serial_number);
+	scdk_mutex_unlock(&manager_impl->mutex);
+
+	return entry;
+}
+
+static void scdk_manager_notify(scdk_manager_impl_t* manager_impl, const scdk_manager_entry_t* entry,
+                                scdk_device_t device, bool is_connected)
+{
+	if (manager_impl->callback == NULL)
+		return;
+
+	const scdk_device_info_t device_info = { entry->serial_number, entry->device_type, NULL };
+	manager_impl->callback(manager_impl, &device_info, device, is_connected, manager_impl->callback_user_data);
+}
+
+static void scdk_manager_connect(scdk_manager_impl_t* manager_impl, scdk_manager_entry_t* entry)
+{
+	scdk_device_t device = NULL;
+	if (!manager_impl->backend->open(manager_impl->backend_context, entry->device_type, entry->serial_number, &device)
+	    || device == NULL)
+		return;
+
+	scdk_mutex_lock(&entry->mutex);
+
+	entry->device = device;
+
+	if (entry->brightness_percentage >= 0)
+		scdk_set_brightness(device, entry->brightness_percentage);
+
+	if (entry->has_image)
+		scdk_submit_image_async(device, entry->image_buffer, entry->pixel_format, entry->quality_percentage);
+
+	scdk_mutex_unlock(&entry->mutex);
+
+	scdk_manager_notify(manager_impl, entry, device, true);
+}
+
+static void scdk_manager_disconnect(scdk_manager_impl_t* manager_impl, scdk_manager_entry_t* entry)
+{
+	scdk_mutex_lock(&entry->mutex);
+	scdk_device_t device = entry->device;
+	entry->device = NULL;
+	scdk_mutex_unlock(&entry->mutex);
+
+	if (device == NULL)
+		return;
+
+	scdk_manager_notify(manager_impl, entry, device, false);
+	scdk_free(device);
+}
+
+// Opens devices that are attached but not open, and closes those that have gone
+static void scdk_manager_reconcile(scdk_manager_impl_t* manager_impl)
+{
+	scdk_device_info_t* devices = manager_impl->backend->enumerate(manager_impl->backend_context);
+
+	scdk_mutex_lock(&manager_impl->mutex);
+
+	for (const scdk_device_info_t* d = devices; d; d = d->next)
+	{
+		if (scdk_manager_find_entry(manager_impl, d->serial_number))
+			continue;
+
+		scdk_manager_entry_t* entry = calloc(1, sizeof(scdk_manager_entry_t));
+		if (entry == NULL)
+			abort();
+
+		entry->serial_number = malloc((wcslen(d->serial_number) + 1) * sizeof(wchar_t));
+		if (entry->serial_number == NULL)
+			abort();
+
+		wcscpy(entry->serial_number, d->serial_number);
+		entry->device_type = d->device_type;
+		entry->brightness_percentage = -1;
+		scdk_mutex_init(&entry->mutex);
+
+		entry->next = manager_impl->entries;
+		manager_impl->entries = entry;
+	}
+
+	scdk_manager_entry_t* entries = manager_impl->entries;
+
+	scdk_mutex_unlock(&manager_impl->mutex);
+
+	for (scdk_manager_entry_t* entry = entries; entry; entry = entry->next)
+	{
+		bool is_attached = false;
+
+		for (const scdk_device_info_t* d = devices; d && !is_attached; d = d->next)
+			is_attached = d->device_type == entry->device_type && wcscmp(d->serial_number, entry->serial_number) == 0;
+
+		scdk_mutex_lock(&entry->mutex);
+		const bool is_open = entry->device != NULL;
+		const bool is_failed = is_open && scdk_device_is_disconnected(entry->device);
+		scdk_mutex_unlock(&entry->mutex);
+
+		// A deck unplugged and replugged between scans is still listed, but its handle failed when it went, so it is
+		// closed and reopened
+		if ((!is_attached || is_failed) && is_open)
+			scdk_manager_disconnect(manager_impl, entry);
+
+		if (is_attached && (!is_open || is_failed))
+			scdk_manager_connect(manager_impl, entry);
+	}
+
+	scdk_free_enumeration(devices);
+}
+
+static void scdk_manager_monitor(void* arg)
+{
+	scdk_manager_impl_t* manager_impl = arg;
+	uint64_t last_scan_us = 0;
+	bool is_changed = true;
+
+	while (true)
+	{
+		scdk_mutex_lock(&manager_impl->mutex);
+		const bool is_shutdown = manager_impl->is_shutdown;
+		scdk_mutex_unlock(&manager_impl->mutex);
+
+		if (is_shutdown)
+			break;
+
+		const uint64_t now = scdk_time_now_us();
+
+		if (is_changed || now - last_scan_us >= SCDK_MANAGER_RESCAN_INTERVAL_MS * 1000)
+		{
+			scdk_manager_reconcile(manager_impl);
+			last_scan_us = now;
+		}
+
+		is_changed = manager_impl->backend->wait(manager_impl->backend_context, SCDK_MANAGER_RESCAN_INTERVAL_MS);
+	}
+}
+
+static scdk_manager_t scdk_manager_create_with_backend(const scdk_manager_backend_t* backend, void* backend_context,
+                                                       scdk_manager_callback_t callback, void* user_data)
+{
+	scdk_manager_impl_t* manager_impl = malloc(sizeof(scdk_manager_impl_t));
+	if (manager_impl == NULL)
+		abort();
+
+	manager_impl->backend = backend;
+	manager_impl->backend_context = backend_context;
+	manager_impl->callback = callback;
+	manager_impl->callback_user_data = user_data;
+	manager_impl->entries = NULL;
+	manager_impl->is_shutdown = false;
+
+	scdk_mutex_init(&manager_impl->mutex);
+
+	if (!scdk_thread_create(&manager_impl->thread, scdk_manager_monitor, manager_impl))
+	{
+		scdk_mutex_destroy(&manager_impl->mutex);
+		backend->close(backend_context);
+		free(manager_impl);
+		return NULL;
+	}
+
+	return manager_impl;
+}
+
+scdk_manager_t scdk_manager_create(scdk_manager_callback_t callback, void* user_data)
+{
+	return scdk_manager_create_with_backend(&scdk_manager_backend_hid, scdk_manager_hid_create(), callback,
+	                                        user_data);
+}
+
+scdk_manager_t scdk_manager_create_mock(scdk_manager_callback_t callback, void* user_data)
+{
+	scdk_manager_mock_t* mock = malloc(sizeof(scdk_manager_mock_t));
+	if (mock == NULL)
+		abort();
+
+	scdk_mutex_init(&mock->mutex);
+	scdk_cond_init(&mock->change_cond);
+	mock->devices = NULL;
+	mock->is_changed = false;
+	mock->is_woken = false;
+
+	return scdk_manager_create_with_backend(&scdk_manager_backend_mock, mock, callback, user_data);
+}
+
+static scdk_manager_mock_t* scdk_manager_get_mock(scdk_manager_t manager)
+{
+	scdk_manager_impl_t* manager_impl = manager;
+
+	if (manager_impl == NULL || manager_impl->backend != &scdk_manager_backend_mock)
+		return NULL;
+
+	return manager_impl->backend_context;
+}
+
+bool scdk_manager_mock_attach(scdk_manager_t manager, const wchar_t* serial_number,
+                              const scdk_virtual_device_config_t* config)
+{
+	scdk_manager_mock_t* mock = scdk_manager_get_mock(manager);
+	if (mock == NULL || serial_number == NULL || config == NULL
+	    || scdk_get_device_type_info_from_type(config->device_type) == NULL)
+		return false;
+
+	scdk_manager_mock_device_t* device = malloc(sizeof(scdk_manager_mock_device_t));
+	if (device == NULL)
+		abort();
+
+	device->serial_number = malloc((wcslen(serial_number) + 1) * sizeof(wchar_t));
+	if (device->serial_number == NULL)
+		abort();
+
+	wcscpy(device->serial_number, serial_number);
+	device->config = *config;
+	device->config.serial_number = device->serial_number;
+
+	scdk_mutex_lock(&mock->mutex);
+
+	device->next = mock->devices;
+	mock->devices = device;
+	mock->is_changed = true;
+	scdk_cond_signal(&mock->change_cond);
+
+	scdk_mutex_unlock(&mock->mutex);
+
+	return true;
+}
+
+bool scdk_manager_mock_detach(scdk_manager_t manager, const wchar_t* serial_number)
+{
+	scdk_manager_mock_t* mock = scdk_manager_get_mock(manager);
+	if (mock == NULL || serial_number == NULL)
+		return false;
+
+	scdk_manager_mock_device_t* removed = NULL;
+
+	scdk_mutex_lock(&mock->mutex);
+
+	for (scdk_manager_mock_device_t** p = &mock->devices; *p; p = &(*p)->next)
+	{
+		if (wcscmp((*p)->serial_number, serial_number) == 0)
+		{
+			removed = *p;
+			*p = removed->next;
+			mock->is_changed = true;
+			scdk_cond_signal(&mock->change_cond);
+			break;
+		}
+	}
+
+	scdk_mutex_unlock(&mock->mutex);
+
+	if (removed == NULL)
+		return false;
+
+	free(removed->serial_number);
+	free(removed);
+
+	return true;
+}
+
+void scdk_manager_free(scdk_manager_t manager)
+{
+	if (manager == NULL)
+		return;
+
+	scdk_manager_impl_t* manager_impl = manager;
+
+	scdk_mutex_lock(&manager_impl->mutex);
+	manager_impl->is_shutdown = true;
+	scdk_mutex_unlock(&manager_impl->mutex);
+
+	manager_impl->backend->wake(manager_impl->backend_context);
+	scdk_thread_join(manager_impl->thread);
+
+	while (manager_impl->entries)
+	{
+		scdk_manager_entry_t* entry = manager_impl->entries;
+		manager_impl->entries = entry->next;
+
+		scdk_free(entry->device);
+		scdk_mutex_destroy(&entry->mutex);
+		free(entry->image_buffer);
+		free(entry->serial_number);
+		free(entry);
+	}
+
+	manager_impl->backend->close(manager_impl->backend_context);
+	scdk_mutex_destroy(&manager_impl->mutex);
+	free(manager_impl);
+}
+
+scdk_device_info_t* scdk_manager_enumerate(scdk_manager_t manager)
+{
+	if (manager == NULL)
+		return NULL;
+
+	scdk_manager_impl_t* manager_impl = manager;
+	scdk_device_info_t* devices = NULL;
+
+	scdk_mutex_lock(&manager_impl->mutex);
+
+	for (const scdk_manager_entry_t* entry = manager_impl->entries; entry; entry = entry->next)
+	{
+		scdk_device_info_t* device_info = scdk_device_info_create(entry->device_type, entry->serial_number);
+		device_info->next = devices;
+		devices = device_info;
+	}
+
+	scdk_mutex_unlock(&manager_impl->mutex);
+
+	return devices;
+}
+
+bool scdk_manager_is_connected(scdk_manager_t manager, const wchar_t* serial_number)
+{
+	if (manager == NULL || serial_number == NULL)
+		return false;
+
+	scdk_manager_entry_t* entry = scdk_manager_get_entry(manager, serial_number);
+	if (entry == NULL)
+		return false;
+
+	scdk_mutex_lock(&entry->mutex);
+	const bool is_connected = entry->device != NULL;
+	scdk_mutex_unlock(&entry->mutex);
+
+	return is_connected;
+}
+
+bool scdk_manager_set_image(scdk_manager_t manager, const wchar_t* serial_number, const unsigned char* image_buffer,
+                            scdk_pixel_format_e pixel_format, int quality_percentage)
+{
+	if (manager == NULL || serial_number == NULL || image_buffer == NULL || pixel_format < SCDK_PIXEL_FORMAT_RGB
+	    || pixel_format > SCDK_PIXEL_FORMAT_NV12)
+		return false;
+
+	scdk_manager_entry_t* entry = scdk_manager_get_entry(manager, serial_number);
+	if (entry == NULL)
+		return false;
+
+	const scdk_device_type_info_t* type_info = scdk_get_device_type_info_from_type(entry->device_type);
+	const size_t image_length = scdk_image_length(type_info->image_width, type_info->image_height, pixel_format);
+
+	scdk_mutex_lock(&entry->mutex);
+
+	if (entry->image_buffer_length < image_length)
+	{
+		free(entry->image_buffer);
+		entry->image_buffer = malloc(image_length);
+		if (entry->image_buffer == NULL)
+			abort();
+
+		entry->image_buffer_length = image_length;
+	}
+
+	memcpy(entry->image_buffer, image_buffer, image_length);
+	entry->pixel_format = pixel_format;
+	entry->quality_percentage = quality_percentage;
+	entry->has_image = true;
+
+	// Sent on the device's own sender thread, so a slow device only ever delays its own frames
+	bool is_success = true;
+	if (entry->device)
+		is_success = scdk_submit_image_async(entry->device, entry->image_buffer, pixel_format, quality_percentage) != 0;
+
+	scdk_mutex_unlock(&entry->mutex);
+
+	return is_success;
+}
+
+bool scdk_manager_set_brightness(scdk_manager_t manager, const wchar_t* serial_number, int brightness_percentage)
+{
+	if (manager == NULL || serial_number == NULL)
+		return false;
+
+	scdk_manager_entry_t* entry = scdk_manager_get_entry(manager, serial_number);
+	if (entry == NULL)
+		return false;
+
+	scdk_mutex_lock(&entry->mutex);
+
+	entry->brightness_percentage = SCDK_CLAMP(brightness_percentage, 0, 100);
+
+	bool is_success = true;
+	if (entry->device)
+		is_success = scdk_set_brightness(entry->device, entry->brightness_percentage);
+
+	scdk_mutex_unlock(&entry->mutex);
+
+	return is_success;
+}
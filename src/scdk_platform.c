@@ -0,0 +1,435 @@
+#include "scdk_platform.h"
+
+#include <stdlib.h>
+
+typedef struct scdk_thread_start_t
+{
+	scdk_thread_func_t func;
+	void* arg;
+} scdk_thread_start_t;
+
+#ifdef _WIN32
+
+#include <process.h>
+
+static unsigned __stdcall scdk_thread_entry(void* arg)
+{
+	scdk_thread_start_t start = *(scdk_thread_start_t*)arg;
+	free(arg);
+
+	start.func(start.arg);
+	return 0;
+}
+
+bool scdk_thread_create(scdk_thread_t* thread, scdk_thread_func_t func, void* arg)
+{
+	scdk_thread_start_t* start = malloc(sizeof(scdk_thread_start_t));
+	if (start == NULL)
+		abort();
+
+	start->func = func;
+	start->arg = arg;
+
+	*thread = (HANDLE)_beginthreadex(NULL, 0, scdk_thread_entry, start, 0, NULL);
+	if (*thread == NULL)
+	{
+		free(start);
+		return false;
+	}
+
+	return true;
+}
+
+void scdk_thread_join(scdk_thread_t thread)
+{
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+}
+
+void scdk_mutex_init(scdk_mutex_t* mutex)
+{
+	InitializeSRWLock(mutex);
+}
+
+void scdk_mutex_destroy(scdk_mutex_t* mutex)
+{
+	(void)mutex;
+}
+
+void scdk_mutex_lock(scdk_mutex_t* mutex)
+{
+	AcquireSRWLockExclusive(mutex);
+}
+
+void scdk_mutex_unlock(scdk_mutex_t* mutex)
+{
+	ReleaseSRWLockExclusive(mutex);
+}
+
+void scdk_cond_init(scdk_cond_t* cond)
+{
+	InitializeConditionVariable(cond);
+}
+
+void scdk_cond_destroy(scdk_cond_t* cond)
+{
+	(void)cond;
+}
+
+void scdk_cond_wait(scdk_cond_t* cond, scdk_mutex_t* mutex)
+{
+	SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+}
+
+bool scdk_cond_timed_wait(scdk_cond_t* cond, scdk_mutex_t* mutex, int timeout_ms)
+{
+	return SleepConditionVariableSRW(cond, mutex, timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms, 0) != 0;
+}
+
+void scdk_cond_signal(scdk_cond_t* cond)
+{
+	WakeConditionVariable(cond);
+}
+
+void scdk_cond_broadcast(scdk_cond_t* cond)
+{
+	WakeAllConditionVariable(cond);
+}
+
+uint64_t scdk_time_now_us(void)
+{
+	return scdk_time_now_ns() / 1000;
+}
+
+uint64_t scdk_time_now_ns(void)
+{
+	static LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	QueryPerformanceCounter(&counter);
+	return (uint64_t)((counter.QuadPart / frequency.QuadPart) * 1000000000
+		+ ((counter.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart);
+}
+
+void scdk_sleep_us(uint64_t duration_us)
+{
+	Sleep((DWORD)((duration_us + 999) / 1000));
+}
+
+bool scdk_file_map(scdk_file_map_t* map, const char* path)
+{
+	map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (map->file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(map->file, &size) || size.QuadPart == 0 || (uint64_t)size.QuadPart > SIZE_MAX)
+	{
+		CloseHandle(map->file);
+		return false;
+	}
+
+	map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map->mapping == NULL)
+	{
+		CloseHandle(map->file);
+		return false;
+	}
+
+	map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+	if (map->data == NULL)
+	{
+		CloseHandle(map->mapping);
+		CloseHandle(map->file);
+		return false;
+	}
+
+	map->length = (size_t)size.QuadPart;
+	return true;
+}
+
+void scdk_file_unmap(scdk_file_map_t* map)
+{
+	UnmapViewOfFile(map->data);
+	CloseHandle(map->mapping);
+	CloseHandle(map->file);
+}
+
+bool scdk_shared_file_open(scdk_shared_file_t* file, const char* path, size_t initial_length)
+{
+	file->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+	                         OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file->file == INVALID_HANDLE_VALUE)
+		return false;
+
+	// Held while sizing so two processes creating the file at once can't each give it a different length
+	scdk_shared_file_lock(file, true);
+
+	LARGE_INTEGER size;
+	bool is_sized = GetFileSizeEx(file->file, &size);
+	if (is_sized && size.QuadPart == 0)
+	{
+		size.QuadPart = (LONGLONG)initial_length;
+		is_sized = SetFilePointerEx(file->file, size, NULL, FILE_BEGIN) && SetEndOfFile(file->file);
+	}
+
+	scdk_shared_file_unlock(file);
+
+	if (!is_sized || size.QuadPart == 0 || (uint64_t)size.QuadPart > SIZE_MAX)
+	{
+		CloseHandle(file->file);
+		return false;
+	}
+
+	file->mapping = CreateFileMappingA(file->file, NULL, PAGE_READWRITE, 0, 0, NULL);
+	if (file->mapping == NULL)
+	{
+		CloseHandle(file->file);
+		return false;
+	}
+
+	file->data = MapViewOfFile(file->mapping, FILE_MAP_WRITE, 0, 0, 0);
+	if (file->data == NULL)
+	{
+		CloseHandle(file->mapping);
+		CloseHandle(file->file);
+		return false;
+	}
+
+	file->length = (size_t)size.QuadPart;
+	return true;
+}
+
+void scdk_shared_file_close(scdk_shared_file_t* file)
+{
+	UnmapViewOfFile(file->data);
+	CloseHandle(file->mapping);
+	CloseHandle(file->file);
+}
+
+void scdk_shared_file_lock(scdk_shared_file_t* file, bool is_exclusive)
+{
+	OVERLAPPED overlapped = { 0 };
+	LockFileEx(file->file, is_exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, MAXDWORD, MAXDWORD, &overlapped);
+}
+
+void scdk_shared_file_unlock(scdk_shared_file_t* file)
+{
+	OVERLAPPED overlapped = { 0 };
+	UnlockFileEx(file->file, 0, MAXDWORD, MAXDWORD, &overlapped);
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static void* scdk_thread_entry(void* arg)
+{
+	scdk_thread_start_t start = *(scdk_thread_start_t*)arg;
+	free(arg);
+
+	start.func(start.arg);
+	return NULL;
+}
+
+bool scdk_thread_create(scdk_thread_t* thread, scdk_thread_func_t func, void* arg)
+{
+	scdk_thread_start_t* start = malloc(sizeof(scdk_thread_start_t));
+	if (start == NULL)
+		abort();
+
+	start->func = func;
+	start->arg = arg;
+
+	if (pthread_create(thread, NULL, scdk_thread_entry, start) != 0)
+	{
+		free(start);
+		return false;
+	}
+
+	return true;
+}
+
+void scdk_thread_join(scdk_thread_t thread)
+{
+	pthread_join(thread, NULL);
+}
+
+void scdk_mutex_init(scdk_mutex_t* mutex)
+{
+	pthread_mutex_init(mutex, NULL);
+}
+
+void scdk_mutex_destroy(scdk_mutex_t* mutex)
+{
+	pthread_mutex_destroy(mutex);
+}
+
+void scdk_mutex_lock(scdk_mutex_t* mutex)
+{
+	pthread_mutex_lock(mutex);
+}
+
+void scdk_mutex_unlock(scdk_mutex_t* mutex)
+{
+	pthread_mutex_unlock(mutex);
+}
+
+void scdk_cond_init(scdk_cond_t* cond)
+{
+	pthread_cond_init(cond, NULL);
+}
+
+void scdk_cond_destroy(scdk_cond_t* cond)
+{
+	pthread_cond_destroy(cond);
+}
+
+void scdk_cond_wait(scdk_cond_t* cond, scdk_mutex_t* mutex)
+{
+	pthread_cond_wait(cond, mutex);
+}
+
+bool scdk_cond_timed_wait(scdk_cond_t* cond, scdk_mutex_t* mutex, int timeout_ms)
+{
+	if (timeout_ms < 0)
+	{
+		pthread_cond_wait(cond, mutex);
+		return true;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec += 1;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	return pthread_cond_timedwait(cond, mutex, &deadline) == 0;
+}
+
+void scdk_cond_signal(scdk_cond_t* cond)
+{
+	pthread_cond_signal(cond);
+}
+
+void scdk_cond_broadcast(scdk_cond_t* cond)
+{
+	pthread_cond_broadcast(cond);
+}
+
+uint64_t scdk_time_now_us(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+uint64_t scdk_time_now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+void scdk_sleep_us(uint64_t duration_us)
+{
+	struct timespec duration = { (time_t)(duration_us / 1000000), (long)(duration_us % 1000000) * 1000 };
+	while (nanosleep(&duration, &duration) == -1 && errno == EINTR)
+		;
+}
+
+bool scdk_file_map(scdk_file_map_t* map, const char* path)
+{
+	const int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	// The mapping holds its own reference to the file, so the descriptor isn't needed once it exists
+	struct stat status;
+	void* data = MAP_FAILED;
+	if (fstat(fd, &status) == 0 && status.st_size > 0)
+		data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	map->data = data;
+	map->length = (size_t)status.st_size;
+	return true;
+}
+
+void scdk_file_unmap(scdk_file_map_t* map)
+{
+	munmap((void*)map->data, map->length);
+}
+
+bool scdk_shared_file_open(scdk_shared_file_t* file, const char* path, size_t initial_length)
+{
+	file->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (file->fd == -1)
+		return false;
+
+	// Held while sizing so two processes creating the file at once can't each give it a different length
+	scdk_shared_file_lock(file, true);
+
+	struct stat status;
+	bool is_sized = fstat(file->fd, &status) == 0;
+	if (is_sized && status.st_size == 0)
+	{
+		is_sized = ftruncate(file->fd, (off_t)initial_length) == 0;
+		status.st_size = (off_t)initial_length;
+	}
+
+	scdk_shared_file_unlock(file);
+
+	void* data = MAP_FAILED;
+	if (is_sized && status.st_size > 0)
+		data = mmap(NULL, (size_t)status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+
+	if (data == MAP_FAILED)
+	{
+		close(file->fd);
+		return false;
+	}
+
+	file->data = data;
+	file->length = (size_t)status.st_size;
+	return true;
+}
+
+void scdk_shared_file_close(scdk_shared_file_t* file)
+{
+	munmap(file->data, file->length);
+	close(file->fd);
+}
+
+void scdk_shared_file_lock(scdk_shared_file_t* file, bool is_exclusive)
+{
+	while (flock(file->fd, is_exclusive ? LOCK_EX : LOCK_SH) == -1 && errno == EINTR)
+		;
+}
+
+void scdk_shared_file_unlock(scdk_shared_file_t* file)
+{
+	flock(file->fd, LOCK_UN);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SCDK_PLATFORM_H
+#define SCDK_PLATFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+typedef HANDLE scdk_thread_t;
+typedef SRWLOCK scdk_mutex_t;
+typedef CONDITION_VARIABLE scdk_cond_t;
+#else
+#include <pthread.h>
+
+typedef pthread_t scdk_thread_t;
+typedef pthread_mutex_t scdk_mutex_t;
+typedef pthread_cond_t scdk_cond_t;
+#endif
+
+typedef void (*scdk_thread_func_t)(void* arg);
+
+// A whole file mapped read-only into memory
+typedef struct scdk_file_map_t
+{
+	const unsigned char* data;
+	size_t length;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+
+} scdk_file_map_t;
+
+// A whole file mapped read-write and shared with every other process mapping it, with an advisory lock over the file
+// for coordinating access between them
+typedef struct scdk_shared_file_t
+{
+	unsigned char* data;
+	size_t length;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+
+} scdk_shared_file_t;
+
+bool scdk_thread_create(scdk_thread_t* thread, scdk_thread_func_t func, void* arg);
+void scdk_thread_join(scdk_thread_t thread);
+
+void scdk_mutex_init(scdk_mutex_t* mutex);
+void scdk_mutex_destroy(scdk_mutex_t* mutex);
+void scdk_mutex_lock(scdk_mutex_t* mutex);
+void scdk_mutex_unlock(scdk_mutex_t* mutex);
+
+void scdk_cond_init(scdk_cond_t* cond);
+void scdk_cond_destroy(scdk_cond_t* cond);
+void scdk_cond_wait(scdk_cond_t* cond, scdk_mutex_t* mutex);
+bool scdk_cond_timed_wait(scdk_cond_t* cond, scdk_mutex_t* mutex, int timeout_ms);
+void scdk_cond_signal(scdk_cond_t* cond);
+void scdk_cond_broadcast(scdk_cond_t* cond);
+
+uint64_t scdk_time_now_us(void);
+uint64_t scdk_time_now_ns(void);
+void scdk_sleep_us(uint64_t duration_us);
+
+// Fails for empty files, which cannot be mapped
+bool scdk_file_map(scdk_file_map_t* map, const char* path);
+void scdk_file_unmap(scdk_file_map_t* map);
+
+// Opens and maps a file, first creating it initial_length bytes long if it doesn't exist or is empty. Files that
+// already have content keep their length.
+bool scdk_shared_file_open(scdk_shared_file_t* file, const char* path, size_t initial_length);
+void scdk_shared_file_close(scdk_shared_file_t* file);
+
+// Waits for the file lock. The lock only excludes other processes; threads sharing one scdk_shared_file_t must also
+// lock a mutex.
+void scdk_shared_file_lock(scdk_shared_file_t* file, bool is_exclusive);
+void scdk_shared_file_unlock(scdk_shared_file_t* file);
+
+#endif // SCDK_PLATFORM_H
@@ -0,0 +1,363 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+
+typedef enum scdk_key_job_state_e
+{
+	SCDK_KEY_JOB_STATE_PENDING = 0,
+	SCDK_KEY_JOB_STATE_UNCHANGED,
+	SCDK_KEY_JOB_STATE_WITHIN_TOLERANCE,
+	SCDK_KEY_JOB_STATE_ENCODED,
+	SCDK_KEY_JOB_STATE_FAILED
+
+} scdk_key_job_state_e;
+
+typedef struct scdk_key_job_t
+{
+	scdk_key_job_state_e state;
+	XXH64_hash_t hash;
+	unsigned char* jpeg_buffer;
+	unsigned long jpeg_length;
+	bool is_refined;
+
+	// Stage timings measured on the worker, recorded by the writer
+	uint64_t extract_ns;
+	uint64_t hash_ns;
+	uint64_t encode_ns;
+
+} scdk_key_job_t;
+
+typedef struct scdk_worker_t
+{
+	scdk_pool_t* pool;
+	scdk_thread_t thread;
+	scdk_encoder_state_t encoder_state;
+	unsigned char* key_image_src_buffer;
+
+} scdk_worker_t;
+
+struct scdk_pool_t
+{
+	scdk_device_impl_t* device_impl;
+
+	int worker_count;
+	scdk_worker_t* workers;
+
+	int key_count;
+	size_t jpeg_buffer_length;
+	scdk_key_job_t* jobs;
+
+	scdk_mutex_t mutex;
+	scdk_cond_t work_cond;
+	scdk_cond_t done_cond;
+
+	const scdk_image_view_t* image;
+	scdk_pixel_format_e pixel_format;
+	const scdk_frame_quality_t* frame_quality;
+	scdk_key_mask_t key_mask;
+	scdk_key_mask_t valid_key_hashes;
+
+	int next_key;
+	int claimed_count;
+	int completed_count;
+	bool is_shutdown;
+};
+
+static scdk_key_job_state_e scdk_pool_process_key(scdk_worker_t* worker, int key_index,
+                                                  const scdk_image_view_t* image,
+                                                  scdk_pixel_format_e pixel_format,
+                                                  const scdk_frame_quality_t* frame_quality)
+{
+	const scdk_pool_t* pool = worker->pool;
+	const scdk_device_impl_t* device_impl = pool->device_impl;
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+	scdk_key_job_t* job = pool->jobs + key_index;
+
+	const int key_x = key_index % type_info->columns;
+	const int key_y = key_index / type_info->columns;
+
+	const uint64_t hash_start_ns = scdk_time_now_ns();
+
+	job->hash = scdk_hash_key(type_info, image, pixel_format, key_x, key_y);
+
+	job->hash_ns = scdk_time_now_ns() - hash_start_ns;
+
+	job->is_refined = false;
+
+	if (scdk_is_key_unchanged(pool->valid_key_hashes, device_impl->key_image_hashes, key_index, job->hash))
+	{
+		if (!(frame_quality->refine_mask & SCDK_KEY_MASK_BIT(key_index)))
+			return SCDK_KEY_JOB_STATE_UNCHANGED;
+
+		job->is_refined = true;
+	}
+
+	const uint64_t extract_start_ns = scdk_time_now_ns();
+
+	scdk_pixel_format_e tile_pixel_format;
+	const size_t tile_length = scdk_extract_key_tile(device_impl, image, pixel_format, key_x, key_y,
+	                                                 worker->key_image_src_buffer, &tile_pixel_format);
+
+	job->extract_ns = scdk_time_now_ns() - extract_start_ns;
+
+	if (device_impl->change_tolerance)
+	{
+		if (!job->is_refined && scdk_change_tolerance_is_within(device_impl->change_tolerance, key_index,
+		                                                        worker->key_image_src_buffer, tile_pixel_format))
+			return SCDK_KEY_JOB_STATE_WITHIN_TOLERANCE;
+
+		scdk_change_tolerance_set_sent(device_impl->change_tolerance, key_index, worker->key_image_src_buffer,
+		                               tile_length, tile_pixel_format);
+	}
+
+	const uint64_t encode_start_ns = scdk_time_now_ns();
+
+	const int quality_percentage = job->is_refined ? frame_quality->refine_quality_percentage
+	                                               : frame_quality->quality_percentage;
+
+	job->jpeg_length = pool->jpeg_buffer_length;
+
+	const bool is_encoded = scdk_encode_key_cached(device_impl, &worker->encoder_state, worker->key_image_src_buffer,
+	                                               job->hash, tile_pixel_format, quality_percentage,
+	                                               job->jpeg_buffer, &job->jpeg_length);
+
+	job->encode_ns = scdk_time_now_ns() - encode_start_ns;
+
+	return is_encoded ? SCDK_KEY_JOB_STATE_ENCODED : SCDK_KEY_JOB_STATE_FAILED;
+}
+
+static void scdk_pool_worker(void* arg)
+{
+	scdk_worker_t* worker = arg;
+	scdk_pool_t* pool = worker->pool;
+
+	scdk_mutex_lock(&pool->mutex);
+
+	while (true)
+	{
+		while (pool->next_key < pool->key_count && !(pool->key_mask & SCDK_KEY_MASK_BIT(pool->next_key)))
+			++pool->next_key;
+
+		while (!pool->is_shutdown && pool->next_key >= pool->key_count)
+		{
+			scdk_cond_wait(&pool->work_cond, &pool->mutex);
+
+			while (pool->next_key < pool->key_count && !(pool->key_mask & SCDK_KEY_MASK_BIT(pool->next_key)))
+				++pool->next_key;
+		}
+
+		if (pool->is_shutdown)
+			break;
+
+		const int key_index = pool->next_key++;
+		const scdk_image_view_t* image = pool->image;
+		const scdk_pixel_format_e pixel_format = pool->pixel_format;
+		const scdk_frame_quality_t* frame_quality = pool->frame_quality;
+		++pool->claimed_count;
+
+		scdk_mutex_unlock(&pool->mutex);
+
+		const scdk_key_job_state_e state = scdk_pool_process_key(worker, key_index, image, pixel_format,
+		                                                         frame_quality);
+
+		scdk_mutex_lock(&pool->mutex);
+
+		pool->jobs[key_index].state = state;
+		++pool->completed_count;
+		scdk_cond_broadcast(&pool->done_cond);
+	}
+
+	scdk_mutex_unlock(&pool->mutex);
+}
+
+scdk_pool_t* scdk_pool_create(scdk_device_impl_t* device_impl, int thread_count)
+{
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+
+	scdk_pool_t* pool = malloc(sizeof(scdk_pool_t));
+	if (pool == NULL)
+		abort();
+
+	pool->device_impl = device_impl;
+	pool->key_count = type_info->columns * type_info->rows;
+	pool->jpeg_buffer_length = tjBufSize(type_info->key_image_width, type_info->key_image_height, TJSAMP_420);
+	pool->jobs = malloc(pool->key_count * sizeof(scdk_key_job_t));
+	if (pool->jobs == NULL)
+		abort();
+
+	for (int i = 0; i < pool->key_count; ++i)
+	{
+		pool->jobs[i].state = SCDK_KEY_JOB_STATE_PENDING;
+		pool->jobs[i].jpeg_buffer = malloc(pool->jpeg_buffer_length);
+		if (pool->jobs[i].jpeg_buffer == NULL)
+			abort();
+	}
+
+	scdk_mutex_init(&pool->mutex);
+	scdk_cond_init(&pool->work_cond);
+	scdk_cond_init(&pool->done_cond);
+
+	pool->image = NULL;
+	pool->frame_quality = NULL;
+	pool->key_mask = 0;
+	pool->next_key = pool->key_count;
+	pool->claimed_count = 0;
+	pool->completed_count = 0;
+	pool->is_shutdown = false;
+
+	pool->worker_count = 0;
+	pool->workers = malloc(thread_count * sizeof(scdk_worker_t));
+	if (pool->workers == NULL)
+		abort();
+
+	for (int i = 0; i < thread_count; ++i)
+	{
+		scdk_worker_t* worker = pool->workers + i;
+
+		worker->pool = pool;
+		worker->encoder_state.encoder = NULL;
+		worker->encoder_state.context = NULL;
+		worker->key_image_src_buffer = malloc(type_info->key_image_width * type_info->key_image_height * 4);
+		if (worker->key_image_src_buffer == NULL)
+			abort();
+
+		if (!scdk_thread_create(&worker->thread, scdk_pool_worker, worker))
+		{
+			free(worker->key_image_src_buffer);
+			scdk_pool_free(pool);
+			return NULL;
+		}
+
+		++pool->worker_count;
+	}
+
+	return pool;
+}
+
+void scdk_pool_free(scdk_pool_t* pool)
+{
+	if (pool == NULL)
+		return;
+
+	scdk_mutex_lock(&pool->mutex);
+	pool->is_shutdown = true;
+	scdk_cond_broadcast(&pool->work_cond);
+	scdk_mutex_unlock(&pool->mutex);
+
+	for (int i = 0; i < pool->worker_count; ++i)
+	{
+		scdk_thread_join(pool->workers[i].thread);
+		scdk_encoder_state_free(&pool->workers[i].encoder_state);
+		free(pool->workers[i].key_image_src_buffer);
+	}
+
+	for (int i = 0; i < pool->key_count; ++i)
+		free(pool->jobs[i].jpeg_buffer);
+
+	scdk_cond_destroy(&pool->done_cond);
+	scdk_cond_destroy(&pool->work_cond);
+	scdk_mutex_destroy(&pool->mutex);
+
+	free(pool->workers);
+	free(pool->jobs);
+	free(pool);
+}
+
+bool scdk_pool_set_image(scdk_pool_t* pool, const scdk_image_view_t* image, scdk_pixel_format_e pixel_format,
+                         const scdk_frame_quality_t* frame_quality, scdk_key_mask_t key_mask,
+                         scdk_key_mask_t* sent_mask)
+{
+	scdk_device_impl_t* device_impl = pool->device_impl;
+	bool is_success = true;
+
+	scdk_mutex_lock(&pool->mutex);
+
+	for (int i = 0; i < pool->key_count; ++i)
+		pool->jobs[i].state = key_mask & SCDK_KEY_MASK_BIT(i) ? SCDK_KEY_JOB_STATE_PENDING : SCDK_KEY_JOB_STATE_UNCHANGED;
+
+	pool->image = image;
+	pool->pixel_format = pixel_format;
+	pool->frame_quality = frame_quality;
+	pool->key_mask = key_mask;
+	pool->valid_key_hashes = device_impl->valid_key_hashes;
+	pool->next_key = 0;
+	pool->claimed_count = 0;
+	pool->completed_count = 0;
+	scdk_cond_broadcast(&pool->work_cond);
+
+	// The calling thread acts as the single writer, sending reports in key order as soon as each key is ready
+	for (int key_index = 0; key_index < pool->key_count; ++key_index)
+	{
+		scdk_key_job_t* job = pool->jobs + key_index;
+
+		while (job->state == SCDK_KEY_JOB_STATE_PENDING)
+			scdk_cond_wait(&pool->done_cond, &pool->mutex);
+
+		if (key_mask & SCDK_KEY_MASK_BIT(key_index))
+		{
+			scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_HASH, job->hash_ns);
+
+			// Unchanged keys are never extracted
+			if (job->state == SCDK_KEY_JOB_STATE_UNCHANGED)
+			{
+				++device_impl->pending_stats.keys_skipped;
+			}
+			else if (job->state == SCDK_KEY_JOB_STATE_WITHIN_TOLERANCE)
+			{
+				scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_EXTRACT, job->extract_ns);
+				++device_impl->pending_stats.keys_within_tolerance;
+			}
+			else
+			{
+				scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_EXTRACT, job->extract_ns);
+				scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_ENCODE, job->encode_ns);
+			}
+
+			if (job->state == SCDK_KEY_JOB_STATE_ENCODED)
+				++device_impl->pending_stats.keys_encoded;
+		}
+
+		if (job->state == SCDK_KEY_JOB_STATE_FAILED)
+		{
+			is_success = false;
+			break;
+		}
+
+		if (job->state == SCDK_KEY_JOB_STATE_ENCODED)
+		{
+			scdk_mutex_unlock(&pool->mutex);
+			const bool is_written = scdk_write_key(device_impl, key_index, job->jpeg_buffer, job->jpeg_length);
+			scdk_mutex_lock(&pool->mutex);
+
+			if (!is_written)
+			{
+				is_success = false;
+				break;
+			}
+
+			device_impl->key_image_hashes[key_index] = job->hash;
+			device_impl->valid_key_hashes |= SCDK_KEY_MASK_BIT(key_index);
+			*sent_mask |= SCDK_KEY_MASK_BIT(key_index);
+
+			if (job->is_refined)
+				++device_impl->pending_stats.keys_refined;
+		}
+	}
+
+	// Stop handing out keys and wait for in-flight workers, as they may still reference the caller's buffer
+	pool->next_key = pool->key_count;
+
+	while (pool->completed_count < pool->claimed_count)
+		scdk_cond_wait(&pool->done_cond, &pool->mutex);
+
+	pool->image = NULL;
+	pool->frame_quality = NULL;
+
+	scdk_mutex_unlock(&pool->mutex);
+
+	// Keys recorded as sent by workers before the frame failed may not have been
+	if (!is_success)
+		scdk_change_tolerance_invalidate(device_impl->change_tolerance, key_mask & ~*sent_mask);
+
+	return is_success;
+}
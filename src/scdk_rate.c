@@ -0,0 +1,184 @@
+#include "scdk_internal.h"
+
+#include <limits.h>
+#include <stdlib.h>
+
+// Pressure below which quality is raised again and unchanged keys may be refined
+#define SCDK_RATE_CONTROL_HEADROOM 0.8
+
+// Quality points dropped per unit of pressure over budget, and the most dropped in one frame
+#define SCDK_RATE_CONTROL_DECREASE_GAIN 20.0
+#define SCDK_RATE_CONTROL_MAX_DECREASE 20
+
+// Weight of the newest frame in the smoothed byte rate
+#define SCDK_RATE_CONTROL_SMOOTHING 0.25
+
+struct scdk_rate_control_t
+{
+	scdk_rate_control_config_t config;
+	int key_count;
+
+	// Quality changed keys are sent at; starts at the caller's quality and follows the measured pressure
+	int quality_percentage;
+	double pressure;
+
+	uint64_t last_frame_end_us;
+	double smoothed_bytes_per_second;
+
+	// Quality each key was last sent at through this controller, or INT_MAX if it wasn't sent below the caller's
+	// quality, and how many frames since it last changed
+	int* key_qualities;
+	int* key_stable_frame_counts;
+};
+
+scdk_rate_control_t* scdk_rate_control_create(const scdk_device_type_info_t* type_info,
+                                              const scdk_rate_control_config_t* config)
+{
+	scdk_rate_control_t* rate_control = malloc(sizeof(scdk_rate_control_t));
+	if (rate_control == NULL)
+		abort();
+
+	rate_control->config = *config;
+	rate_control->key_count = type_info->columns * type_info->rows;
+	rate_control->quality_percentage = -1;
+	rate_control->pressure = 0.0;
+	rate_control->last_frame_end_us = 0;
+	rate_control->smoothed_bytes_per_second = 0.0;
+	rate_control->key_qualities = malloc(rate_control->key_count * sizeof(int));
+	rate_control->key_stable_frame_counts = calloc(rate_control->key_count, sizeof(int));
+	if (rate_control->key_qualities == NULL || rate_control->key_stable_frame_counts == NULL)
+		abort();
+
+	// Keys already on the device were sent without rate control, so only need refining once it lowers their quality
+	for (int key_index = 0; key_index < rate_control->key_count; ++key_index)
+		rate_control->key_qualities[key_index] = INT_MAX;
+
+	return rate_control;
+}
+
+void scdk_rate_control_free(scdk_rate_control_t* rate_control)
+{
+	if (rate_control == NULL)
+		return;
+
+	free(rate_control->key_qualities);
+	free(rate_control->key_stable_frame_counts);
+	free(rate_control);
+}
+
+void scdk_rate_control_begin_frame(scdk_rate_control_t* rate_control, int quality_percentage,
+                                   scdk_key_mask_t key_mask, scdk_key_mask_t valid_key_hashes,
+                                   scdk_frame_quality_t* frame_quality)
+{
+	const int min_quality = SCDK_MIN(rate_control->config.min_quality_percentage, quality_percentage);
+
+	if (rate_control->quality_percentage == -1)
+		rate_control->quality_percentage = quality_percentage;
+
+	rate_control->quality_percentage = SCDK_CLAMP(rate_control->quality_percentage, min_quality, quality_percentage);
+
+	frame_quality->quality_percentage = rate_control->quality_percentage;
+	frame_quality->refine_quality_percentage = quality_percentage;
+	frame_quality->refine_mask = 0;
+
+	if (rate_control->pressure >= SCDK_RATE_CONTROL_HEADROOM)
+		return;
+
+	// Spread refinement over several frames so it never bursts the budget it is trying to respect
+	int refine_count = SCDK_MAX(1, rate_control->key_count / 8);
+
+	for (int key_index = 0; key_index < rate_control->key_count && refine_count > 0; ++key_index)
+	{
+		const scdk_key_mask_t key_bit = SCDK_KEY_MASK_BIT(key_index);
+
+		if ((key_mask & valid_key_hashes & key_bit)
+		    && rate_control->key_qualities[key_index] < quality_percentage
+		    && rate_control->key_stable_frame_counts[key_index] >= rate_control->config.refine_frame_count)
+		{
+			frame_quality->refine_mask |= key_bit;
+			--refine_count;
+		}
+	}
+}
+
+void scdk_rate_control_end_frame(scdk_rate_control_t* rate_control, const scdk_frame_quality_t* frame_quality,
+                                 scdk_key_mask_t key_mask, scdk_key_mask_t sent_mask, uint64_t frame_start_us,
+                                 uint64_t frame_end_us, uint64_t frame_bytes)
+{
+	for (int key_index = 0; key_index < rate_control->key_count; ++key_index)
+	{
+		const scdk_key_mask_t key_bit = SCDK_KEY_MASK_BIT(key_index);
+
+		if (sent_mask & key_bit)
+		{
+			const bool is_full_quality = (frame_quality->refine_mask & key_bit)
+				|| frame_quality->quality_percentage >= frame_quality->refine_quality_percentage;
+
+			rate_control->key_qualities[key_index] = is_full_quality ? INT_MAX : frame_quality->quality_percentage;
+			rate_control->key_stable_frame_counts[key_index] = 0;
+		}
+		else if ((key_mask & key_bit) && rate_control->key_stable_frame_counts[key_index] < INT_MAX)
+		{
+			++rate_control->key_stable_frame_counts[key_index];
+		}
+	}
+
+	double pressure = 0.0;
+
+	if (rate_control->config.target_frames_per_second > 0)
+		pressure = ((double)(frame_end_us - frame_start_us) * rate_control->config.target_frames_per_second) / 1e6;
+
+	// Bytes are measured against the time since the previous frame finished, which covers this frame and any idle time
+	if (rate_control->config.target_bytes_per_second > 0 && rate_control->last_frame_end_us != 0)
+	{
+		const uint64_t interval_us = SCDK_MAX(frame_end_us - rate_control->last_frame_end_us, 1);
+		const double bytes_per_second = ((double)frame_bytes * 1e6) / (double)interval_us;
+
+		rate_control->smoothed_bytes_per_second += SCDK_RATE_CONTROL_SMOOTHING
+			* (bytes_per_second - rate_control->smoothed_bytes_per_second);
+
+		pressure = SCDK_MAX(pressure, rate_control->smoothed_bytes_per_second
+			/ rate_control->config.target_bytes_per_second);
+	}
+
+	rate_control->last_frame_end_us = frame_end_us;
+	rate_control->pressure = pressure;
+
+	// Back off in proportion to the overrun, but recover a point at a time so quality doesn't oscillate
+	if (pressure > 1.0)
+	{
+		const int decrease = (int)((pressure - 1.0) * SCDK_RATE_CONTROL_DECREASE_GAIN);
+		rate_control->quality_percentage -= SCDK_CLAMP(decrease, 1, SCDK_RATE_CONTROL_MAX_DECREASE);
+	}
+	else if (pressure < SCDK_RATE_CONTROL_HEADROOM)
+	{
+		++rate_control->quality_percentage;
+	}
+
+	rate_control->quality_percentage = SCDK_CLAMP(rate_control->quality_percentage,
+	                                              SCDK_MIN(rate_control->config.min_quality_percentage,
+	                                                       frame_quality->refine_quality_percentage),
+	                                              frame_quality->refine_quality_percentage);
+}
+
+bool scdk_set_rate_control(scdk_device_t device, const scdk_rate_control_config_t* config)
+{
+	if (device == NULL)
+		return false;
+
+	if (config && (config->target_frames_per_second < 0 || config->target_bytes_per_second < 0
+	               || config->min_quality_percentage < 1 || config->min_quality_percentage > 100
+	               || config->refine_frame_count < 0))
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+
+	scdk_rate_control_free(device_impl->rate_control);
+	device_impl->rate_control = config ? scdk_rate_control_create(device_impl->type_info, config) : NULL;
+
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return true;
+}
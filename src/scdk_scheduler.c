@@ -0,0 +1,463 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The upload pending for one key. A newer upload to the key replaces it in place, so there is never more than one.
+typedef struct scdk_scheduler_slot_t
+{
+	size_t reports_length;
+	unsigned char* reports;
+	int report_count;
+	int next_report;
+	unsigned long jpeg_length;
+
+	scdk_update_priority_e priority;
+	uint64_t deadline_us;
+
+	// Ticket of the upload pending for the key, or 0 when none is, and of the last upload to the key that failed
+	uint64_t pending_ticket;
+	uint64_t failed_ticket;
+
+} scdk_scheduler_slot_t;
+
+struct scdk_scheduler_t
+{
+	scdk_device_impl_t* device_impl;
+	scdk_thread_t thread;
+
+	scdk_mutex_t mutex;
+	scdk_cond_t work_cond;
+	scdk_cond_t done_cond;
+
+	scdk_update_scheduler_config_t config;
+
+	int key_count;
+	scdk_scheduler_slot_t* slots;
+	scdk_key_mask_t pending_mask;
+	uint64_t next_ticket;
+
+	// Callers that have submitted an upload and not yet collected its result
+	int waiter_count;
+	bool is_shutdown;
+
+	// A copy of the report being written, so its slot can be replaced meanwhile
+	unsigned char report[SD_OUT_REPORT_LENGTH];
+
+	// Only touched by the scheduler thread
+	scdk_stats_t stats;
+
+	// Buffers, encoder state and stage timings of keys set with scdk_set_key_image_priority, and the keys they have
+	// replaced since image calls last checked, all guarded by the device's key_mutex
+	unsigned char* key_image_src_buffer;
+	size_t key_image_dst_buffer_length;
+	unsigned char* key_image_dst_buffer;
+	scdk_encoder_state_t encoder_state;
+	scdk_stats_t key_stats;
+	scdk_key_mask_t replaced_key_mask;
+};
+
+// Picks the pending upload to write the next report of: the most urgent class, then the earliest deadline, then the
+// oldest. Background uploads past their deadline count as normal, so a stream of normal uploads can't starve them.
+static int scdk_scheduler_next_key(const scdk_scheduler_t* scheduler, uint64_t now_us)
+{
+	int next_key_index = -1;
+	int next_priority = SCDK_UPDATE_PRIORITY_COUNT;
+	uint64_t next_deadline_us = 0;
+	uint64_t next_ticket = 0;
+
+	scdk_key_mask_t mask = scheduler->pending_mask;
+
+	while (mask)
+	{
+		const int key_index = scdk_key_mask_first(mask);
+		mask &= mask - 1;
+
+		const scdk_scheduler_slot_t* slot = scheduler->slots + key_index;
+
+		int priority = slot->priority;
+		if (priority == SCDK_UPDATE_PRIORITY_BACKGROUND && slot->deadline_us != UINT64_MAX
+		    && now_us >= slot->deadline_us)
+			priority = SCDK_UPDATE_PRIORITY_NORMAL;
+
+		if (next_key_index == -1 || priority < next_priority
+		    || (priority == next_priority && (slot->deadline_us < next_deadline_us
+		                                      || (slot->deadline_us == next_deadline_us
+		                                          && slot->pending_ticket < next_ticket))))
+		{
+			next_key_index = key_index;
+			next_priority = priority;
+			next_deadline_us = slot->deadline_us;
+			next_ticket = slot->pending_ticket;
+		}
+	}
+
+	return next_key_index;
+}
+
+static void scdk_scheduler_thread(void* arg)
+{
+	scdk_scheduler_t* scheduler = arg;
+	scdk_device_impl_t* device_impl = scheduler->device_impl;
+
+	scdk_mutex_lock(&scheduler->mutex);
+
+	while (true)
+	{
+		while (!scheduler->is_shutdown && scheduler->pending_mask == 0)
+			scdk_cond_wait(&scheduler->work_cond, &scheduler->mutex);
+
+		if (scheduler->is_shutdown)
+			break;
+
+		// Uploads are only ever preempted between reports, so an interactive key waits for at most one report
+		const int key_index = scdk_scheduler_next_key(scheduler, scdk_time_now_us());
+		scdk_scheduler_slot_t* slot = scheduler->slots + key_index;
+		const uint64_t ticket = slot->pending_ticket;
+
+		memcpy(scheduler->report, slot->reports + ((size_t)slot->next_report * SD_OUT_REPORT_LENGTH),
+		       SD_OUT_REPORT_LENGTH);
+
+		scdk_mutex_unlock(&scheduler->mutex);
+		const bool is_written = scdk_write_reports(device_impl, scheduler->report, 1, &scheduler->stats);
+		scdk_mutex_lock(&scheduler->mutex);
+
+		// An upload that replaced this one while the report was written starts again from its first report, which
+		// the device takes as the start of a new image
+		if (slot->pending_ticket != ticket)
+			continue;
+
+		if (is_written && ++slot->next_report < slot->report_count)
+			continue;
+
+		if (!is_written)
+			slot->failed_ticket = ticket;
+
+		slot->pending_ticket = 0;
+		scheduler->pending_mask &= ~SCDK_KEY_MASK_BIT(key_index);
+		scdk_cond_broadcast(&scheduler->done_cond);
+
+		scdk_mutex_lock(&device_impl->stats_mutex);
+		scdk_stats_merge(&device_impl->stats, &scheduler->stats);
+		scdk_mutex_unlock(&device_impl->stats_mutex);
+
+		memset(&scheduler->stats, 0, sizeof(scdk_stats_t));
+	}
+
+	scdk_mutex_unlock(&scheduler->mutex);
+}
+
+scdk_scheduler_t* scdk_scheduler_create(scdk_device_impl_t* device_impl, const scdk_update_scheduler_config_t* config)
+{
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+
+	scdk_scheduler_t* scheduler = calloc(1, sizeof(scdk_scheduler_t));
+	if (scheduler == NULL)
+		abort();
+
+	scheduler->device_impl = device_impl;
+	scheduler->config = *config;
+	scheduler->key_count = type_info->columns * type_info->rows;
+	scheduler->slots = calloc(scheduler->key_count, sizeof(scdk_scheduler_slot_t));
+	scheduler->next_ticket = 1;
+	scheduler->key_image_src_buffer = malloc(device_impl->key_image_src_buffer_length);
+	scheduler->key_image_dst_buffer_length = device_impl->key_image_dst_buffer_length;
+	scheduler->key_image_dst_buffer = malloc(scheduler->key_image_dst_buffer_length);
+	if (scheduler->slots == NULL || scheduler->key_image_src_buffer == NULL || scheduler->key_image_dst_buffer == NULL)
+		abort();
+
+	scdk_mutex_init(&scheduler->mutex);
+	scdk_cond_init(&scheduler->work_cond);
+	scdk_cond_init(&scheduler->done_cond);
+
+	if (!scdk_thread_create(&scheduler->thread, scdk_scheduler_thread, scheduler))
+	{
+		scdk_cond_destroy(&scheduler->done_cond);
+		scdk_cond_destroy(&scheduler->work_cond);
+		scdk_mutex_destroy(&scheduler->mutex);
+		free(scheduler->slots);
+		free(scheduler->key_image_src_buffer);
+		free(scheduler->key_image_dst_buffer);
+		free(scheduler);
+		return NULL;
+	}
+
+	return scheduler;
+}
+
+void scdk_scheduler_free(scdk_scheduler_t* scheduler)
+{
+	if (scheduler == NULL)
+		return;
+
+	scdk_mutex_lock(&scheduler->mutex);
+
+	while (scheduler->pending_mask != 0 || scheduler->waiter_count > 0)
+		scdk_cond_wait(&scheduler->done_cond, &scheduler->mutex);
+
+	scheduler->is_shutdown = true;
+	scdk_cond_broadcast(&scheduler->work_cond);
+	scdk_mutex_unlock(&scheduler->mutex);
+
+	scdk_thread_join(scheduler->thread);
+
+	scdk_cond_destroy(&scheduler->done_cond);
+	scdk_cond_destroy(&scheduler->work_cond);
+	scdk_mutex_destroy(&scheduler->mutex);
+
+	for (int key_index = 0; key_index < scheduler->key_count; ++key_index)
+		free(scheduler->slots[key_index].reports);
+
+	scdk_encoder_state_free(&scheduler->encoder_state);
+
+	free(scheduler->slots);
+	free(scheduler->key_image_src_buffer);
+	free(scheduler->key_image_dst_buffer);
+	free(scheduler);
+}
+
+// Packetizes the key into its slot, replacing any upload still pending for the key, and returns the upload's ticket.
+// A priority of -1 sends it in the class configured for image calls. The caller must collect the result with
+// scdk_scheduler_wait.
+static uint64_t scdk_scheduler_submit(scdk_scheduler_t* scheduler, int key_index, const unsigned char* jpeg_buffer,
+                                      unsigned long jpeg_length, int priority, scdk_stats_t* stats)
+{
+	scdk_scheduler_slot_t* slot = scheduler->slots + key_index;
+	const uint64_t now_us = scdk_time_now_us();
+
+	scdk_mutex_lock(&scheduler->mutex);
+
+	if (priority < 0)
+		priority = scheduler->config.image_priority;
+
+	const int deadline_ms = scheduler->config.deadline_ms[priority];
+	const uint64_t deadline_us = deadline_ms > 0 ? now_us + ((uint64_t)deadline_ms * 1000) : UINT64_MAX;
+
+	// A replaced upload may have had a caller waiting urgently for the key, so the replacement keeps the more urgent
+	// class and deadline of the two
+	if (slot->pending_ticket != 0)
+	{
+		slot->priority = SCDK_MIN(slot->priority, (scdk_update_priority_e)priority);
+		slot->deadline_us = SCDK_MIN(slot->deadline_us, deadline_us);
+	}
+	else
+	{
+		slot->priority = (scdk_update_priority_e)priority;
+		slot->deadline_us = deadline_us;
+	}
+
+	const size_t reports_length = (size_t)scdk_key_report_count(jpeg_length) * SD_OUT_REPORT_LENGTH;
+	if (reports_length > slot->reports_length)
+	{
+		free(slot->reports);
+		slot->reports_length = reports_length;
+		slot->reports = malloc(reports_length);
+		if (slot->reports == NULL)
+			abort();
+	}
+
+	const uint64_t packetize_start_ns = scdk_time_now_ns();
+
+	slot->report_count = scdk_packetize_key(key_index, jpeg_buffer, jpeg_length, slot->reports);
+	slot->next_report = 0;
+	slot->jpeg_length = jpeg_length;
+
+	scdk_stats_record_stage(stats, SCDK_STAGE_PACKETIZE, scdk_time_now_ns() - packetize_start_ns);
+
+	const uint64_t ticket = scheduler->next_ticket++;
+	slot->pending_ticket = ticket;
+	scheduler->pending_mask |= SCDK_KEY_MASK_BIT(key_index);
+	++scheduler->waiter_count;
+	scdk_cond_signal(&scheduler->work_cond);
+
+	scdk_mutex_unlock(&scheduler->mutex);
+
+	return ticket;
+}
+
+// Waits until the upload with the given ticket has been written or replaced. Returns false if it failed.
+static bool scdk_scheduler_wait(scdk_scheduler_t* scheduler, int key_index, uint64_t ticket)
+{
+	const scdk_scheduler_slot_t* slot = scheduler->slots + key_index;
+
+	scdk_mutex_lock(&scheduler->mutex);
+
+	while (slot->pending_ticket == ticket)
+		scdk_cond_wait(&scheduler->done_cond, &scheduler->mutex);
+
+	const bool is_success = slot->failed_ticket != ticket;
+
+	--scheduler->waiter_count;
+	scdk_cond_broadcast(&scheduler->done_cond);
+
+	scdk_mutex_unlock(&scheduler->mutex);
+
+	return is_success;
+}
+
+bool scdk_scheduler_write_key(scdk_scheduler_t* scheduler, int key_index, const unsigned char* jpeg_buffer,
+                              unsigned long jpeg_length, scdk_stats_t* stats)
+{
+	const uint64_t ticket = scdk_scheduler_submit(scheduler, key_index, jpeg_buffer, jpeg_length, -1, stats);
+
+	return scdk_scheduler_wait(scheduler, key_index, ticket);
+}
+
+bool scdk_scheduler_set_key_image(scdk_device_impl_t* device_impl, int key_index, const unsigned char* image_buffer,
+                                  scdk_pixel_format_e pixel_format, int quality_percentage,
+                                  scdk_update_priority_e priority, bool* is_scheduled)
+{
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+
+	scdk_mutex_lock(&device_impl->key_mutex);
+
+	scdk_scheduler_t* scheduler = device_impl->scheduler;
+	*is_scheduled = scheduler != NULL;
+
+	if (scheduler == NULL)
+	{
+		scdk_mutex_unlock(&device_impl->key_mutex);
+		return false;
+	}
+
+	scdk_stats_t* stats = &scheduler->key_stats;
+
+	const uint64_t extract_start_ns = scdk_time_now_ns();
+
+	image_buffer = scdk_prepare_key_image(type_info, image_buffer, &pixel_format, scheduler->key_image_src_buffer);
+
+	const uint64_t hash_start_ns = scdk_time_now_ns();
+	scdk_stats_record_stage(stats, SCDK_STAGE_EXTRACT, hash_start_ns - extract_start_ns);
+
+	XXH64_hash_t hash = 0;
+	if (device_impl->jpeg_cache)
+	{
+		hash = XXH3_64bits_withSeed(image_buffer, scdk_image_length(type_info->key_image_width,
+		                                                             type_info->key_image_height, pixel_format),
+		                            SCDK_KEY_IMAGE_HASH_SEED | (XXH64_hash_t)pixel_format);
+		scdk_stats_record_stage(stats, SCDK_STAGE_HASH, scdk_time_now_ns() - hash_start_ns);
+	}
+
+	unsigned long jpeg_length = scheduler->key_image_dst_buffer_length;
+
+	const uint64_t encode_start_ns = scdk_time_now_ns();
+
+	const bool is_encoded = scdk_encode_key_cached(device_impl, &scheduler->encoder_state, image_buffer, hash,
+	                                               pixel_format, quality_percentage, scheduler->key_image_dst_buffer,
+	                                               &jpeg_length);
+
+	scdk_stats_record_stage(stats, SCDK_STAGE_ENCODE, scdk_time_now_ns() - encode_start_ns);
+
+	uint64_t ticket = 0;
+	if (is_encoded)
+	{
+		++stats->keys_encoded;
+		ticket = scdk_scheduler_submit(scheduler, key_index, scheduler->key_image_dst_buffer, jpeg_length,
+		                               priority, stats);
+	}
+
+	// The key no longer shows what image calls last sent it, which they take into account before their next frame
+	scheduler->replaced_key_mask |= SCDK_KEY_MASK_BIT(key_index);
+
+	scdk_mutex_lock(&device_impl->stats_mutex);
+	scdk_stats_merge(&device_impl->stats, stats);
+	scdk_mutex_unlock(&device_impl->stats_mutex);
+
+	memset(stats, 0, sizeof(scdk_stats_t));
+
+	scdk_mutex_unlock(&device_impl->key_mutex);
+
+	if (!is_encoded)
+		return false;
+
+	if (!scdk_scheduler_wait(scheduler, key_index, ticket))
+		return false;
+
+	scdk_mutex_lock(&device_impl->stats_mutex);
+	device_impl->stats.jpeg_bytes += jpeg_length;
+	scdk_mutex_unlock(&device_impl->stats_mutex);
+
+	return true;
+}
+
+scdk_key_mask_t scdk_scheduler_take_replaced_keys(scdk_device_impl_t* device_impl)
+{
+	scdk_key_mask_t replaced_key_mask = 0;
+
+	scdk_mutex_lock(&device_impl->key_mutex);
+
+	if (device_impl->scheduler)
+	{
+		replaced_key_mask = device_impl->scheduler->replaced_key_mask;
+		device_impl->scheduler->replaced_key_mask = 0;
+	}
+
+	scdk_mutex_unlock(&device_impl->key_mutex);
+
+	return replaced_key_mask;
+}
+
+bool scdk_set_update_scheduler(scdk_device_t device, const scdk_update_scheduler_config_t* config)
+{
+	if (device == NULL)
+		return false;
+
+	if (config)
+	{
+		if (config->image_priority < 0 || config->image_priority >= SCDK_UPDATE_PRIORITY_COUNT)
+			return false;
+
+		for (int priority = 0; priority < SCDK_UPDATE_PRIORITY_COUNT; ++priority)
+		{
+			if (config->deadline_ms[priority] < 0)
+				return false;
+		}
+	}
+
+	scdk_device_impl_t* device_impl = device;
+	bool is_success = true;
+
+	// Holding image_mutex keeps image calls out while the scheduler is swapped, and key_mutex keeps out keys set with
+	// scdk_set_key_image_priority
+	scdk_mutex_lock(&device_impl->image_mutex);
+
+	if (config == NULL)
+	{
+		scdk_mutex_lock(&device_impl->key_mutex);
+
+		scdk_scheduler_t* scheduler = device_impl->scheduler;
+		const scdk_key_mask_t replaced_key_mask = scheduler ? scheduler->replaced_key_mask : 0;
+		device_impl->scheduler = NULL;
+
+		scdk_mutex_unlock(&device_impl->key_mutex);
+
+		device_impl->valid_key_hashes &= ~replaced_key_mask;
+		scdk_change_tolerance_invalidate(device_impl->change_tolerance, replaced_key_mask);
+
+		// Drains uploads already queued, so nothing else writes reports until they are done
+		scdk_scheduler_free(scheduler);
+	}
+	else if (device_impl->scheduler)
+	{
+		scdk_mutex_lock(&device_impl->scheduler->mutex);
+		device_impl->scheduler->config = *config;
+		scdk_mutex_unlock(&device_impl->scheduler->mutex);
+	}
+	else
+	{
+		scdk_scheduler_t* scheduler = scdk_scheduler_create(device_impl, config);
+
+		if (scheduler)
+		{
+			scdk_mutex_lock(&device_impl->key_mutex);
+			device_impl->scheduler = scheduler;
+			scdk_mutex_unlock(&device_impl->key_mutex);
+		}
+
+		is_success = scheduler != NULL;
+	}
+
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return is_success;
+}
@@ -0,0 +1,70 @@
+#include "scdk_internal.h"
+
+#include <string.h>
+
+void scdk_stats_merge(scdk_stats_t* stats, const scdk_stats_t* src_stats)
+{
+	stats->frames_submitted += src_stats->frames_submitted;
+	stats->keys_skipped += src_stats->keys_skipped;
+	stats->keys_within_tolerance += src_stats->keys_within_tolerance;
+	stats->keys_encoded += src_stats->keys_encoded;
+	stats->keys_refined += src_stats->keys_refined;
+	stats->jpeg_bytes += src_stats->jpeg_bytes;
+	stats->reports_written += src_stats->reports_written;
+	stats->write_failures += src_stats->write_failures;
+	stats->write_retries += src_stats->write_retries;
+
+	for (int stage = 0; stage < SCDK_STAGE_COUNT; ++stage)
+	{
+		const scdk_stage_stats_t* src = src_stats->stages + stage;
+		scdk_stage_stats_t* dst = stats->stages + stage;
+
+		// Most calls only touch a few stages, so skip the histograms of stages that did not run
+		if (src->count == 0)
+			continue;
+
+		dst->count += src->count;
+		dst->total_ns += src->total_ns;
+		dst->max_ns = SCDK_MAX(dst->max_ns, src->max_ns);
+
+		for (int bucket = 0; bucket < SCDK_STATS_HISTOGRAM_BUCKET_COUNT; ++bucket)
+			dst->histogram[bucket] += src->histogram[bucket];
+	}
+}
+
+void scdk_stats_flush(scdk_device_impl_t* device_impl)
+{
+	scdk_mutex_lock(&device_impl->stats_mutex);
+	scdk_stats_merge(&device_impl->stats, &device_impl->pending_stats);
+	scdk_mutex_unlock(&device_impl->stats_mutex);
+
+	memset(&device_impl->pending_stats, 0, sizeof(scdk_stats_t));
+}
+
+bool scdk_get_stats(scdk_device_t device, scdk_stats_t* stats)
+{
+	if (device == NULL || stats == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->stats_mutex);
+	*stats = device_impl->stats;
+	scdk_mutex_unlock(&device_impl->stats_mutex);
+
+	return true;
+}
+
+bool scdk_reset_stats(scdk_device_t device)
+{
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->stats_mutex);
+	memset(&device_impl->stats, 0, sizeof(scdk_stats_t));
+	scdk_mutex_unlock(&device_impl->stats_mutex);
+
+	return true;
+}
@@ -0,0 +1,193 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Rows in each block compared; blocks are 16 bytes wide, as summed by the sad_row_16 kernel
+#define SCDK_CHANGE_TOLERANCE_BLOCK_HEIGHT 8
+
+// Widest tile row that can be compared, in 16 byte segments
+#define SCDK_CHANGE_TOLERANCE_MAX_ROW_SEGMENTS 64
+
+struct scdk_change_tolerance_t
+{
+	scdk_change_tolerance_config_t config;
+	const scdk_device_type_info_t* type_info;
+	const scdk_kernels_t* kernels;
+
+	// The tile each key was last sent from, in the tile pixel format given by reference_formats, or no tile when the
+	// format is -1. Every key's data is only touched by whichever thread is processing that key.
+	size_t tile_buffer_length;
+	unsigned char* reference_tiles;
+	int* reference_formats;
+
+	// Frames each key has been held back as within tolerance since it was last sent
+	int* held_frame_counts;
+};
+
+scdk_change_tolerance_t* scdk_change_tolerance_create(const scdk_device_impl_t* device_impl,
+                                                      const scdk_change_tolerance_config_t* config)
+{
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+	const int key_count = type_info->columns * type_info->rows;
+
+	if (type_info->key_image_width * 4 > SCDK_CHANGE_TOLERANCE_MAX_ROW_SEGMENTS * 16)
+		return NULL;
+
+	scdk_change_tolerance_t* change_tolerance = malloc(sizeof(scdk_change_tolerance_t));
+	if (change_tolerance == NULL)
+		abort();
+
+	change_tolerance->config = *config;
+	change_tolerance->type_info = type_info;
+	change_tolerance->kernels = device_impl->kernels;
+	change_tolerance->tile_buffer_length = (size_t)type_info->key_image_width * type_info->key_image_height * 4;
+	change_tolerance->reference_tiles = malloc(change_tolerance->tile_buffer_length * key_count);
+	change_tolerance->reference_formats = malloc(key_count * sizeof(int));
+	change_tolerance->held_frame_counts = calloc(key_count, sizeof(int));
+	if (change_tolerance->reference_tiles == NULL || change_tolerance->reference_formats == NULL
+	    || change_tolerance->held_frame_counts == NULL)
+		abort();
+
+	for (int key_index = 0; key_index < key_count; ++key_index)
+		change_tolerance->reference_formats[key_index] = -1;
+
+	return change_tolerance;
+}
+
+void scdk_change_tolerance_free(scdk_change_tolerance_t* change_tolerance)
+{
+	if (change_tolerance == NULL)
+		return;
+
+	free(change_tolerance->reference_tiles);
+	free(change_tolerance->reference_formats);
+	free(change_tolerance->held_frame_counts);
+	free(change_tolerance);
+}
+
+static bool scdk_change_tolerance_is_plane_within(const scdk_change_tolerance_t* change_tolerance,
+                                                  const unsigned char* a, const unsigned char* b,
+                                                  int width, int height)
+{
+	const uint32_t threshold = (uint32_t)change_tolerance->config.block_sad_threshold;
+	const int segment_count = (width + 15) / 16;
+	uint32_t sums[SCDK_CHANGE_TOLERANCE_MAX_ROW_SEGMENTS];
+
+	for (int y = 0; y < height; y += SCDK_CHANGE_TOLERANCE_BLOCK_HEIGHT)
+	{
+		memset(sums, 0, segment_count * sizeof(uint32_t));
+
+		const int block_height = SCDK_MIN(SCDK_CHANGE_TOLERANCE_BLOCK_HEIGHT, height - y);
+		for (int row = 0; row < block_height; ++row)
+		{
+			const size_t offset = (size_t)(y + row) * width;
+			change_tolerance->kernels->sad_row_16(a + offset, b + offset, width, sums);
+		}
+
+		for (int i = 0; i < segment_count; ++i)
+		{
+			if (sums[i] > threshold)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool scdk_change_tolerance_is_within(scdk_change_tolerance_t* change_tolerance, int key_index,
+                                     const unsigned char* tile, scdk_pixel_format_e tile_pixel_format)
+{
+	const scdk_device_type_info_t* type_info = change_tolerance->type_info;
+
+	if (change_tolerance->reference_formats[key_index] != (int)tile_pixel_format)
+		return false;
+
+	const int refresh_frame_count = change_tolerance->config.refresh_frame_count;
+	if (refresh_frame_count > 0 && change_tolerance->held_frame_counts[key_index] >= refresh_frame_count)
+		return false;
+
+	const unsigned char* reference = change_tolerance->reference_tiles
+		+ (change_tolerance->tile_buffer_length * key_index);
+
+	bool is_within;
+
+	if (tile_pixel_format == SCDK_PIXEL_FORMAT_TILE_YUV420)
+	{
+		const int width = type_info->key_image_width;
+		const int height = type_info->key_image_height;
+		const size_t luma_length = (size_t)width * height;
+		const size_t chroma_length = luma_length / 4;
+
+		is_within = scdk_change_tolerance_is_plane_within(change_tolerance, tile, reference, width, height)
+			&& scdk_change_tolerance_is_plane_within(change_tolerance, tile + luma_length, reference + luma_length,
+			                                         width / 2, height / 2)
+			&& scdk_change_tolerance_is_plane_within(change_tolerance, tile + luma_length + chroma_length,
+			                                         reference + luma_length + chroma_length, width / 2, height / 2);
+	}
+	else
+	{
+		is_within = scdk_change_tolerance_is_plane_within(change_tolerance, tile, reference,
+		                                                  type_info->key_image_width * scdk_pixel_size(tile_pixel_format),
+		                                                  type_info->key_image_height);
+	}
+
+	if (is_within)
+		++change_tolerance->held_frame_counts[key_index];
+
+	return is_within;
+}
+
+void scdk_change_tolerance_set_sent(scdk_change_tolerance_t* change_tolerance, int key_index,
+                                    const unsigned char* tile, size_t tile_length,
+                                    scdk_pixel_format_e tile_pixel_format)
+{
+	memcpy(change_tolerance->reference_tiles + (change_tolerance->tile_buffer_length * key_index), tile, tile_length);
+	change_tolerance->reference_formats[key_index] = (int)tile_pixel_format;
+	change_tolerance->held_frame_counts[key_index] = 0;
+}
+
+void scdk_change_tolerance_invalidate(scdk_change_tolerance_t* change_tolerance, scdk_key_mask_t key_mask)
+{
+	if (change_tolerance == NULL)
+		return;
+
+	const int key_count = change_tolerance->type_info->columns * change_tolerance->type_info->rows;
+
+	while (key_mask)
+	{
+		const int key_index = scdk_key_mask_first(key_mask);
+		key_mask &= key_mask - 1;
+
+		if (key_index < key_count)
+			change_tolerance->reference_formats[key_index] = -1;
+	}
+}
+
+bool scdk_set_change_tolerance(scdk_device_t device, const scdk_change_tolerance_config_t* config)
+{
+	if (device == NULL)
+		return false;
+
+	if (config && (config->block_sad_threshold < 0 || config->refresh_frame_count < 0))
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+	scdk_change_tolerance_t* change_tolerance = NULL;
+
+	if (config)
+	{
+		change_tolerance = scdk_change_tolerance_create(device_impl, config);
+		if (change_tolerance == NULL)
+			return false;
+	}
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+
+	scdk_change_tolerance_free(device_impl->change_tolerance);
+	device_impl->change_tolerance = change_tolerance;
+
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return true;
+}
@@ -0,0 +1,35 @@
+#include "scdk_internal.h"
+
+static int scdk_transport_hid_write(void* context, const unsigned char* data, size_t length)
+{
+	return hid_write(context, data, length);
+}
+
+static int scdk_transport_hid_read_timeout(void* context, unsigned char* data, size_t length, int timeout_ms)
+{
+	return hid_read_timeout(context, data, length, timeout_ms);
+}
+
+static int scdk_transport_hid_send_feature_report(void* context, const unsigned char* data, size_t length)
+{
+	return hid_send_feature_report(context, data, length);
+}
+
+static int scdk_transport_hid_get_serial_number(void* context, wchar_t* serial_number, size_t serial_number_length)
+{
+	return hid_get_serial_number_string(context, serial_number, serial_number_length);
+}
+
+static void scdk_transport_hid_close(void* context)
+{
+	hid_close(context);
+}
+
+const scdk_transport_t scdk_transport_hid =
+{
+	scdk_transport_hid_write,
+	scdk_transport_hid_read_timeout,
+	scdk_transport_hid_send_feature_report,
+	scdk_transport_hid_get_serial_number,
+	scdk_transport_hid_close
+};
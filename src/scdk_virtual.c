@@ -0,0 +1,414 @@
+#include "scdk_internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#define SCDK_VIRTUAL_INPUT_QUEUE_CAPACITY 64
+
+// Long enough for a generated serial number: "VIRTUAL-" then a pointer in hex
+#define SCDK_VIRTUAL_SERIAL_NUMBER_CAPACITY 32
+
+typedef struct scdk_virtual_t
+{
+	const scdk_device_type_info_t* type_info;
+	scdk_virtual_device_config_t config;
+	wchar_t* serial_number;
+	int key_count;
+
+	scdk_mutex_t mutex;
+	scdk_cond_t input_cond;
+
+	// Per key reassembly of the JPEG split across image reports
+	unsigned char** key_jpeg_buffers;
+	size_t* key_jpeg_capacities;
+	size_t* key_jpeg_lengths;
+	int* key_next_pages;
+
+	tjhandle jpeg_handle;
+	unsigned char* key_tile_buffer;
+	unsigned char* framebuffer;
+
+	bool* key_states;
+	size_t input_report_length;
+	unsigned char* input_reports;
+	size_t input_head;
+	size_t input_count;
+
+	scdk_virtual_device_stats_t stats;
+
+} scdk_virtual_t;
+
+static void scdk_virtual_simulate_transfer(const scdk_virtual_t* virtual_device, size_t length)
+{
+	uint64_t duration_us = virtual_device->config.write_latency_us;
+
+	if (virtual_device->config.bandwidth_bytes_per_second > 0)
+		duration_us += ((uint64_t)length * 1000000) / virtual_device->config.bandwidth_bytes_per_second;
+
+	if (duration_us > 0)
+		scdk_sleep_us(duration_us);
+}
+
+// Decodes a completed key image and writes it into the framebuffer, undoing the rotation applied when it was sent
+static void scdk_virtual_decode_key(scdk_virtual_t* virtual_device, int key_index)
+{
+	const scdk_device_type_info_t* type_info = virtual_device->type_info;
+	const int key_width = type_info->key_image_width;
+	const int key_height = type_info->key_image_height;
+
+	int width, height, subsampling, colorspace;
+	if (tjDecompressHeader3(virtual_device->jpeg_handle, virtual_device->key_jpeg_buffers[key_index],
+	                        (unsigned long)virtual_device->key_jpeg_lengths[key_index],
+	                        &width, &height, &subsampling, &colorspace) != 0
+	    || width != key_width || height != key_height
+	    || tjDecompress2(virtual_device->jpeg_handle, virtual_device->key_jpeg_buffers[key_index],
+	                     (unsigned long)virtual_device->key_jpeg_lengths[key_index], virtual_device->key_tile_buffer,
+	                     key_width, 0, key_height, TJPF_RGB, 0) != 0)
+	{
+		++virtual_device->stats.decode_error_count;
+		return;
+	}
+
+	const int left = (key_index % type_info->columns) * (key_width + type_info->key_gap_width);
+	const int top = (key_index / type_info->columns) * (key_height + type_info->key_gap_height);
+
+	for (int y = 0; y < key_height; ++y)
+	{
+		const unsigned char* src = virtual_device->key_tile_buffer + (((key_height - y - 1) * key_width) * 3);
+		unsigned char* dst = virtual_device->framebuffer + ((((top + y) * type_info->image_width) + left) * 3);
+
+		for (int x = 0; x < key_width; ++x)
+			memcpy(dst + (x * 3), src + ((key_width - x - 1) * 3), 3);
+	}
+}
+
+static void scdk_virtual_receive_image_report(scdk_virtual_t* virtual_device, const unsigned char* data,
+                                              size_t length)
+{
+	const int key_index = data[2];
+	const bool is_last = data[3] != 0;
+	const size_t image_length = data[4] | (data[5] << 8);
+	const int page = data[6] | (data[7] << 8);
+
+	if (key_index >= virtual_device->key_count || image_length > length - SD_OUT_REPORT_HEADER_LENGTH)
+	{
+		++virtual_device->stats.protocol_error_count;
+		return;
+	}
+
+	// A new image always starts at page 0, abandoning any image left incomplete
+	if (page == 0)
+	{
+		virtual_device->key_jpeg_lengths[key_index] = 0;
+		virtual_device->key_next_pages[key_index] = 0;
+	}
+
+	if (page != virtual_device->key_next_pages[key_index])
+	{
+		++virtual_device->stats.protocol_error_count;
+		virtual_device->key_next_pages[key_index] = -1;
+		return;
+	}
+
+	const size_t required_capacity = virtual_device->key_jpeg_lengths[key_index] + image_length;
+	if (required_capacity > virtual_device->key_jpeg_capacities[key_index])
+	{
+		const size_t capacity = SCDK_MAX(required_capacity, virtual_device->key_jpeg_capacities[key_index] * 2);
+
+		virtual_device->key_jpeg_buffers[key_index] = realloc(virtual_device->key_jpeg_buffers[key_index], capacity);
+		if (virtual_device->key_jpeg_buffers[key_index] == NULL)
+			abort();
+
+		virtual_device->key_jpeg_capacities[key_index] = capacity;
+	}
+
+	memcpy(virtual_device->key_jpeg_buffers[key_index] + virtual_device->key_jpeg_lengths[key_index],
+	       data + SD_OUT_REPORT_HEADER_LENGTH, image_length);
+	virtual_device->key_jpeg_lengths[key_index] += image_length;
+	++virtual_device->key_next_pages[key_index];
+
+	if (!is_last)
+		return;
+
+	++virtual_device->stats.key_image_count;
+	virtual_device->stats.key_image_bytes += virtual_device->key_jpeg_lengths[key_index];
+	virtual_device->key_next_pages[key_index] = -1;
+
+	if (virtual_device->config.is_decoding_enabled)
+		scdk_virtual_decode_key(virtual_device, key_index);
+}
+
+static int scdk_virtual_write(void* context, const unsigned char* data, size_t length)
+{
+	scdk_virtual_t* virtual_device = context;
+
+	scdk_virtual_simulate_transfer(virtual_device, length);
+
+	scdk_mutex_lock(&virtual_device->mutex);
+
+	++virtual_device->stats.report_count;
+	virtual_device->stats.report_bytes += length;
+
+	if (length >= SD_OUT_REPORT_HEADER_LENGTH && data[0] == 0x02 && data[1] == 0x07)
+		scdk_virtual_receive_image_report(virtual_device, data, length);
+	else
+		++virtual_device->stats.protocol_error_count;
+
+	scdk_mutex_unlock(&virtual_device->mutex);
+
+	return (int)length;
+}
+
+static int scdk_virtual_read_timeout(void* context, unsigned char* data, size_t length, int timeout_ms)
+{
+	scdk_virtual_t* virtual_device = context;
+	const uint64_t deadline = scdk_time_now_us() + (uint64_t)SCDK_MAX(timeout_ms, 0) * 1000;
+
+	scdk_mutex_lock(&virtual_device->mutex);
+
+	while (virtual_device->input_count == 0)
+	{
+		if (timeout_ms < 0)
+		{
+			scdk_cond_wait(&virtual_device->input_cond, &virtual_device->mutex);
+			continue;
+		}
+
+		const uint64_t now = scdk_time_now_us();
+		if (now >= deadline)
+			break;
+
+		scdk_cond_timed_wait(&virtual_device->input_cond, &virtual_device->mutex, (int)((deadline - now + 999) / 1000));
+	}
+
+	int bytes = 0;
+
+	if (virtual_device->input_count > 0)
+	{
+		bytes = (int)SCDK_MIN(length, virtual_device->input_report_length);
+		memcpy(data, virtual_device->input_reports + (virtual_device->input_head * virtual_device->input_report_length),
+		       bytes);
+
+		virtual_device->input_head = (virtual_device->input_head + 1) % SCDK_VIRTUAL_INPUT_QUEUE_CAPACITY;
+		--virtual_device->input_count;
+	}
+
+	scdk_mutex_unlock(&virtual_device->mutex);
+
+	return bytes;
+}
+
+static int scdk_virtual_send_feature_report(void* context, const unsigned char* data, size_t length)
+{
+	scdk_virtual_t* virtual_device = context;
+
+	scdk_virtual_simulate_transfer(virtual_device, length);
+
+	scdk_mutex_lock(&virtual_device->mutex);
+
+	++virtual_device->stats.feature_report_count;
+
+	if (length >= 3 && data[0] == 0x03 && data[1] == 0x08)
+		virtual_device->stats.brightness_percentage = data[2];
+
+	scdk_mutex_unlock(&virtual_device->mutex);
+
+	return (int)length;
+}
+
+static int scdk_virtual_get_serial_number(void* context, wchar_t* serial_number, size_t serial_number_length)
+{
+	const scdk_virtual_t* virtual_device = context;
+
+	if (serial_number_length <= wcslen(virtual_device->serial_number))
+		return -1;
+
+	wcscpy(serial_number, virtual_device->serial_number);
+	return 0;
+}
+
+static void scdk_virtual_close(void* context)
+{
+	scdk_virtual_t* virtual_device = context;
+
+	for (int i = 0; i < virtual_device->key_count; ++i)
+		free(virtual_device->key_jpeg_buffers[i]);
+
+	tjDestroy(virtual_device->jpeg_handle);
+
+	scdk_cond_destroy(&virtual_device->input_cond);
+	scdk_mutex_destroy(&virtual_device->mutex);
+
+	free(virtual_device->key_jpeg_buffers);
+	free(virtual_device->key_jpeg_capacities);
+	free(virtual_device->key_jpeg_lengths);
+	free(virtual_device->key_next_pages);
+	free(virtual_device->key_tile_buffer);
+	free(virtual_device->framebuffer);
+	free(virtual_device->key_states);
+	free(virtual_device->input_reports);
+	free(virtual_device->serial_number);
+	free(virtual_device);
+}
+
+const scdk_transport_t scdk_transport_virtual =
+{
+	scdk_virtual_write,
+	scdk_virtual_read_timeout,
+	scdk_virtual_send_feature_report,
+	scdk_virtual_get_serial_number,
+	scdk_virtual_close
+};
+
+static scdk_virtual_t* scdk_virtual_get(scdk_device_t device)
+{
+	if (device == NULL)
+		return NULL;
+
+	const scdk_device_impl_t* device_impl = device;
+	if (device_impl->transport != &scdk_transport_virtual)
+		return NULL;
+
+	return device_impl->transport_context;
+}
+
+bool scdk_open_virtual(scdk_device_t* p_device, const scdk_virtual_device_config_t* config)
+{
+	const scdk_device_type_info_t* type_info = config ? scdk_get_device_type_info_from_type(config->device_type) : NULL;
+	if (type_info == NULL)
+	{
+		*p_device = NULL;
+		return false;
+	}
+
+	scdk_virtual_t* virtual_device = malloc(sizeof(scdk_virtual_t));
+	if (virtual_device == NULL)
+		abort();
+
+	virtual_device->type_info = type_info;
+	virtual_device->config = *config;
+	virtual_device->key_count = type_info->columns * type_info->rows;
+
+	// Generated serial numbers come from the device's address, which no other open device shares
+	if (config->serial_number)
+	{
+		virtual_device->serial_number = malloc((wcslen(config->serial_number) + 1) * sizeof(wchar_t));
+		if (virtual_device->serial_number == NULL)
+			abort();
+
+		wcscpy(virtual_device->serial_number, config->serial_number);
+	}
+	else
+	{
+		virtual_device->serial_number = malloc(SCDK_VIRTUAL_SERIAL_NUMBER_CAPACITY * sizeof(wchar_t));
+		if (virtual_device->serial_number == NULL)
+			abort();
+
+		swprintf(virtual_device->serial_number, SCDK_VIRTUAL_SERIAL_NUMBER_CAPACITY, L"VIRTUAL-%llX",
+		         (unsigned long long)(uintptr_t)virtual_device);
+	}
+
+	virtual_device->config.serial_number = virtual_device->serial_number;
+
+	scdk_mutex_init(&virtual_device->mutex);
+	scdk_cond_init(&virtual_device->input_cond);
+
+	virtual_device->key_jpeg_buffers = calloc(virtual_device->key_count, sizeof(unsigned char*));
+	virtual_device->key_jpeg_capacities = calloc(virtual_device->key_count, sizeof(size_t));
+	virtual_device->key_jpeg_lengths = calloc(virtual_device->key_count, sizeof(size_t));
+	virtual_device->key_next_pages = malloc(virtual_device->key_count * sizeof(int));
+	virtual_device->key_tile_buffer = malloc(type_info->key_image_width * type_info->key_image_height * 3);
+	virtual_device->framebuffer = calloc(type_info->image_width * type_info->image_height, 3);
+	virtual_device->key_states = calloc(virtual_device->key_count, sizeof(bool));
+	virtual_device->input_report_length = virtual_device->key_count + SD_IN_REPORT_HEADER_LENGTH;
+	virtual_device->input_reports = malloc(SCDK_VIRTUAL_INPUT_QUEUE_CAPACITY * virtual_device->input_report_length);
+	if (virtual_device->key_jpeg_buffers == NULL || virtual_device->key_jpeg_capacities == NULL
+	    || virtual_device->key_jpeg_lengths == NULL || virtual_device->key_next_pages == NULL
+	    || virtual_device->key_tile_buffer == NULL || virtual_device->framebuffer == NULL
+	    || virtual_device->key_states == NULL || virtual_device->input_reports == NULL)
+		abort();
+
+	for (int i = 0; i < virtual_device->key_count; ++i)
+		virtual_device->key_next_pages[i] = -1;
+
+	virtual_device->jpeg_handle = tjInitDecompress();
+	virtual_device->input_head = 0;
+	virtual_device->input_count = 0;
+
+	memset(&virtual_device->stats, 0, sizeof(scdk_virtual_device_stats_t));
+	virtual_device->stats.brightness_percentage = 100;
+
+	*p_device = scdk_device_create(type_info, &scdk_transport_virtual, virtual_device);
+	return true;
+}
+
+bool scdk_virtual_press_key(scdk_device_t device, int key_index, bool is_pressed)
+{
+	scdk_virtual_t* virtual_device = scdk_virtual_get(device);
+	if (virtual_device == NULL || key_index < 0 || key_index >= virtual_device->key_count)
+		return false;
+
+	scdk_mutex_lock(&virtual_device->mutex);
+
+	virtual_device->key_states[key_index] = is_pressed;
+
+	// Like the hardware, a report carrying the state of every key is sent on each change; the oldest is dropped if
+	// nobody is reading
+	if (virtual_device->input_count == SCDK_VIRTUAL_INPUT_QUEUE_CAPACITY)
+	{
+		virtual_device->input_head = (virtual_device->input_head + 1) % SCDK_VIRTUAL_INPUT_QUEUE_CAPACITY;
+		--virtual_device->input_count;
+	}
+
+	const size_t report_index = (virtual_device->input_head + virtual_device->input_count)
+		% SCDK_VIRTUAL_INPUT_QUEUE_CAPACITY;
+	unsigned char* report = virtual_device->input_reports + (report_index * virtual_device->input_report_length);
+
+	report[0] = 0x01;
+	report[1] = 0x00;
+	report[2] = virtual_device->key_count & 0xFF;
+	report[3] = virtual_device->key_count >> 8;
+
+	for (int i = 0; i < virtual_device->key_count; ++i)
+		report[SD_IN_REPORT_HEADER_LENGTH + i] = virtual_device->key_states[i] ? 1 : 0;
+
+	++virtual_device->input_count;
+	scdk_cond_signal(&virtual_device->input_cond);
+
+	scdk_mutex_unlock(&virtual_device->mutex);
+
+	return true;
+}
+
+bool scdk_virtual_get_framebuffer(scdk_device_t device, unsigned char* image_buffer, size_t image_buffer_length)
+{
+	scdk_virtual_t* virtual_device = scdk_virtual_get(device);
+	if (virtual_device == NULL || image_buffer == NULL)
+		return false;
+
+	const size_t framebuffer_length = (size_t)virtual_device->type_info->image_width
+		* virtual_device->type_info->image_height * 3;
+	if (image_buffer_length < framebuffer_length)
+		return false;
+
+	scdk_mutex_lock(&virtual_device->mutex);
+	memcpy(image_buffer, virtual_device->framebuffer, framebuffer_length);
+	scdk_mutex_unlock(&virtual_device->mutex);
+
+	return true;
+}
+
+bool scdk_virtual_get_stats(scdk_device_t device, scdk_virtual_device_stats_t* stats)
+{
+	scdk_virtual_t* virtual_device = scdk_virtual_get(device);
+	if (virtual_device == NULL || stats == NULL)
+		return false;
+
+	scdk_mutex_lock(&virtual_device->mutex);
+	*stats = virtual_device->stats;
+	scdk_mutex_unlock(&virtual_device->mutex);
+
+	return true;
+}
@@ -0,0 +1,208 @@
+#include "scdk_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// One key being written while the next is packetized
+#define SCDK_WRITER_SLOT_COUNT 2
+
+typedef struct scdk_writer_slot_t
+{
+	size_t reports_length;
+	unsigned char* reports;
+	int report_count;
+	int key_index;
+	unsigned long jpeg_length;
+
+} scdk_writer_slot_t;
+
+struct scdk_writer_t
+{
+	scdk_device_impl_t* device_impl;
+	scdk_thread_t thread;
+
+	scdk_mutex_t mutex;
+	scdk_cond_t cond;
+
+	scdk_writer_slot_t slots[SCDK_WRITER_SLOT_COUNT];
+	int next_write_slot;
+	int queued_count;
+
+	bool is_failed;
+	scdk_key_mask_t failed_mask;
+	bool is_shutdown;
+
+	// Only touched by the writer thread while keys are queued, and by the caller once the queue has drained
+	scdk_stats_t stats;
+};
+
+static void scdk_writer_thread(void* arg)
+{
+	scdk_writer_t* writer = arg;
+
+	scdk_mutex_lock(&writer->mutex);
+
+	while (true)
+	{
+		while (!writer->is_shutdown && writer->queued_count == 0)
+			scdk_cond_wait(&writer->cond, &writer->mutex);
+
+		if (writer->is_shutdown)
+			break;
+
+		const scdk_writer_slot_t* slot = writer->slots + writer->next_write_slot;
+		bool is_written = false;
+
+		// Once a write has failed the rest of the frame is abandoned, as the caller does for synchronous writes
+		if (!writer->is_failed)
+		{
+			scdk_mutex_unlock(&writer->mutex);
+			is_written = scdk_write_reports(writer->device_impl, slot->reports, slot->report_count, &writer->stats);
+			scdk_mutex_lock(&writer->mutex);
+		}
+
+		if (is_written)
+		{
+			writer->stats.jpeg_bytes += slot->jpeg_length;
+		}
+		else
+		{
+			writer->is_failed = true;
+			writer->failed_mask |= SCDK_KEY_MASK_BIT(slot->key_index);
+		}
+
+		writer->next_write_slot = (writer->next_write_slot + 1) % SCDK_WRITER_SLOT_COUNT;
+		--writer->queued_count;
+		scdk_cond_broadcast(&writer->cond);
+	}
+
+	scdk_mutex_unlock(&writer->mutex);
+}
+
+scdk_writer_t* scdk_writer_create(scdk_device_impl_t* device_impl)
+{
+	scdk_writer_t* writer = malloc(sizeof(scdk_writer_t));
+	if (writer == NULL)
+		abort();
+
+	writer->device_impl = device_impl;
+	writer->next_write_slot = 0;
+	writer->queued_count = 0;
+	writer->is_failed = false;
+	writer->failed_mask = 0;
+	writer->is_shutdown = false;
+	memset(&writer->stats, 0, sizeof(scdk_stats_t));
+
+	for (int i = 0; i < SCDK_WRITER_SLOT_COUNT; ++i)
+	{
+		writer->slots[i].reports_length = device_impl->hid_out_report_buffer_length;
+		writer->slots[i].reports = malloc(writer->slots[i].reports_length);
+		if (writer->slots[i].reports == NULL)
+			abort();
+	}
+
+	scdk_mutex_init(&writer->mutex);
+	scdk_cond_init(&writer->cond);
+
+	if (!scdk_thread_create(&writer->thread, scdk_writer_thread, writer))
+	{
+		scdk_cond_destroy(&writer->cond);
+		scdk_mutex_destroy(&writer->mutex);
+
+		for (int i = 0; i < SCDK_WRITER_SLOT_COUNT; ++i)
+			free(writer->slots[i].reports);
+
+		free(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+void scdk_writer_free(scdk_writer_t* writer)
+{
+	if (writer == NULL)
+		return;
+
+	scdk_mutex_lock(&writer->mutex);
+	writer->is_shutdown = true;
+	scdk_cond_broadcast(&writer->cond);
+	scdk_mutex_unlock(&writer->mutex);
+
+	scdk_thread_join(writer->thread);
+
+	scdk_cond_destroy(&writer->cond);
+	scdk_mutex_destroy(&writer->mutex);
+
+	for (int i = 0; i < SCDK_WRITER_SLOT_COUNT; ++i)
+		free(writer->slots[i].reports);
+
+	free(writer);
+}
+
+bool scdk_writer_submit(scdk_writer_t* writer, int key_index, const unsigned char* jpeg_buffer,
+                        unsigned long jpeg_length)
+{
+	scdk_device_impl_t* device_impl = writer->device_impl;
+
+	scdk_mutex_lock(&writer->mutex);
+
+	while (!writer->is_failed && writer->queued_count == SCDK_WRITER_SLOT_COUNT)
+		scdk_cond_wait(&writer->cond, &writer->mutex);
+
+	const bool is_failed = writer->is_failed;
+	scdk_writer_slot_t* slot = writer->slots
+		+ ((writer->next_write_slot + writer->queued_count) % SCDK_WRITER_SLOT_COUNT);
+
+	scdk_mutex_unlock(&writer->mutex);
+
+	if (is_failed)
+		return false;
+
+	// The free slot belongs to the caller until it is queued, so it is filled without holding the mutex
+	const size_t reports_length = (size_t)scdk_key_report_count(jpeg_length) * SD_OUT_REPORT_LENGTH;
+	if (reports_length > slot->reports_length)
+	{
+		free(slot->reports);
+		slot->reports_length = reports_length;
+		slot->reports = malloc(reports_length);
+		if (slot->reports == NULL)
+			abort();
+	}
+
+	const uint64_t packetize_start_ns = scdk_time_now_ns();
+
+	slot->report_count = scdk_packetize_key(key_index, jpeg_buffer, jpeg_length, slot->reports);
+	slot->key_index = key_index;
+	slot->jpeg_length = jpeg_length;
+
+	scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_PACKETIZE, scdk_time_now_ns() - packetize_start_ns);
+
+	scdk_mutex_lock(&writer->mutex);
+	++writer->queued_count;
+	scdk_cond_broadcast(&writer->cond);
+	scdk_mutex_unlock(&writer->mutex);
+
+	return true;
+}
+
+bool scdk_writer_flush(scdk_writer_t* writer, scdk_key_mask_t* failed_mask)
+{
+	scdk_mutex_lock(&writer->mutex);
+
+	while (writer->queued_count > 0)
+		scdk_cond_wait(&writer->cond, &writer->mutex);
+
+	const bool is_success = !writer->is_failed;
+	*failed_mask = writer->failed_mask;
+
+	writer->is_failed = false;
+	writer->failed_mask = 0;
+
+	scdk_mutex_unlock(&writer->mutex);
+
+	scdk_stats_merge(&writer->device_impl->pending_stats, &writer->stats);
+	memset(&writer->stats, 0, sizeof(scdk_stats_t));
+
+	return is_success;
+}
@@ -1,22 +1,7 @@
-#include "screamdeck.h"
+#include "scdk_internal.h"
 
 #include <stdlib.h>
 #include <string.h>
-#include <hidapi/hidapi.h>
-#include <turbojpeg.h>
-#include <xxhash.h>
-
-#define SD_VENDOR_ID 0x0fd9
-
-#define SCDK_MAX(a, b) a > b ? a : b
-#define SCDK_MIN(a, b) a < b ? a : b
-#define SCDK_CLAMP(x, lo, hi) SCDK_MIN(hi, (SCDK_MAX(lo, x)))
-
-#define SD_OUT_FEATURE_REPORT_LENGTH 32
-#define SD_OUT_REPORT_LENGTH 1024
-#define SD_OUT_REPORT_HEADER_LENGTH 8
-#define SD_OUT_REPORT_IMAGE_LENGTH (SD_OUT_REPORT_LENGTH - SD_OUT_REPORT_HEADER_LENGTH)
-#define SD_IN_REPORT_HEADER_LENGTH 4
 
 #define SDCK_INFO(name, type, columns, rows, key_width, key_height, key_gap_width, key_gap_height) static const scdk_device_type_info_t name =\
 {                                                                                                                                             \
@@ -27,13 +12,9 @@ key_gap_width, key_gap_height,
 (key_width * columns) + (key_gap_width * (columns - 1)), (key_height * rows) + (key_gap_height * (rows - 1))                                  \
 }
 
-SDCK_INFO(SCDK_DEVICE_TYPE_INFO_MINI, SCDK_DEVICE_TYPE_MINI, 3, 2, 80, 80, 38, 38);
-SDCK_INFO(SCDK_DEVICE_TYPE_INFO_MINI_MK2, SCDK_DEVICE_TYPE_MINI_MK2, 3, 2, 80, 80, 38, 38);
-SDCK_INFO(SCDK_DEVICE_TYPE_INFO_ORIGINAL, SCDK_DEVICE_TYPE_ORIGINAL, 5, 3, 72, 72, 38, 38);
-SDCK_INFO(SCDK_DEVICE_TYPE_INFO_ORIGINAL_MK2, SCDK_DEVICE_TYPE_ORIGINAL_MK2, 5, 3, 72, 72, 38, 38);
-SDCK_INFO(SCDK_DEVICE_TYPE_INFO_MK2, SCDK_DEVICE_TYPE_MK2, 5, 3, 72, 72, 38, 38);
-SDCK_INFO(SCDK_DEVICE_TYPE_INFO_XL, SCDK_DEVICE_TYPE_XL, 8, 4, 96, 96, 38, 38);
-SDCK_INFO(SCDK_DEVICE_TYPE_INFO_XL_MK2, SCDK_DEVICE_TYPE_XL_MK2, 8, 4, 96, 96, 38, 38);
+#define SDCK_DEVICE_TYPE_INFO(name, ...) SDCK_INFO(SCDK_DEVICE_TYPE_INFO_##name, SCDK_DEVICE_TYPE_##name, __VA_ARGS__);
+
+SCDK_DEVICE_TYPES(SDCK_DEVICE_TYPE_INFO)
 
 const scdk_device_type_info_t* scdk_get_device_type_info_from_type(scdk_device_type_e device_type)
 {
@@ -60,24 +41,6 @@ const scdk_device_type_info_t* scdk_get_device_type_info_from_type(scdk_device_t
 }
 
 
-typedef struct scdk_device_impl_t
-{
-	hid_device* device;
-	const scdk_device_type_info_t* type_info;
-	tjhandle jpeg_handle;
-
-	size_t key_image_src_buffer_length;
-	unsigned char* key_image_src_buffer;
-	size_t key_image_dst_buffer_length;
-	unsigned char* key_image_dst_buffer;
-	unsigned char* hid_out_feature_report_buffer;
-	unsigned char* hid_out_report_buffer;
-	size_t hid_in_report_buffer_length;
-	unsigned char* hid_in_report_buffer;
-
-	XXH64_hash_t* key_image_hashes;
-} scdk_device_impl_t;
-
 scdk_device_info_t* scdk_enumerate(void)
 {
 	struct hid_device_info* hid_devices = hid_enumerate(SD_VENDOR_ID, 0);
@@ -152,35 +115,73 @@ bool scdk_open(scdk_device_t* p_device, scdk_device_type_e device_type, const wc
 	const scdk_device_type_info_t* type_info = scdk_get_device_type_info_from_type(info->product_id);
 	if (!type_info)
 	{
+		hid_close(hid_d);
 		*p_device = NULL;
 		return false;
 	}
 
+	*p_device = scdk_device_create(type_info, &scdk_transport_hid, hid_d);
+	return true;
+}
+
+scdk_device_impl_t* scdk_device_create(const scdk_device_type_info_t* type_info, const scdk_transport_t* transport,
+                                       void* transport_context)
+{
 	scdk_device_impl_t* device_impl = malloc(sizeof(scdk_device_impl_t));
 	if (device_impl == NULL)
 		abort();
 
-	device_impl->device = hid_d;
+	device_impl->transport = transport;
+	device_impl->transport_context = transport_context;
 	device_impl->type_info = type_info;
-	device_impl->jpeg_handle = tjInitCompress();
-	device_impl->key_image_src_buffer_length = device_impl->type_info->image_width * device_impl->type_info->image_height * 4;
+	device_impl->kernels = scdk_get_kernels();
+	device_impl->key_row_kernels = scdk_get_key_row_kernels(device_impl->kernels, type_info->key_image_width);
+	device_impl->extractors = scdk_get_extractors(type_info);
+	device_impl->encoder = &scdk_encoder_turbojpeg;
+	device_impl->encoder_state.encoder = NULL;
+	device_impl->encoder_state.context = NULL;
+	device_impl->key_image_src_buffer_length = device_impl->type_info->key_image_width * device_impl->type_info->key_image_height * 4;
 	device_impl->key_image_src_buffer = malloc(device_impl->key_image_src_buffer_length);
 	device_impl->key_image_dst_buffer_length = tjBufSize(device_impl->type_info->key_image_width, device_impl->type_info->key_image_height, TJSAMP_420);
 	device_impl->key_image_dst_buffer = malloc(device_impl->key_image_dst_buffer_length);
 	device_impl->hid_out_feature_report_buffer = malloc(SD_OUT_FEATURE_REPORT_LENGTH);
-	device_impl->hid_out_report_buffer = malloc(SD_OUT_REPORT_LENGTH);
+	device_impl->hid_out_report_buffer_length = (size_t)scdk_key_report_count(device_impl->key_image_dst_buffer_length) * SD_OUT_REPORT_LENGTH;
+	device_impl->hid_out_report_buffer = malloc(device_impl->hid_out_report_buffer_length);
 	device_impl->hid_in_report_buffer_length = (device_impl->type_info->rows * device_impl->type_info->columns) + SD_IN_REPORT_HEADER_LENGTH;
 	device_impl->hid_in_report_buffer = malloc(device_impl->hid_in_report_buffer_length);
 	device_impl->key_image_hashes = malloc(device_impl->type_info->columns * device_impl->type_info->rows * sizeof(XXH64_hash_t));
-
-	*p_device = device_impl;
-	return true;
+	device_impl->valid_key_hashes = 0;
+	device_impl->jpeg_cache = NULL;
+	device_impl->jpeg_decompress_handle = NULL;
+	device_impl->is_jpeg_validation_enabled = false;
+	device_impl->is_planar_encoding_enabled = false;
+	device_impl->pool = NULL;
+	device_impl->writer = NULL;
+	device_impl->async = NULL;
+	device_impl->input = NULL;
+	memset(&device_impl->input_config, 0, sizeof(scdk_input_config_t));
+	device_impl->rate_control = NULL;
+	device_impl->change_tolerance = NULL;
+	device_impl->scheduler = NULL;
+	memset(&device_impl->pending_stats, 0, sizeof(scdk_stats_t));
+	memset(&device_impl->stats, 0, sizeof(scdk_stats_t));
+	device_impl->is_disconnected = false;
+
+	scdk_mutex_init(&device_impl->image_mutex);
+	scdk_mutex_init(&device_impl->key_mutex);
+	scdk_mutex_init(&device_impl->feature_mutex);
+	scdk_mutex_init(&device_impl->read_mutex);
+	scdk_mutex_init(&device_impl->lifecycle_mutex);
+	scdk_mutex_init(&device_impl->stats_mutex);
+
+	return device_impl;
 }
 
 bool scdk_open_first(scdk_device_t* p_device, scdk_device_type_e device_type)
 {
 	bool is_success = false;
-	scdk_device_info_t* device_info = scdk_enumerate();
+	scdk_device_info_t* devices = scdk_enumerate();
+	scdk_device_info_t* device_info = devices;
 	while(device_info)
 	{
 		if (device_type == SCDK_DEVICE_TYPE_NONE || device_type == device_info->device_type)
@@ -193,7 +194,7 @@ bool scdk_open_first(scdk_device_t* p_device, scdk_device_type_e device_type)
 		device_info = device_info->next;
 	}
 
-	scdk_free_enumeration(device_info);
+	scdk_free_enumeration(devices);
 	return is_success;
 }
 
@@ -204,9 +205,20 @@ void scdk_free(scdk_device_t device)
 
 	scdk_device_impl_t* device_impl = device;
 
-	hid_close(device_impl->device);
+	scdk_input_free(device_impl->input);
+	scdk_async_free(device_impl->async);
+	scdk_pool_free(device_impl->pool);
+	scdk_writer_free(device_impl->writer);
+	scdk_scheduler_free(device_impl->scheduler);
+	scdk_jpeg_cache_free(device_impl->jpeg_cache);
+	scdk_rate_control_free(device_impl->rate_control);
+	scdk_change_tolerance_free(device_impl->change_tolerance);
 
-	tjDestroy(device_impl->jpeg_handle);
+	device_impl->transport->close(device_impl->transport_context);
+
+	scdk_encoder_state_free(&device_impl->encoder_state);
+	if (device_impl->jpeg_decompress_handle)
+		tjDestroy(device_impl->jpeg_decompress_handle);
 
 	free(device_impl->key_image_src_buffer);
 	free(device_impl->key_image_dst_buffer);
@@ -215,6 +227,13 @@ void scdk_free(scdk_device_t device)
 	free(device_impl->hid_in_report_buffer);
 	free(device_impl->key_image_hashes);
 
+	scdk_mutex_destroy(&device_impl->image_mutex);
+	scdk_mutex_destroy(&device_impl->key_mutex);
+	scdk_mutex_destroy(&device_impl->feature_mutex);
+	scdk_mutex_destroy(&device_impl->read_mutex);
+	scdk_mutex_destroy(&device_impl->lifecycle_mutex);
+	scdk_mutex_destroy(&device_impl->stats_mutex);
+
 	free(device_impl);
 }
 
@@ -226,184 +245,511 @@ const scdk_device_type_info_t* scdk_get_device_type_info(scdk_device_t device)
 
 bool scdk_get_serial_number(scdk_device_t device, wchar_t* serial_number, size_t serial_number_length)
 {
-	const scdk_device_impl_t* device_impl = device;
-	return hid_get_serial_number_string(device_impl->device, serial_number, serial_number_length) == 0;
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->feature_mutex);
+	const int result = device_impl->transport->get_serial_number(device_impl->transport_context, serial_number,
+	                                                             serial_number_length);
+	scdk_mutex_unlock(&device_impl->feature_mutex);
+
+	return result == 0;
 }
 
-int scdk_read_key(scdk_device_t device, bool* key_state_buffer, size_t key_state_buffer_length)
+static int scdk_read_key_report(scdk_device_impl_t* device_impl, bool* key_state_buffer,
+                                size_t key_state_buffer_length, int timeout_ms)
 {
-	const scdk_device_impl_t* device_impl = device;
+	scdk_mutex_lock(&device_impl->read_mutex);
 
-	const int bytes = hid_read(device_impl->device, device_impl->hid_in_report_buffer,
-	                                   device_impl->hid_in_report_buffer_length);
-	if (bytes == -1)
-		return -1;
+	// The input thread owns reading while it runs
+	scdk_mutex_lock(&device_impl->lifecycle_mutex);
+	const bool is_input_running = device_impl->input != NULL && scdk_input_is_running(device_impl->input);
+	scdk_mutex_unlock(&device_impl->lifecycle_mutex);
 
-	for (int i = SD_IN_REPORT_HEADER_LENGTH; i < bytes && i - SD_IN_REPORT_HEADER_LENGTH < (int)key_state_buffer_length; ++i)
-		key_state_buffer[i - SD_IN_REPORT_HEADER_LENGTH] = device_impl->hid_in_report_buffer[i] > 0;
+	int bytes = -1;
 
-	return bytes;
-}
+	if (!is_input_running)
+	{
+		bytes = device_impl->transport->read_timeout(device_impl->transport_context, device_impl->hid_in_report_buffer,
+		                                             device_impl->hid_in_report_buffer_length, timeout_ms);
 
-int scdk_read_key_timeout(scdk_device_t device, bool* key_state_buffer, size_t key_state_buffer_length, int timeout_ms)
-{
-	const scdk_device_impl_t* device_impl = device;
+		if (bytes == -1)
+			scdk_device_set_disconnected(device_impl);
 
-	const int bytes = hid_read_timeout(device_impl->device, device_impl->hid_in_report_buffer,
-	                                   device_impl->hid_in_report_buffer_length, timeout_ms);
-	if (bytes == -1)
-		return -1;
+		for (int i = SD_IN_REPORT_HEADER_LENGTH; i < bytes && i - SD_IN_REPORT_HEADER_LENGTH < (int)key_state_buffer_length; ++i)
+			key_state_buffer[i - SD_IN_REPORT_HEADER_LENGTH] = device_impl->hid_in_report_buffer[i] > 0;
+	}
 
-	for (int i = SD_IN_REPORT_HEADER_LENGTH; i < bytes && i - SD_IN_REPORT_HEADER_LENGTH < (int)key_state_buffer_length; ++i)
-		key_state_buffer[i - SD_IN_REPORT_HEADER_LENGTH] = device_impl->hid_in_report_buffer[i] > 0;
+	scdk_mutex_unlock(&device_impl->read_mutex);
 
 	return bytes;
 }
 
+int scdk_read_key(scdk_device_t device, bool* key_state_buffer, size_t key_state_buffer_length)
+{
+	return scdk_read_key_report(device, key_state_buffer, key_state_buffer_length, -1);
+}
+
+int scdk_read_key_timeout(scdk_device_t device, bool* key_state_buffer, size_t key_state_buffer_length, int timeout_ms)
+{
+	return scdk_read_key_report(device, key_state_buffer, key_state_buffer_length, timeout_ms);
+}
+
 bool scdk_set_image(scdk_device_t device, const unsigned char* image_buffer,
                     scdk_pixel_format_e pixel_format, int quality_percentage)
 {
 	if (pixel_format == SCDK_PIXEL_FORMAT_RGB || pixel_format == SCDK_PIXEL_FORMAT_BGR)
 		return scdk_set_image_24(device, image_buffer, pixel_format, quality_percentage);
+	else if (pixel_format == SCDK_PIXEL_FORMAT_I420 || pixel_format == SCDK_PIXEL_FORMAT_NV12)
+		return scdk_set_image_yuv(device, image_buffer, pixel_format, quality_percentage);
 	else
 		return scdk_set_image_32(device, image_buffer, pixel_format, quality_percentage);
 }
 
-bool scdk_set_image_24(scdk_device_t device, const unsigned char* image_buffer,
-                       scdk_pixel_format_e pixel_format, int quality_percentage)
+int scdk_pixel_size(scdk_pixel_format_e pixel_format)
 {
-	if (device == NULL || (pixel_format != SCDK_PIXEL_FORMAT_RGB && pixel_format != SCDK_PIXEL_FORMAT_BGR))
-		return false;
+	return pixel_format == SCDK_PIXEL_FORMAT_RGB || pixel_format == SCDK_PIXEL_FORMAT_BGR ? 3 : 4;
+}
 
-	const scdk_device_impl_t* device_impl = device;
-	const scdk_device_type_info_t* type_info = device_impl->type_info;
-	const int key_image_line_length = device_impl->type_info->key_image_width * 3;
+size_t scdk_image_length(int width, int height, scdk_pixel_format_e pixel_format)
+{
+	if (scdk_is_yuv_pixel_format(pixel_format))
+		return ((size_t)width * height) + ((size_t)2 * ((width + 1) / 2) * ((height + 1) / 2));
+
+	return (size_t)width * height * scdk_pixel_size(pixel_format);
+}
 
+XXH64_hash_t scdk_hash_key(const scdk_device_type_info_t* type_info, const scdk_image_view_t* image,
+                           scdk_pixel_format_e pixel_format, int key_x, int key_y)
+{
+	const int top = image->top + (key_y * (type_info->key_image_height + type_info->key_gap_height));
+	const int left = image->left + (key_x * (type_info->key_image_width + type_info->key_gap_width));
 
-	for (int key_x = 0; key_x < type_info->columns; ++key_x)
+	// Seeded with the pixel format, so keys with the same bytes in different formats never share a cached JPEG
+	XXH3_state_t state;
+	XXH3_64bits_reset_withSeed(&state, (XXH64_hash_t)pixel_format);
+
+	if (pixel_format == SCDK_PIXEL_FORMAT_I420 || pixel_format == SCDK_PIXEL_FORMAT_NV12)
 	{
-		for (int key_y = 0; key_y < type_info->rows; ++key_y)
+		const unsigned char* y_src = image->buffer + ((size_t)top * image->width) + left;
+
+		for (int y = 0; y < type_info->key_image_height; ++y)
+			XXH3_64bits_update(&state, y_src + ((size_t)y * image->width), type_info->key_image_width);
+
+		const unsigned char* chroma_src = image->buffer + ((size_t)image->width * image->height);
+		const int chroma_image_width = image->width / 2;
+		const int chroma_key_height = type_info->key_image_height / 2;
+
+		if (pixel_format == SCDK_PIXEL_FORMAT_NV12)
 		{
-			for (int y = 0; y < type_info->key_image_height; ++y)
-			{
-				const int line = ((key_y * (type_info->key_image_height + type_info->key_gap_height)) + type_info->key_image_height) - y;
-				const int row = (key_x * (type_info->key_image_width + type_info->key_gap_width)) * 3;
+			const unsigned char* uv_src = chroma_src + ((size_t)(top / 2) * image->width) + left;
 
-				const int offset = (line * (type_info->image_width * 3))
-					+ row
-					+ key_image_line_length
-					- 1;
+			for (int y = 0; y < chroma_key_height; ++y)
+				XXH3_64bits_update(&state, uv_src + ((size_t)y * image->width), type_info->key_image_width);
+		}
+		else
+		{
+			const unsigned char* cb_src = chroma_src + ((size_t)(top / 2) * chroma_image_width) + (left / 2);
+			const unsigned char* cr_src = cb_src + ((size_t)chroma_image_width * (image->height / 2));
 
-				const unsigned char* src = image_buffer + offset;
-				unsigned char* dst = device_impl->key_image_src_buffer + (y * key_image_line_length);
+			for (int y = 0; y < chroma_key_height; ++y)
+				XXH3_64bits_update(&state, cb_src + ((size_t)y * chroma_image_width), type_info->key_image_width / 2);
 
-				unsigned char r, g, b;
+			for (int y = 0; y < chroma_key_height; ++y)
+				XXH3_64bits_update(&state, cr_src + ((size_t)y * chroma_image_width), type_info->key_image_width / 2);
+		}
+	}
+	else
+	{
+		const int pixel_size = scdk_pixel_size(pixel_format);
+		const size_t image_line_length = (size_t)image->width * pixel_size;
+		const unsigned char* src = image->buffer + ((size_t)top * image_line_length) + ((size_t)left * pixel_size);
 
-				for (size_t i = 0; i < key_image_line_length; i += 3)
-				{
-					b = *src--;
-					g = *src--;
-					r = *src--;
+		for (int y = 0; y < type_info->key_image_height; ++y)
+			XXH3_64bits_update(&state, src + (y * image_line_length), (size_t)type_info->key_image_width * pixel_size);
+	}
 
-					*dst++ = r;
-					*dst++ = g;
-					*dst++ = b;
-				}
-			}
+	return XXH3_64bits_digest(&state);
+}
 
-			XXH64_hash_t* last_hash = device_impl->key_image_hashes + key_x + (key_y * type_info->columns);
-			const XXH64_hash_t hash = XXH64(device_impl->key_image_src_buffer,
-			                                type_info->image_width * type_info->image_height * 4, 0);
+size_t scdk_extract_key_tile(const scdk_device_impl_t* device_impl, const scdk_image_view_t* image,
+                             scdk_pixel_format_e pixel_format, int key_x, int key_y, unsigned char* dst,
+                             scdk_pixel_format_e* tile_pixel_format)
+{
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+	const size_t key_pixel_count = type_info->key_image_width * type_info->key_image_height;
 
-			if (*last_hash != hash)
-			{
-				if (!scdk_set_key_image(device, key_x, key_y, device_impl->key_image_src_buffer, pixel_format,
-				                        quality_percentage))
-					return false;
+	if (pixel_format == SCDK_PIXEL_FORMAT_I420 || pixel_format == SCDK_PIXEL_FORMAT_NV12)
+	{
+		device_impl->extractors->extract_key_yuv(device_impl->key_row_kernels, type_info, image, pixel_format,
+		                                         key_x, key_y, dst);
+		*tile_pixel_format = SCDK_PIXEL_FORMAT_TILE_YUV420;
+		return key_pixel_count + (key_pixel_count / 2);
+	}
 
-				*last_hash = hash;
-			}
-		}
+	if (device_impl->is_planar_encoding_enabled && pixel_format >= 0 && pixel_format < SCDK_KERNELS_RGB_FORMAT_COUNT)
+	{
+		device_impl->extractors->extract_key_yuv420(device_impl->key_row_kernels, type_info, image, pixel_format,
+		                                            key_x, key_y, dst);
+		*tile_pixel_format = SCDK_PIXEL_FORMAT_TILE_YUV420;
+		return key_pixel_count + (key_pixel_count / 2);
 	}
 
-	return true;
+	const int pixel_size = scdk_pixel_size(pixel_format);
+	device_impl->extractors->extract_key(device_impl->key_row_kernels, type_info, image, pixel_size, key_x, key_y,
+	                                     dst);
+	*tile_pixel_format = pixel_format;
+	return key_pixel_count * pixel_size;
 }
 
-bool scdk_set_image_32(scdk_device_t device, const unsigned char* image_buffer,
-                       scdk_pixel_format_e pixel_format, int quality_percentage)
+// Keys are handed to writer when one is given, so they are written while the next key is encoded
+static bool scdk_send_key_image(scdk_device_impl_t* device_impl, scdk_writer_t* writer, int key_index,
+                                const unsigned char* image_buffer, XXH64_hash_t hash,
+                                scdk_pixel_format_e pixel_format, int quality_percentage)
 {
-	if (device == NULL || pixel_format == SCDK_PIXEL_FORMAT_RGB || pixel_format == SCDK_PIXEL_FORMAT_BGR)
+	unsigned long dst_buffer_length = device_impl->key_image_dst_buffer_length;
+
+	const uint64_t encode_start_ns = scdk_time_now_ns();
+
+	const bool is_encoded = scdk_encode_key_cached(device_impl, &device_impl->encoder_state, image_buffer, hash,
+	                                               pixel_format, quality_percentage, device_impl->key_image_dst_buffer,
+	                                               &dst_buffer_length);
+
+	scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_ENCODE, scdk_time_now_ns() - encode_start_ns);
+
+	if (!is_encoded)
 		return false;
 
-	const scdk_device_impl_t* device_impl = device;
+	++device_impl->pending_stats.keys_encoded;
+
+	if (writer)
+		return scdk_writer_submit(writer, key_index, device_impl->key_image_dst_buffer, dst_buffer_length);
+
+	return scdk_write_key(device_impl, key_index, device_impl->key_image_dst_buffer, dst_buffer_length);
+}
+
+static bool scdk_send_image_tiles(scdk_device_impl_t* device_impl, const scdk_image_view_t* image,
+                                  scdk_pixel_format_e pixel_format, const scdk_frame_quality_t* frame_quality,
+                                  scdk_key_mask_t key_mask, scdk_key_mask_t* sent_mask)
+{
+	if (device_impl->pool)
+		return scdk_pool_set_image(device_impl->pool, image, pixel_format, frame_quality, key_mask, sent_mask);
+
 	const scdk_device_type_info_t* type_info = device_impl->type_info;
-	const size_t key_image_line_length = device_impl->type_info->key_image_width * 4;
+	const int key_count = type_info->columns * type_info->rows;
 
-	for (int key_x = 0; key_x < type_info->columns; ++key_x)
+	// A single key has nothing to overlap its write with, so only start the writer for frames of several keys. Keys
+	// are written by the scheduler while it is enabled.
+	int frame_key_count = 0;
+	for (int key_index = 0; key_index < key_count && frame_key_count < 2; ++key_index)
 	{
-		for (int key_y = 0; key_y < type_info->rows; ++key_y)
+		if (key_mask & SCDK_KEY_MASK_BIT(key_index))
+			++frame_key_count;
+	}
+
+	const bool is_writer_used = frame_key_count > 1 && device_impl->scheduler == NULL;
+
+	if (is_writer_used && device_impl->writer == NULL)
+		device_impl->writer = scdk_writer_create(device_impl);
+
+	scdk_writer_t* writer = is_writer_used ? device_impl->writer : NULL;
+	bool is_success = true;
+
+	for (int key_index = 0; key_index < key_count; ++key_index)
+	{
+		if (!(key_mask & SCDK_KEY_MASK_BIT(key_index)))
+			continue;
+
+		const int key_x = key_index % type_info->columns;
+		const int key_y = key_index / type_info->columns;
+
+		const uint64_t hash_start_ns = scdk_time_now_ns();
+
+		const XXH64_hash_t hash = scdk_hash_key(type_info, image, pixel_format, key_x, key_y);
+
+		scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_HASH, scdk_time_now_ns() - hash_start_ns);
+
+		const bool is_unchanged = scdk_is_key_unchanged(device_impl->valid_key_hashes,
+		                                                device_impl->key_image_hashes, key_index, hash);
+		const bool is_refined = is_unchanged && (frame_quality->refine_mask & SCDK_KEY_MASK_BIT(key_index));
+
+		if (is_unchanged && !is_refined)
 		{
-			for (int y = 0; y < type_info->image_height; ++y)
+			++device_impl->pending_stats.keys_skipped;
+			continue;
+		}
+
+		// Only keys that will be encoded are extracted
+		const uint64_t extract_start_ns = scdk_time_now_ns();
+
+		scdk_pixel_format_e tile_pixel_format;
+		const size_t tile_length = scdk_extract_key_tile(device_impl, image, pixel_format, key_x, key_y,
+		                                                 device_impl->key_image_src_buffer, &tile_pixel_format);
+
+		scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_EXTRACT,
+		                        scdk_time_now_ns() - extract_start_ns);
+
+		if (device_impl->change_tolerance)
+		{
+			if (!is_unchanged && scdk_change_tolerance_is_within(device_impl->change_tolerance, key_index,
+			                                                     device_impl->key_image_src_buffer, tile_pixel_format))
 			{
-				const int line = ((key_y * (type_info->key_image_height + type_info->key_gap_height)) + type_info->key_image_height) - y -
-					1;
-				const int row = (key_x * (type_info->key_image_width + type_info->key_gap_width)) * 4;
-
-				const int offset = (line * (type_info->image_width * 4))
-					+ row
-					+ key_image_line_length
-					- 1;
-
-				const unsigned char* src = image_buffer + offset;
-				unsigned char* dst = device_impl->key_image_src_buffer + (y * key_image_line_length);
-
-				unsigned char r, g, b, a;
-
-				for (size_t i = 0; i < key_image_line_length; i += 4)
-				{
-					a = *src--;
-					b = *src--;
-					g = *src--;
-					r = *src--;
-
-					*dst++ = r;
-					*dst++ = g;
-					*dst++ = b;
-					*dst++ = a;
-				}
+				++device_impl->pending_stats.keys_within_tolerance;
+				continue;
 			}
 
-			XXH64_hash_t* last_hash = device_impl->key_image_hashes + key_x + (key_y * type_info->columns);
-			const XXH64_hash_t hash = XXH64(device_impl->key_image_src_buffer,
-			                                type_info->key_image_width * type_info->key_image_height * 4, 0);
+			scdk_change_tolerance_set_sent(device_impl->change_tolerance, key_index, device_impl->key_image_src_buffer,
+			                               tile_length, tile_pixel_format);
+		}
 
-			if (*last_hash != hash)
-			{
-				if (!scdk_set_key_image(device, key_x, key_y, device_impl->key_image_src_buffer, pixel_format,
-				                        quality_percentage))
-					return false;
+		is_success = scdk_send_key_image(device_impl, writer, key_index, device_impl->key_image_src_buffer, hash,
+		                                 tile_pixel_format, is_refined ? frame_quality->refine_quality_percentage
+		                                                               : frame_quality->quality_percentage);
 
-				*last_hash = hash;
-			}
+		if (!is_success)
+			break;
+
+		device_impl->key_image_hashes[key_index] = hash;
+		device_impl->valid_key_hashes |= SCDK_KEY_MASK_BIT(key_index);
+		*sent_mask |= SCDK_KEY_MASK_BIT(key_index);
+
+		if (is_refined)
+			++device_impl->pending_stats.keys_refined;
+	}
+
+	if (writer)
+	{
+		// Keys queued behind a failed write were counted as sent, so forget them again
+		scdk_key_mask_t failed_mask;
+		if (!scdk_writer_flush(writer, &failed_mask))
+		{
+			device_impl->valid_key_hashes &= ~failed_mask;
+			*sent_mask &= ~failed_mask;
+			is_success = false;
 		}
 	}
 
-	return true;
+	// Keys recorded as sent before the frame failed may not have been
+	if (!is_success)
+		scdk_change_tolerance_invalidate(device_impl->change_tolerance, key_mask & ~*sent_mask);
+
+	return is_success;
 }
 
+static bool scdk_send_image_keys(scdk_device_impl_t* device_impl, const scdk_image_view_t* image,
+                                 scdk_pixel_format_e pixel_format, int quality_percentage, scdk_key_mask_t key_mask)
+{
+	scdk_frame_quality_t frame_quality = { quality_percentage, 0, quality_percentage };
+	scdk_key_mask_t sent_mask = 0;
 
-bool scdk_set_key_image(scdk_device_t device, int key_x, int key_y, const unsigned char* image_buffer,
+	if (device_impl->rate_control == NULL)
+		return scdk_send_image_tiles(device_impl, image, pixel_format, &frame_quality, key_mask, &sent_mask);
+
+	scdk_rate_control_begin_frame(device_impl->rate_control, quality_percentage, key_mask,
+	                              device_impl->valid_key_hashes, &frame_quality);
+
+	const uint64_t frame_start_us = scdk_time_now_us();
+	const uint64_t frame_start_bytes = device_impl->pending_stats.jpeg_bytes;
+
+	const bool is_success = scdk_send_image_tiles(device_impl, image, pixel_format, &frame_quality, key_mask,
+	                                              &sent_mask);
+
+	scdk_rate_control_end_frame(device_impl->rate_control, &frame_quality, key_mask, sent_mask, frame_start_us,
+	                            scdk_time_now_us(), device_impl->pending_stats.jpeg_bytes - frame_start_bytes);
+
+	return is_success;
+}
+
+bool scdk_set_image_view(scdk_device_impl_t* device_impl, const scdk_image_view_t* image,
+                         scdk_pixel_format_e pixel_format, int quality_percentage, scdk_key_mask_t key_mask)
+{
+	scdk_mutex_lock(&device_impl->image_mutex);
+	++device_impl->pending_stats.frames_submitted;
+
+	// Keys set through the scheduler since the last frame no longer show what their hashes describe
+	if (device_impl->scheduler)
+	{
+		const scdk_key_mask_t replaced_key_mask = scdk_scheduler_take_replaced_keys(device_impl);
+		device_impl->valid_key_hashes &= ~replaced_key_mask;
+		scdk_change_tolerance_invalidate(device_impl->change_tolerance, replaced_key_mask);
+	}
+
+	const bool is_success = scdk_send_image_keys(device_impl, image, pixel_format, quality_percentage, key_mask);
+	scdk_stats_flush(device_impl);
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return is_success;
+}
+
+static bool scdk_set_image_keys(scdk_device_impl_t* device_impl, const unsigned char* image_buffer,
+                                scdk_pixel_format_e pixel_format, int quality_percentage, scdk_key_mask_t key_mask)
+{
+	const scdk_image_view_t image =
+	{
+		image_buffer, device_impl->type_info->image_width, device_impl->type_info->image_height, 0, 0
+	};
+
+	return scdk_set_image_view(device_impl, &image, pixel_format, quality_percentage, key_mask);
+}
+
+bool scdk_set_image_24(scdk_device_t device, const unsigned char* image_buffer,
+                       scdk_pixel_format_e pixel_format, int quality_percentage)
+{
+	if (device == NULL || (pixel_format != SCDK_PIXEL_FORMAT_RGB && pixel_format != SCDK_PIXEL_FORMAT_BGR))
+		return false;
+
+	return scdk_set_image_keys(device, image_buffer, pixel_format, quality_percentage, SCDK_KEY_MASK_ALL);
+}
+
+bool scdk_set_image_32(scdk_device_t device, const unsigned char* image_buffer,
+                       scdk_pixel_format_e pixel_format, int quality_percentage)
+{
+	if (device == NULL || pixel_format == SCDK_PIXEL_FORMAT_RGB || pixel_format == SCDK_PIXEL_FORMAT_BGR
+	    || scdk_is_yuv_pixel_format(pixel_format))
+		return false;
+
+	return scdk_set_image_keys(device, image_buffer, pixel_format, quality_percentage, SCDK_KEY_MASK_ALL);
+}
+
+bool scdk_set_image_yuv(scdk_device_t device, const unsigned char* image_buffer,
                         scdk_pixel_format_e pixel_format, int quality_percentage)
 {
-	if (device == NULL)
+	if (device == NULL || (pixel_format != SCDK_PIXEL_FORMAT_I420 && pixel_format != SCDK_PIXEL_FORMAT_NV12))
 		return false;
 
-	const scdk_device_impl_t* device_impl = device;
-	const scdk_device_type_info_t* type_info = device_impl->type_info;
+	return scdk_set_image_keys(device, image_buffer, pixel_format, quality_percentage, SCDK_KEY_MASK_ALL);
+}
+
+static scdk_key_mask_t scdk_get_damaged_keys(const scdk_device_type_info_t* type_info, const scdk_rect_t* damage_rects,
+                                             size_t damage_rect_count)
+{
+	const int key_pitch_x = type_info->key_image_width + type_info->key_gap_width;
+	const int key_pitch_y = type_info->key_image_height + type_info->key_gap_height;
+	scdk_key_mask_t key_mask = 0;
+
+	for (size_t i = 0; i < damage_rect_count; ++i)
+	{
+		const scdk_rect_t* rect = damage_rects + i;
+
+		const int left = SCDK_MAX(rect->x, 0);
+		const int top = SCDK_MAX(rect->y, 0);
+		const int right = SCDK_MIN(rect->x + rect->width, type_info->image_width) - 1;
+		const int bottom = SCDK_MIN(rect->y + rect->height, type_info->image_height) - 1;
+
+		if (left > right || top > bottom)
+			continue;
+
+		// A rectangle starting inside a gap only touches keys from the next column or row onwards
+		const int first_x = (left / key_pitch_x) + (left % key_pitch_x >= type_info->key_image_width ? 1 : 0);
+		const int first_y = (top / key_pitch_y) + (top % key_pitch_y >= type_info->key_image_height ? 1 : 0);
+		const int last_x = SCDK_MIN(right / key_pitch_x, type_info->columns - 1);
+		const int last_y = SCDK_MIN(bottom / key_pitch_y, type_info->rows - 1);
+
+		for (int key_y = first_y; key_y <= last_y; ++key_y)
+		{
+			for (int key_x = first_x; key_x <= last_x; ++key_x)
+				key_mask |= SCDK_KEY_MASK_BIT(key_x + (key_y * type_info->columns));
+		}
+	}
+
+	return key_mask;
+}
 
-	if (key_x < 0 || key_x > type_info->columns || key_y < 0 || key_y > type_info->rows)
+bool scdk_set_image_region(scdk_device_t device, const unsigned char* image_buffer,
+                           scdk_pixel_format_e pixel_format, int quality_percentage,
+                           const scdk_rect_t* damage_rects, size_t damage_rect_count)
+{
+	if (device == NULL || image_buffer == NULL || pixel_format < SCDK_PIXEL_FORMAT_RGB
+	    || pixel_format > SCDK_PIXEL_FORMAT_NV12 || (damage_rects == NULL && damage_rect_count > 0))
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	const scdk_key_mask_t key_mask = scdk_get_damaged_keys(device_impl->type_info, damage_rects, damage_rect_count);
+	if (key_mask == 0)
+		return true;
+
+	return scdk_set_image_keys(device_impl, image_buffer, pixel_format, quality_percentage, key_mask);
+}
+
+bool scdk_compute_key_hashes(scdk_device_t device, const unsigned char* image_buffer,
+                             scdk_pixel_format_e pixel_format, uint64_t* key_hashes, size_t key_hash_count)
+{
+	if (device == NULL || image_buffer == NULL || key_hashes == NULL || pixel_format < SCDK_PIXEL_FORMAT_RGB
+	    || pixel_format > SCDK_PIXEL_FORMAT_NV12)
 		return false;
 
+	const scdk_device_type_info_t* type_info = ((scdk_device_impl_t*)device)->type_info;
+
+	if (key_hash_count < (size_t)(type_info->columns * type_info->rows))
+		return false;
+
+	// Only reads the device's geometry, so never waits for the image output path
+	const scdk_image_view_t image = { image_buffer, type_info->image_width, type_info->image_height, 0, 0 };
+
+	for (int key_y = 0; key_y < type_info->rows; ++key_y)
+	{
+		for (int key_x = 0; key_x < type_info->columns; ++key_x)
+			key_hashes[key_x + (key_y * type_info->columns)] = scdk_hash_key(type_info, &image, pixel_format,
+			                                                                 key_x, key_y);
+	}
+
+	return true;
+}
+
+typedef struct scdk_encoder_turbojpeg_t
+{
+	tjhandle jpeg_handle;
+	const scdk_device_type_info_t* type_info;
+
+} scdk_encoder_turbojpeg_t;
+
+static void* scdk_encoder_turbojpeg_create(const scdk_device_type_info_t* type_info)
+{
+	tjhandle jpeg_handle = tjInitCompress();
+	if (jpeg_handle == NULL)
+		return NULL;
+
+	scdk_encoder_turbojpeg_t* encoder = malloc(sizeof(scdk_encoder_turbojpeg_t));
+	if (encoder == NULL)
+		abort();
+
+	encoder->jpeg_handle = jpeg_handle;
+	encoder->type_info = type_info;
+
+	return encoder;
+}
+
+static void scdk_encoder_turbojpeg_free(void* context)
+{
+	scdk_encoder_turbojpeg_t* encoder = context;
+
+	tjDestroy(encoder->jpeg_handle);
+	free(encoder);
+}
+
+static bool scdk_encoder_turbojpeg_encode(void* context, const unsigned char* image_buffer,
+                                          scdk_pixel_format_e pixel_format, int quality_percentage,
+                                          unsigned char* dst_buffer, unsigned long* dst_buffer_length)
+{
+	const scdk_encoder_turbojpeg_t* encoder = context;
+	const scdk_device_type_info_t* type_info = encoder->type_info;
+	tjhandle jpeg_handle = encoder->jpeg_handle;
+
+	if (pixel_format == SCDK_PIXEL_FORMAT_TILE_YUV420)
+	{
+		const int key_pixel_count = type_info->key_image_width * type_info->key_image_height;
+		const unsigned char* planes[3] =
+		{
+			image_buffer,
+			image_buffer + key_pixel_count,
+			image_buffer + key_pixel_count + (key_pixel_count / 4)
+		};
+
+		return tjCompressFromYUVPlanes(jpeg_handle, planes, type_info->key_image_width, NULL,
+		                               type_info->key_image_height, TJSAMP_420, &dst_buffer, dst_buffer_length,
+		                               quality_percentage, TJFLAG_FASTDCT | TJFLAG_NOREALLOC) == 0;
+	}
+
 	enum TJPF turbo_pixel_format;
 	switch (pixel_format)
 	{
@@ -430,26 +776,91 @@ bool scdk_set_key_image(scdk_device_t device, int key_x, int key_y, const unsign
 	default: return false;
 	}
 
-	unsigned char* dst_buffer = device_impl->key_image_dst_buffer;
-	unsigned long dst_buffer_length;
+	return tjCompress2(jpeg_handle, image_buffer, type_info->key_image_width, 0, type_info->key_image_height,
+	                   turbo_pixel_format, &dst_buffer, dst_buffer_length, TJSAMP_420,
+	                   quality_percentage, TJFLAG_FASTDCT | TJFLAG_NOREALLOC) == 0;
+}
 
-	tjCompress2(device_impl->jpeg_handle, image_buffer, type_info->key_image_width, 0, type_info->key_image_height,
-	            turbo_pixel_format, &dst_buffer, &dst_buffer_length, TJSAMP_420,
-				quality_percentage, TJFLAG_FASTDCT);
+const scdk_encoder_t scdk_encoder_turbojpeg =
+{
+	"turbojpeg",
+	SCDK_JPEG_ENCODER_TURBOJPEG,
+	scdk_encoder_turbojpeg_create,
+	scdk_encoder_turbojpeg_encode,
+	scdk_encoder_turbojpeg_free
+};
+
+void scdk_encoder_state_free(scdk_encoder_state_t* encoder_state)
+{
+	if (encoder_state->encoder)
+		encoder_state->encoder->free(encoder_state->context);
 
-	const int report_count = (dst_buffer_length + (SD_OUT_REPORT_IMAGE_LENGTH - 1)) / SD_OUT_REPORT_IMAGE_LENGTH;
+	encoder_state->encoder = NULL;
+	encoder_state->context = NULL;
+}
 
-	unsigned char* image_p = dst_buffer;
+bool scdk_encode_key(scdk_encoder_state_t* encoder_state, const scdk_encoder_t* encoder,
+                     const scdk_device_type_info_t* type_info, const unsigned char* image_buffer,
+                     scdk_pixel_format_e pixel_format, int quality_percentage,
+                     unsigned char* dst_buffer, unsigned long* dst_buffer_length)
+{
+	if (encoder_state->encoder != encoder)
+	{
+		scdk_encoder_state_free(encoder_state);
 
-	for (int i = 0; i < report_count; ++i)
+		encoder_state->context = encoder->create(type_info);
+		if (encoder_state->context == NULL)
+			return false;
+
+		encoder_state->encoder = encoder;
+	}
+
+	return encoder->encode(encoder_state->context, image_buffer, pixel_format, quality_percentage, dst_buffer,
+	                       dst_buffer_length);
+}
+
+bool scdk_encode_key_cached(const scdk_device_impl_t* device_impl, scdk_encoder_state_t* encoder_state,
+                            const unsigned char* image_buffer, XXH64_hash_t hash,
+                            scdk_pixel_format_e pixel_format, int quality_percentage,
+                            unsigned char* dst_buffer, unsigned long* dst_buffer_length)
+{
+	if (device_impl->jpeg_cache == NULL)
+		return scdk_encode_key(encoder_state, device_impl->encoder, device_impl->type_info, image_buffer, pixel_format,
+		                       quality_percentage, dst_buffer, dst_buffer_length);
+
+	const scdk_jpeg_cache_key_t key =
 	{
-		const size_t image_length = SCDK_MIN(dst_buffer_length - (image_p - dst_buffer), SD_OUT_REPORT_IMAGE_LENGTH);
+		hash, quality_percentage, device_impl->type_info->device_type, pixel_format, device_impl->encoder->type
+	};
+
+	const unsigned long dst_buffer_capacity = *dst_buffer_length;
+	if (scdk_jpeg_cache_lookup(device_impl->jpeg_cache, &key, dst_buffer, dst_buffer_length))
+		return true;
+
+	*dst_buffer_length = dst_buffer_capacity;
+	if (!scdk_encode_key(encoder_state, device_impl->encoder, device_impl->type_info, image_buffer, pixel_format,
+	                     quality_percentage, dst_buffer, dst_buffer_length))
+		return false;
+
+	scdk_jpeg_cache_insert(device_impl->jpeg_cache, &key, dst_buffer, *dst_buffer_length);
+	return true;
+}
+
+int scdk_packetize_key(int key_index, const unsigned char* jpeg_buffer, unsigned long jpeg_length,
+                       unsigned char* dst)
+{
+	const int report_count = scdk_key_report_count(jpeg_length);
 
-		unsigned char* p = device_impl->hid_out_report_buffer;
+	const unsigned char* image_p = jpeg_buffer;
+	unsigned char* p = dst;
+
+	for (int i = 0; i < report_count; ++i)
+	{
+		const size_t image_length = SCDK_MIN(jpeg_length - (image_p - jpeg_buffer), SD_OUT_REPORT_IMAGE_LENGTH);
 
 		*p++ = 0x02;
 		*p++ = 0x07;
-		*p++ = key_x + (key_y * type_info->columns);
+		*p++ = key_index;
 		*p++ = i == report_count - 1 ? 0x01 : 0x00;
 		*p++ = image_length & 0xFF;
 		*p++ = image_length >> 8;
@@ -459,22 +870,386 @@ bool scdk_set_key_image(scdk_device_t device, int key_x, int key_y, const unsign
 		memcpy(p, image_p, image_length);
 		p += image_length;
 		image_p += image_length;
+	}
+
+	// Every report but the last is filled by image data, so only the tail of the last needs padding
+	memset(p, 0, (dst + ((size_t)report_count * SD_OUT_REPORT_LENGTH)) - p);
+
+	return report_count;
+}
+
+void scdk_device_set_disconnected(scdk_device_impl_t* device_impl)
+{
+	scdk_mutex_lock(&device_impl->stats_mutex);
+	device_impl->is_disconnected = true;
+	scdk_mutex_unlock(&device_impl->stats_mutex);
+}
+
+bool scdk_device_is_disconnected(scdk_device_impl_t* device_impl)
+{
+	scdk_mutex_lock(&device_impl->stats_mutex);
+	const bool is_disconnected = device_impl->is_disconnected;
+	scdk_mutex_unlock(&device_impl->stats_mutex);
+
+	return is_disconnected;
+}
+
+bool scdk_write_reports(scdk_device_impl_t* device_impl, const unsigned char* reports, int report_count,
+                        scdk_stats_t* stats)
+{
+	for (int i = 0; i < report_count; ++i)
+	{
+		const unsigned char* report = reports + ((size_t)i * SD_OUT_REPORT_LENGTH);
 
-		while (p - device_impl->hid_out_report_buffer < SD_OUT_REPORT_LENGTH)
-			*p++ = 0;
+		const uint64_t write_start_ns = scdk_time_now_ns();
+
+		int result = device_impl->transport->write(device_impl->transport_context, report, SD_OUT_REPORT_LENGTH);
+
+		// Resending a report is safe as the device reassembles images by page number
+		for (int retry = 0; result == -1 && retry < SCDK_WRITE_RETRY_COUNT; ++retry)
+		{
+			++stats->write_retries;
+			result = device_impl->transport->write(device_impl->transport_context, report, SD_OUT_REPORT_LENGTH);
+		}
+
+		scdk_stats_record_stage(stats, SCDK_STAGE_WRITE, scdk_time_now_ns() - write_start_ns);
 
-		const int result = hid_write(device_impl->device, device_impl->hid_out_report_buffer, SD_OUT_REPORT_LENGTH);
 		if (result == -1)
+		{
+			++stats->write_failures;
+			scdk_device_set_disconnected(device_impl);
+			return false;
+		}
+
+		++stats->reports_written;
+	}
+
+	return true;
+}
+
+bool scdk_write_key(scdk_device_impl_t* device_impl, int key_index, const unsigned char* jpeg_buffer,
+                    unsigned long jpeg_length)
+{
+	if (device_impl->scheduler)
+	{
+		if (!scdk_scheduler_write_key(device_impl->scheduler, key_index, jpeg_buffer, jpeg_length,
+		                              &device_impl->pending_stats))
 			return false;
+
+		device_impl->pending_stats.jpeg_bytes += jpeg_length;
+		return true;
 	}
 
+	// Pre-encoded JPEGs passed in by the caller can be larger than anything the encoder produces
+	const size_t reports_length = (size_t)scdk_key_report_count(jpeg_length) * SD_OUT_REPORT_LENGTH;
+	if (reports_length > device_impl->hid_out_report_buffer_length)
+	{
+		free(device_impl->hid_out_report_buffer);
+		device_impl->hid_out_report_buffer_length = reports_length;
+		device_impl->hid_out_report_buffer = malloc(reports_length);
+		if (device_impl->hid_out_report_buffer == NULL)
+			abort();
+	}
+
+	const uint64_t packetize_start_ns = scdk_time_now_ns();
+
+	const int report_count = scdk_packetize_key(key_index, jpeg_buffer, jpeg_length,
+	                                            device_impl->hid_out_report_buffer);
+
+	scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_PACKETIZE, scdk_time_now_ns() - packetize_start_ns);
+
+	if (!scdk_write_reports(device_impl, device_impl->hid_out_report_buffer, report_count,
+	                        &device_impl->pending_stats))
+		return false;
+
+	device_impl->pending_stats.jpeg_bytes += jpeg_length;
+
 	return true;
 }
 
+const unsigned char* scdk_prepare_key_image(const scdk_device_type_info_t* type_info, const unsigned char* image_buffer,
+                                            scdk_pixel_format_e* pixel_format, unsigned char* dst)
+{
+	// An I420 key image is already laid out as a tile; NV12 chroma only needs deinterleaving
+	if (*pixel_format == SCDK_PIXEL_FORMAT_NV12)
+	{
+		const int key_pixel_count = type_info->key_image_width * type_info->key_image_height;
+		const unsigned char* uv = image_buffer + key_pixel_count;
+		unsigned char* cb = dst + key_pixel_count;
+		unsigned char* cr = cb + (key_pixel_count / 4);
+
+		memcpy(dst, image_buffer, key_pixel_count);
+
+		for (int i = 0; i < key_pixel_count / 4; ++i)
+		{
+			cb[i] = uv[i * 2];
+			cr[i] = uv[(i * 2) + 1];
+		}
+
+		image_buffer = dst;
+	}
+
+	if (scdk_is_yuv_pixel_format(*pixel_format))
+		*pixel_format = SCDK_PIXEL_FORMAT_TILE_YUV420;
+
+	return image_buffer;
+}
+
+bool scdk_set_key_image(scdk_device_t device, int key_x, int key_y, const unsigned char* image_buffer,
+                        scdk_pixel_format_e pixel_format, int quality_percentage)
+{
+	return scdk_set_key_image_priority(device, key_x, key_y, image_buffer, pixel_format, quality_percentage,
+	                                   SCDK_UPDATE_PRIORITY_NORMAL);
+}
+
+bool scdk_set_key_image_priority(scdk_device_t device, int key_x, int key_y, const unsigned char* image_buffer,
+                                 scdk_pixel_format_e pixel_format, int quality_percentage,
+                                 scdk_update_priority_e priority)
+{
+	if (device == NULL || priority < 0 || priority >= SCDK_UPDATE_PRIORITY_COUNT)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+
+	if (key_x < 0 || key_x >= type_info->columns || key_y < 0 || key_y >= type_info->rows)
+		return false;
+
+	const int key_index = key_x + (key_y * type_info->columns);
+
+	bool is_scheduled;
+	const bool is_sent = scdk_scheduler_set_key_image(device_impl, key_index, image_buffer, pixel_format,
+	                                                  quality_percentage, priority, &is_scheduled);
+	if (is_scheduled)
+		return is_sent;
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+
+	device_impl->valid_key_hashes &= ~SCDK_KEY_MASK_BIT(key_index);
+	scdk_change_tolerance_invalidate(device_impl->change_tolerance, SCDK_KEY_MASK_BIT(key_index));
+
+	const uint64_t extract_start_ns = scdk_time_now_ns();
+
+	image_buffer = scdk_prepare_key_image(type_info, image_buffer, &pixel_format, device_impl->key_image_src_buffer);
+
+	const uint64_t hash_start_ns = scdk_time_now_ns();
+	scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_EXTRACT, hash_start_ns - extract_start_ns);
+
+	XXH64_hash_t hash = 0;
+	if (device_impl->jpeg_cache)
+	{
+		// Key images are encoded as given while panel keys are rotated first, so the two are seeded apart to keep a
+		// key image from sharing a cached JPEG with a panel key of the same bytes
+		hash = XXH3_64bits_withSeed(image_buffer, scdk_image_length(type_info->key_image_width,
+		                                                             type_info->key_image_height, pixel_format),
+		                            SCDK_KEY_IMAGE_HASH_SEED | (XXH64_hash_t)pixel_format);
+		scdk_stats_record_stage(&device_impl->pending_stats, SCDK_STAGE_HASH, scdk_time_now_ns() - hash_start_ns);
+	}
+
+	const bool is_success = scdk_send_key_image(device_impl, NULL, key_index, image_buffer, hash, pixel_format,
+	                                            quality_percentage);
+	scdk_stats_flush(device_impl);
+
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return is_success;
+}
+
+static bool scdk_validate_key_jpeg(scdk_device_impl_t* device_impl, const unsigned char* jpeg_buffer,
+                                   size_t jpeg_length)
+{
+	if (device_impl->jpeg_decompress_handle == NULL)
+		device_impl->jpeg_decompress_handle = tjInitDecompress();
+
+	int width, height, subsampling, colorspace;
+	if (tjDecompressHeader3(device_impl->jpeg_decompress_handle, jpeg_buffer, (unsigned long)jpeg_length,
+	                        &width, &height, &subsampling, &colorspace) != 0)
+		return false;
+
+	return width == device_impl->type_info->key_image_width && height == device_impl->type_info->key_image_height;
+}
+
+bool scdk_set_key_jpeg(scdk_device_t device, int key_x, int key_y, const unsigned char* jpeg_buffer,
+                       size_t jpeg_length)
+{
+	if (device == NULL || jpeg_buffer == NULL || jpeg_length == 0)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+
+	if (key_x < 0 || key_x >= type_info->columns || key_y < 0 || key_y >= type_info->rows)
+		return false;
+
+	const int key_index = key_x + (key_y * type_info->columns);
+	bool is_success = false;
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+
+	if (!device_impl->is_jpeg_validation_enabled || scdk_validate_key_jpeg(device_impl, jpeg_buffer, jpeg_length))
+	{
+		device_impl->valid_key_hashes &= ~SCDK_KEY_MASK_BIT(key_index);
+		scdk_change_tolerance_invalidate(device_impl->change_tolerance, SCDK_KEY_MASK_BIT(key_index));
+		is_success = scdk_write_key(device_impl, key_index, jpeg_buffer, (unsigned long)jpeg_length);
+		scdk_stats_flush(device_impl);
+	}
+
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return is_success;
+}
+
+static bool scdk_send_image_jpeg(scdk_device_impl_t* device_impl, const unsigned char* const* key_jpeg_buffers,
+                                 const size_t* key_jpeg_lengths)
+{
+	const scdk_device_type_info_t* type_info = device_impl->type_info;
+	const int key_count = type_info->columns * type_info->rows;
+
+	if (device_impl->is_jpeg_validation_enabled)
+	{
+		for (int key_index = 0; key_index < key_count; ++key_index)
+		{
+			if (key_jpeg_buffers[key_index]
+			    && !scdk_validate_key_jpeg(device_impl, key_jpeg_buffers[key_index], key_jpeg_lengths[key_index]))
+				return false;
+		}
+	}
+
+	for (int key_index = 0; key_index < key_count; ++key_index)
+	{
+		if (key_jpeg_buffers[key_index] == NULL || key_jpeg_lengths[key_index] == 0)
+			continue;
+
+		device_impl->valid_key_hashes &= ~SCDK_KEY_MASK_BIT(key_index);
+		scdk_change_tolerance_invalidate(device_impl->change_tolerance, SCDK_KEY_MASK_BIT(key_index));
+
+		if (!scdk_write_key(device_impl, key_index, key_jpeg_buffers[key_index],
+		                    (unsigned long)key_jpeg_lengths[key_index]))
+			return false;
+	}
+
+	return true;
+}
+
+bool scdk_set_image_jpeg(scdk_device_t device, const unsigned char* const* key_jpeg_buffers,
+                         const size_t* key_jpeg_lengths)
+{
+	if (device == NULL || key_jpeg_buffers == NULL || key_jpeg_lengths == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+	++device_impl->pending_stats.frames_submitted;
+	const bool is_success = scdk_send_image_jpeg(device_impl, key_jpeg_buffers, key_jpeg_lengths);
+	scdk_stats_flush(device_impl);
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return is_success;
+}
+
+bool scdk_set_jpeg_validation(scdk_device_t device, bool is_enabled)
+{
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+	device_impl->is_jpeg_validation_enabled = is_enabled;
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return true;
+}
+
+bool scdk_set_jpeg_cache(scdk_device_t device, scdk_jpeg_cache_t cache)
+{
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+	scdk_mutex_lock(&device_impl->key_mutex);
+	scdk_jpeg_cache_impl_t* previous_cache = device_impl->jpeg_cache;
+	device_impl->jpeg_cache = scdk_jpeg_cache_retain(cache);
+	scdk_mutex_unlock(&device_impl->key_mutex);
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	scdk_jpeg_cache_free(previous_cache);
+
+	return true;
+}
+
+bool scdk_set_planar_encoding(scdk_device_t device, bool is_enabled)
+{
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+	device_impl->is_planar_encoding_enabled = is_enabled;
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return true;
+}
+
+bool scdk_set_jpeg_encoder(scdk_device_t device, scdk_jpeg_encoder_e encoder)
+{
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	const scdk_encoder_t* selected_encoder;
+	switch (encoder)
+	{
+	case SCDK_JPEG_ENCODER_TURBOJPEG: selected_encoder = &scdk_encoder_turbojpeg;
+		break;
+	case SCDK_JPEG_ENCODER_BUILTIN: selected_encoder = &scdk_encoder_builtin;
+		break;
+	default: return false;
+	}
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+	scdk_mutex_lock(&device_impl->key_mutex);
+	device_impl->encoder = selected_encoder;
+	scdk_mutex_unlock(&device_impl->key_mutex);
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return true;
+}
+
+bool scdk_set_encoder_thread_count(scdk_device_t device, int thread_count)
+{
+	if (device == NULL || thread_count < 0)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->image_mutex);
+
+	scdk_pool_free(device_impl->pool);
+	device_impl->pool = thread_count > 0 ? scdk_pool_create(device_impl, thread_count) : NULL;
+
+	const bool is_success = thread_count == 0 || device_impl->pool != NULL;
+
+	scdk_mutex_unlock(&device_impl->image_mutex);
+
+	return is_success;
+}
+
 bool scdk_set_brightness(scdk_device_t device, int brightness_percentage)
 {
-	const scdk_device_impl_t* device_impl = device;
-	unsigned char* p = device_impl->hid_out_report_buffer;
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->feature_mutex);
+
+	unsigned char* p = device_impl->hid_out_feature_report_buffer;
 
 	*p++ = 0x03;
 	*p++ = 0x08;
@@ -509,23 +1284,43 @@ bool scdk_set_brightness(scdk_device_t device, int brightness_percentage)
 	*p++ = 0x00;
 	*p++ = 0x00;
 
-	const int result = hid_send_feature_report(device_impl->device, device_impl->hid_out_report_buffer,
-	                                           SD_OUT_FEATURE_REPORT_LENGTH);
+	const int result = device_impl->transport->send_feature_report(device_impl->transport_context,
+	                                                               device_impl->hid_out_feature_report_buffer,
+	                                                               SD_OUT_FEATURE_REPORT_LENGTH);
+
+	scdk_mutex_unlock(&device_impl->feature_mutex);
+
+	if (result == -1)
+		scdk_device_set_disconnected(device_impl);
+
 	return result != -1;
 }
 
 bool scdk_set_screensaver(scdk_device_t device)
 {
-	const scdk_device_impl_t* device_impl = device;
-	unsigned char* p = device_impl->hid_out_report_buffer;
+	if (device == NULL)
+		return false;
+
+	scdk_device_impl_t* device_impl = device;
+
+	scdk_mutex_lock(&device_impl->feature_mutex);
+
+	unsigned char* p = device_impl->hid_out_feature_report_buffer;
 
 	*p++ = 0x03;
 	*p++ = 0x02;
 
-	while (p - device_impl->hid_out_report_buffer < SD_OUT_FEATURE_REPORT_LENGTH)
+	while (p - device_impl->hid_out_feature_report_buffer < SD_OUT_FEATURE_REPORT_LENGTH)
 		*p++ = 0;
 
-	const int result = hid_send_feature_report(device_impl->device, device_impl->hid_out_report_buffer,
-	                                           SD_OUT_FEATURE_REPORT_LENGTH);
+	const int result = device_impl->transport->send_feature_report(device_impl->transport_context,
+	                                                               device_impl->hid_out_feature_report_buffer,
+	                                                               SD_OUT_FEATURE_REPORT_LENGTH);
+
+	scdk_mutex_unlock(&device_impl->feature_mutex);
+
+	if (result == -1)
+		scdk_device_set_disconnected(device_impl);
+
 	return result != -1;
 }